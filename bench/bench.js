@@ -0,0 +1,345 @@
+// Benchmark suite -- fit/predict throughput and latency for LR/FM/FFM
+//
+// Environment agnostic: run(lib, options) takes the package exports
+// (require('../src/index.js') in Node, the `xlearn` global of the IIFE
+// bundle in a browser) and resolves to a JSON-serializable report. The
+// Node and browser drivers are bench/run.js and bench/run-browser.js.
+//
+// For every dataset x size x model it measures:
+//   - dmatrixMs: XLearnDataset.create (X -> DMatrix conversion)
+//   - fit: fitDataset wall time and rows/sec per epoch
+//   - predict: predict(X) latency percentiles per batch size (includes
+//     the per-call DMatrix build, as seen by callers)
+//   - heapBytes: WASM heap size after the case; the heap only grows, so
+//     the report's peakHeapBytes is the largest of these
+
+(function (root) {
+  'use strict'
+
+  const SCHEMA = 'xlearn-bench/1'
+
+  const DEFAULTS = {
+    sizes: [10000, 100000],
+    datasets: ['dense', 'criteo'],
+    models: ['lr', 'fm', 'ffm'],
+    batches: [1, 32, 1024, 65536],
+    epochs: 5,
+    seed: 42,
+    // Upper bound on predict calls per batch size, and on rows scored
+    iterations: 200,
+    rowsPerBatchSize: 1 << 20
+  }
+
+  // Criteo-like layout: 13 numeric and 26 hashed categorical fields
+  const CRITEO_NUMERIC = 13
+  const CRITEO_CATEGORICAL = 26
+  const CRITEO_BUCKETS = 1000
+  const DENSE_COLS = 20
+
+  const MODELS = {
+    lr: { cls: 'XLearnLRClassifier', params: {} },
+    fm: { cls: 'XLearnFMClassifier', params: { k: 8 } },
+    ffm: { cls: 'XLearnFFMClassifier', params: { k: 4 } }
+  }
+
+  const now = () => performance.now()
+
+  // --- Synthetic data ---
+
+  function rng(seed) {
+    let a = seed >>> 0
+    return () => {
+      a = (a + 0x6d2b79f5) >>> 0
+      let t = a
+      t = Math.imul(t ^ (t >>> 15), t | 1)
+      t ^= t + Math.imul(t ^ (t >>> 7), t | 61)
+      return ((t ^ (t >>> 14)) >>> 0) / 4294967296
+    }
+  }
+
+  function gaussian(rand) {
+    const u = rand() || 1e-12
+    return Math.sqrt(-2 * Math.log(u)) * Math.cos(2 * Math.PI * rand())
+  }
+
+  function label(rand, margin) {
+    return rand() < 1 / (1 + Math.exp(-margin)) ? 1 : 0
+  }
+
+  // Dense rows with a planted linear + pairwise signal
+  function makeDense(rows, seed) {
+    const rand = rng(seed)
+    const cols = DENSE_COLS
+    const w = Array.from({ length: cols }, () => gaussian(rand))
+    const data = new Float64Array(rows * cols)
+    const y = new Float64Array(rows)
+    for (let i = 0; i < rows; i++) {
+      let margin = 0
+      for (let j = 0; j < cols; j++) {
+        const x = gaussian(rand)
+        data[i * cols + j] = x
+        margin += w[j] * x
+      }
+      margin += data[i * cols] * data[i * cols + 1]
+      y[i] = label(rand, margin / Math.sqrt(cols))
+    }
+    const featureFields = Int32Array.from({ length: cols }, (_, j) => j)
+    return { X: { data, rows, cols }, y, featureFields, nnz: rows * cols }
+  }
+
+  // CSR rows shaped like Criteo display-ads data: log-scaled counts in
+  // 13 numeric columns (some missing), then one active bucket in each of
+  // 26 categorical fields, with Zipf-like bucket popularity
+  function makeCriteo(rows, seed) {
+    const rand = rng(seed)
+    const cols = CRITEO_NUMERIC + CRITEO_CATEGORICAL * CRITEO_BUCKETS
+    const w = new Float64Array(cols)
+    for (let j = 0; j < cols; j++) w[j] = gaussian(rand) * 0.5
+
+    const perRow = CRITEO_NUMERIC + CRITEO_CATEGORICAL
+    const data = new Float64Array(rows * perRow)
+    const indices = new Int32Array(rows * perRow)
+    const indptr = new Int32Array(rows + 1)
+    const y = new Float64Array(rows)
+    let nnz = 0
+    for (let i = 0; i < rows; i++) {
+      let margin = -1
+      for (let j = 0; j < CRITEO_NUMERIC; j++) {
+        if (rand() < 0.2) continue // missing
+        const x = Math.log1p(Math.floor(-Math.log(rand() || 1e-12) * 10))
+        if (x === 0) continue
+        data[nnz] = x
+        indices[nnz++] = j
+        margin += w[j] * x * 0.1
+      }
+      for (let f = 0; f < CRITEO_CATEGORICAL; f++) {
+        const bucket = Math.floor(CRITEO_BUCKETS * Math.pow(rand(), 3))
+        const col = CRITEO_NUMERIC + f * CRITEO_BUCKETS + bucket
+        data[nnz] = 1
+        indices[nnz++] = col
+        margin += w[col] * 0.3
+      }
+      indptr[i + 1] = nnz
+      y[i] = label(rand, margin)
+    }
+
+    const featureFields = new Int32Array(cols)
+    for (let j = 0; j < cols; j++) {
+      featureFields[j] = j < CRITEO_NUMERIC
+        ? j
+        : CRITEO_NUMERIC + Math.floor((j - CRITEO_NUMERIC) / CRITEO_BUCKETS)
+    }
+    return {
+      X: {
+        rows, cols,
+        data: data.slice(0, nnz),
+        indices: indices.slice(0, nnz),
+        indptr
+      },
+      y, featureFields, nnz
+    }
+  }
+
+  const DATASETS = { dense: makeDense, criteo: makeCriteo }
+
+  // Rows [start, start + count) of a dense or CSR matrix, without copying
+  function sliceRows(X, start, count) {
+    if (X.indptr) {
+      const base = X.indptr[start]
+      const indptr = new Int32Array(count + 1)
+      for (let i = 0; i <= count; i++) indptr[i] = X.indptr[start + i] - base
+      const end = X.indptr[start + count]
+      return {
+        rows: count, cols: X.cols,
+        data: X.data.subarray(base, end),
+        indices: X.indices.subarray(base, end),
+        indptr
+      }
+    }
+    return {
+      data: X.data.subarray(start * X.cols, (start + count) * X.cols),
+      rows: count,
+      cols: X.cols
+    }
+  }
+
+  // --- Measurement ---
+
+  function percentile(sorted, q) {
+    const i = Math.min(sorted.length - 1, Math.ceil(q * sorted.length) - 1)
+    return sorted[Math.max(0, i)]
+  }
+
+  function summarize(times) {
+    const sorted = times.slice().sort((a, b) => a - b)
+    const mean = times.reduce((s, t) => s + t, 0) / times.length
+    return {
+      iterations: times.length,
+      meanMs: mean,
+      p50Ms: percentile(sorted, 0.5),
+      p90Ms: percentile(sorted, 0.9),
+      p99Ms: percentile(sorted, 0.99),
+      maxMs: sorted[sorted.length - 1]
+    }
+  }
+
+  function heapBytes(lib) {
+    return lib.getWasm().HEAPU8.byteLength
+  }
+
+  async function benchCase(lib, cfg, data, datasetName, modelName) {
+    const { X, y, featureFields, nnz } = data
+    const spec = MODELS[modelName]
+    const Model = lib[spec.cls]
+    const ffm = modelName === 'ffm'
+
+    let t0 = now()
+    const ds = await lib.XLearnDataset.create(X, y, {
+      task: 'binary',
+      featureFields: ffm ? featureFields : null
+    })
+    const dmatrixMs = now() - t0
+
+    let model = null
+    try {
+      model = await Model.create({ ...spec.params, epoch: cfg.epochs })
+      t0 = now()
+      model.fitDataset(ds)
+      const fitMs = now() - t0
+      ds.dispose()
+
+      const predict = []
+      for (const batch of cfg.batches) {
+        if (batch > X.rows) continue
+        const iterations = Math.max(
+          3, Math.min(cfg.iterations, Math.floor(cfg.rowsPerBatchSize / batch))
+        )
+        const slots = Math.max(1, Math.floor(X.rows / batch))
+        const inputs = []
+        for (let s = 0; s < Math.min(slots, iterations); s++) {
+          inputs.push(sliceRows(X, s * batch, batch))
+        }
+        model.predict(inputs[0]) // warm-up (output buffer sizing)
+        const times = []
+        for (let it = 0; it < iterations; it++) {
+          const input = inputs[it % inputs.length]
+          const t = now()
+          model.predict(input)
+          times.push(now() - t)
+        }
+        predict.push({ batch, ...summarize(times) })
+      }
+
+      return {
+        dataset: datasetName,
+        model: modelName,
+        rows: X.rows,
+        cols: X.cols,
+        nnz,
+        dmatrixMs,
+        fit: {
+          epochs: cfg.epochs,
+          ms: fitMs,
+          rowsPerSec: (X.rows * cfg.epochs) / (fitMs / 1000)
+        },
+        predict,
+        heapBytes: heapBytes(lib)
+      }
+    } finally {
+      if (!ds.disposed) ds.dispose()
+      if (model) model.dispose()
+    }
+  }
+
+  function environment(lib) {
+    const isNode = typeof process !== 'undefined' && !!(process.versions && process.versions.node)
+    const env = {
+      runtime: isNode ? 'node' : 'browser',
+      threaded: lib.isThreaded()
+    }
+    if (isNode) {
+      env.version = process.versions.node
+      env.platform = `${process.platform}-${process.arch}`
+    } else if (typeof navigator !== 'undefined') {
+      env.userAgent = navigator.userAgent
+      env.hardwareConcurrency = navigator.hardwareConcurrency
+    }
+    return env
+  }
+
+  // options: any DEFAULTS key, plus log(line) for progress output
+  async function run(lib, options = {}) {
+    const cfg = { ...DEFAULTS, ...options }
+    const log = cfg.log || (() => {})
+    delete cfg.log
+    await lib.loadXLearn()
+
+    const results = []
+    const started = now()
+    for (const datasetName of cfg.datasets) {
+      const make = DATASETS[datasetName]
+      if (!make) throw new Error(`bench: unknown dataset '${datasetName}'`)
+      for (const rows of cfg.sizes) {
+        const data = make(rows, cfg.seed)
+        for (const modelName of cfg.models) {
+          if (!MODELS[modelName]) throw new Error(`bench: unknown model '${modelName}'`)
+          const r = await benchCase(lib, cfg, data, datasetName, modelName)
+          results.push(r)
+          const p = r.predict.map(b => `b${b.batch} p50=${b.p50Ms.toFixed(3)}ms`).join(' ')
+          log(`${datasetName} ${rows} ${modelName}: dmatrix ${r.dmatrixMs.toFixed(1)}ms, ` +
+            `fit ${Math.round(r.fit.rowsPerSec)} rows/s, ${p}`)
+        }
+      }
+    }
+
+    return {
+      schema: SCHEMA,
+      timestamp: new Date().toISOString(),
+      env: environment(lib),
+      config: cfg,
+      totalMs: now() - started,
+      peakHeapBytes: Math.max(0, ...results.map(r => r.heapBytes)),
+      results
+    }
+  }
+
+  // --- Command line (shared by the Node and browser drivers) ---
+
+  // Small sizes for smoke runs and CI
+  const QUICK = { sizes: [2000], batches: [1, 32, 1024], epochs: 2, iterations: 50 }
+
+  //   [--quick] [--sizes=10000,100000] [--models=lr,fm,ffm]
+  //   [--datasets=dense,criteo] [--batches=1,32,1024,65536] [--epochs=5]
+  //   [--iterations=200] [--threads=auto|true|false] [--out=FILE]
+  function parseArgs(argv) {
+    const opts = {}
+    let quick = false
+    let out = null
+    let threads = 'auto'
+    const list = (v) => v.split(',').map(s => s.trim()).filter(Boolean)
+    const ints = (v) => list(v).map(Number)
+    for (const arg of argv) {
+      const [key, value = ''] = arg.replace(/^--/, '').split('=')
+      switch (key) {
+        case 'quick': quick = true; break
+        case 'sizes': opts.sizes = ints(value); break
+        case 'batches': opts.batches = ints(value); break
+        case 'models': opts.models = list(value); break
+        case 'datasets': opts.datasets = list(value); break
+        case 'epochs': opts.epochs = Number(value); break
+        case 'iterations': opts.iterations = Number(value); break
+        case 'threads': threads = value === 'auto' ? 'auto' : value === 'true'; break
+        case 'out': out = value; break
+        default: throw new Error(`unknown option: ${arg}`)
+      }
+    }
+    return { opts: quick ? { ...QUICK, ...opts } : opts, out, threads }
+  }
+
+  const api = { run, parseArgs, DEFAULTS, makeDense, makeCriteo, sliceRows }
+  if (typeof module !== 'undefined' && module.exports) {
+    module.exports = api
+  } else {
+    root.xlearnBench = api
+  }
+})(typeof globalThis !== 'undefined' ? globalThis : this)
@@ -0,0 +1,93 @@
+#!/usr/bin/env node
+// Headless-browser driver for bench/bench.js -- runs the suite against
+// the IIFE bundle (npm run build:browser first) in Chromium via
+// Playwright. Takes the same options as bench/run.js except --threads
+// (the browser bundle is single-threaded).
+
+const { chromium } = require('playwright')
+const path = require('path')
+const http = require('http')
+const fs = require('fs')
+const bench = require('./bench.js')
+
+const ROOT = path.resolve(__dirname, '..')
+const pkg = require(path.join(ROOT, 'package.json'))
+const NAME = pkg.name.split('/').pop()
+
+function makeHtml(bundlePath, opts) {
+  return `<!DOCTYPE html><html><body>
+<script src="${bundlePath}"></script>
+<script src="/bench/bench.js"></script>
+<script>
+window.__benchLog = []
+window.__benchResult = xlearnBench.run(${NAME}, Object.assign(${JSON.stringify(opts)}, {
+  log: function (line) { window.__benchLog.push(line) }
+})).then(function (report) { return { ok: true, report: report } },
+  function (e) { return { ok: false, error: e.message, stack: e.stack } })
+</script></body></html>`
+}
+
+async function main() {
+  const { opts, out } = bench.parseArgs(process.argv.slice(2))
+  const bundle = `dist/${NAME}.js`
+  if (!fs.existsSync(path.join(ROOT, bundle))) {
+    throw new Error(`${bundle} not found -- run npm run build:browser first`)
+  }
+
+  const server = http.createServer((req, res) => {
+    const fp = path.join(ROOT, decodeURIComponent(req.url.slice(1)))
+    if (!fs.existsSync(fp)) { res.writeHead(404); res.end('Not found: ' + req.url); return }
+    const ext = path.extname(fp)
+    const ct = ext === '.html' ? 'text/html' : 'application/javascript'
+    res.writeHead(200, { 'Content-Type': ct })
+    res.end(fs.readFileSync(fp))
+  })
+  await new Promise(r => server.listen(0, '127.0.0.1', r))
+  const base = `http://127.0.0.1:${server.address().port}`
+
+  const htmlName = '_bench.html'
+  const htmlPath = path.join(ROOT, 'dist', htmlName)
+  fs.writeFileSync(htmlPath, makeHtml('/' + bundle, opts))
+
+  const browser = await chromium.launch({ headless: true })
+  let result
+  try {
+    const page = await browser.newPage()
+    const errors = []
+    page.on('pageerror', e => errors.push(e.message))
+    await page.goto(`${base}/dist/${htmlName}`, { timeout: 30000 })
+
+    // Relay progress lines while the suite runs
+    let shown = 0
+    const relay = async () => {
+      const lines = await page.evaluate(() => window.__benchLog || [])
+      for (; shown < lines.length; shown++) process.stderr.write(`  ${lines[shown]}\n`)
+    }
+    const timer = setInterval(() => { relay().catch(() => {}) }, 1000)
+    try {
+      await page.waitForFunction(() => window.__benchResult, { timeout: 30000 })
+      result = await page.evaluate(() => window.__benchResult)
+    } finally {
+      clearInterval(timer)
+    }
+    await relay()
+    if (!result || !result.ok) {
+      const msg = result ? result.error : `no result (${errors.join('; ')})`
+      throw new Error(`browser bench failed: ${msg}`)
+    }
+  } finally {
+    await browser.close()
+    server.close()
+    fs.unlinkSync(htmlPath)
+  }
+
+  const json = JSON.stringify(result.report, null, 2)
+  if (out) {
+    fs.writeFileSync(path.resolve(out), json + '\n')
+    process.stderr.write(`wrote ${out}\n`)
+  } else {
+    process.stdout.write(json + '\n')
+  }
+}
+
+main().catch(e => { console.error(e); process.exit(1) })
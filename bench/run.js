@@ -0,0 +1,26 @@
+#!/usr/bin/env node
+// Node driver for bench/bench.js -- prints progress to stderr and the
+// JSON report to stdout (or --out=FILE). Options: see parseArgs() there.
+
+const fs = require('fs')
+const path = require('path')
+const bench = require('./bench.js')
+const lib = require('../src/index.js')
+
+async function main() {
+  const { opts, out, threads } = bench.parseArgs(process.argv.slice(2))
+  await lib.loadXLearn({ threads })
+  const report = await bench.run(lib, {
+    ...opts,
+    log: (line) => process.stderr.write(`  ${line}\n`)
+  })
+  const json = JSON.stringify(report, null, 2)
+  if (out) {
+    fs.writeFileSync(path.resolve(out), json + '\n')
+    process.stderr.write(`wrote ${out}\n`)
+  } else {
+    process.stdout.write(json + '\n')
+  }
+}
+
+main().catch((e) => { console.error(e); process.exit(1) })
@@ -0,0 +1,154 @@
+/*
+ * eval_metrics.h -- Link function and evaluation metrics over raw scores
+ *
+ * Used by wl_xl_predict_proba and wl_xl_evaluate right after scoring,
+ * on the scores still in the heap, so only the probabilities or a
+ * single metric go back to JS. Labels follow DMatrix conventions:
+ * binary labels are positive for the positive class.
+ *
+ * Accuracy counts in i32x4 lanes; the squared-error sums of RMSE and R2
+ * accumulate in f64x2 lanes (scalar lanes without -msimd128). Sigmoid,
+ * log loss and AUC are scalar: there is no vector exp/log, and AUC
+ * ranks the scores.
+ */
+
+#ifndef WL_XL_EVAL_METRICS_H_
+#define WL_XL_EVAL_METRICS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "simd_wasm.h"
+
+namespace wl_eval {
+
+enum Metric {
+  kAccuracy = 0,
+  kLogLoss = 1,
+  kAUC = 2,
+  kRMSE = 3,
+  kR2 = 4
+};
+
+/* Numerically stable 1 / (1 + exp(-s)) */
+inline double sigmoid(double s) {
+  if (s >= 0) return 1.0 / (1.0 + std::exp(-s));
+  double e = std::exp(s);
+  return e / (1.0 + e);
+}
+
+/* Cross-entropy loss of score s for a label y (> 0: positive) */
+inline double logistic_loss(float s, float y) {
+  double z = (y > 0 ? 1.0 : -1.0) * s;
+  return z > 0 ? std::log1p(std::exp(-z)) : -z + std::log1p(std::exp(z));
+}
+
+/* out[2i] = 1 - p, out[2i + 1] = p with p = sigmoid(scores[i]) */
+inline void proba(const float *scores, size_t n, double *out) {
+  for (size_t i = 0; i < n; ++i) {
+    double p = sigmoid(scores[i]);
+    out[2 * i] = 1.0 - p;
+    out[2 * i + 1] = p;
+  }
+}
+
+/* Rows whose score sign matches the label's (score > 0: positive) */
+inline size_t correct(const float *s, const float *y, size_t n) {
+  size_t wrong = 0, i = 0;
+#ifdef WL_XL_HAVE_SIMD128
+  v128_t zero = wasm_f32x4_splat(0.0f);
+  v128_t acc = wasm_i32x4_splat(0);
+  for (; i + 4 <= n; i += 4) {
+    v128_t ps = wasm_f32x4_gt(wasm_v128_load(s + i), zero);
+    v128_t py = wasm_f32x4_gt(wasm_v128_load(y + i), zero);
+    acc = wasm_i32x4_sub(acc, wasm_v128_xor(ps, py));  /* mask lanes are -1 */
+  }
+  wrong = (size_t)(uint32_t)wasm_i32x4_extract_lane(acc, 0) +
+          (uint32_t)wasm_i32x4_extract_lane(acc, 1) +
+          (uint32_t)wasm_i32x4_extract_lane(acc, 2) +
+          (uint32_t)wasm_i32x4_extract_lane(acc, 3);
+#endif
+  for (; i < n; ++i) wrong += (s[i] > 0) != (y[i] > 0);
+  return n - wrong;
+}
+
+/* sum (a[i] - c[i])^2 in double; c == nullptr: sum (a[i] - mean)^2 */
+inline double sum_sq(const float *a, const float *c, double mean, size_t n) {
+  double sum = 0;
+  size_t i = 0;
+#ifdef WL_XL_HAVE_SIMD128
+  v128_t acc = wasm_f64x2_splat(0.0);
+  v128_t vm = wasm_f64x2_splat(mean);
+  for (; i + 2 <= n; i += 2) {
+    v128_t va = wasm_f64x2_promote_low_f32x4(wasm_v128_load64_zero(a + i));
+    v128_t vc = c ? wasm_f64x2_promote_low_f32x4(wasm_v128_load64_zero(c + i))
+                  : vm;
+    v128_t d = wasm_f64x2_sub(va, vc);
+    acc = wasm_f64x2_add(acc, wasm_f64x2_mul(d, d));
+  }
+  sum = wasm_f64x2_extract_lane(acc, 0) + wasm_f64x2_extract_lane(acc, 1);
+#endif
+  for (; i < n; ++i) {
+    double d = (double)a[i] - (c ? (double)c[i] : mean);
+    sum += d * d;
+  }
+  return sum;
+}
+
+/*
+ * Area under the ROC curve: the Mann-Whitney statistic, with tied
+ * scores counted as half a win. NaN without both classes.
+ */
+inline double auc(const float *s, const float *y, size_t n) {
+  std::vector<std::pair<float, bool>> r(n);
+  for (size_t i = 0; i < n; ++i) r[i] = std::make_pair(s[i], y[i] > 0);
+  std::sort(r.begin(), r.end(),
+            [](const std::pair<float, bool> &a, const std::pair<float, bool> &b) {
+              return a.first < b.first;
+            });
+  double wins = 0, neg_below = 0, pos = 0;
+  for (size_t i = 0; i < n;) {
+    size_t j = i;
+    double p = 0, q = 0;
+    for (; j < n && r[j].first == r[i].first; ++j) (r[j].second ? p : q) += 1;
+    wins += p * (neg_below + 0.5 * q);
+    neg_below += q;
+    pos += p;
+    i = j;
+  }
+  if (pos == 0 || neg_below == 0) return NAN;
+  return wins / (pos * neg_below);
+}
+
+/* metric of scores s against labels y; NaN for n == 0 */
+inline double evaluate(int metric, const float *s, const float *y, size_t n) {
+  if (n == 0) return NAN;
+  switch (metric) {
+    case kAccuracy:
+      return (double)correct(s, y, n) / n;
+    case kLogLoss: {
+      double loss = 0;
+      for (size_t i = 0; i < n; ++i) loss += logistic_loss(s[i], y[i]);
+      return loss / n;
+    }
+    case kAUC:
+      return auc(s, y, n);
+    case kRMSE:
+      return std::sqrt(sum_sq(s, y, 0, n) / n);
+    case kR2: {
+      double mean = 0;
+      for (size_t i = 0; i < n; ++i) mean += y[i];
+      mean /= n;
+      double ss_tot = sum_sq(y, nullptr, mean, n);
+      return ss_tot == 0 ? 0 : 1 - sum_sq(s, y, 0, n) / ss_tot;
+    }
+  }
+  return NAN;
+}
+
+}  // namespace wl_eval
+
+#endif  // WL_XL_EVAL_METRICS_H_
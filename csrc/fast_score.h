@@ -0,0 +1,182 @@
+/*
+ * fast_score.h -- Inference-only LR/FM/FFM scorers specialized at compile time
+ *
+ * The prepared-model predict path (wl_xl_predict_into and friends) calls
+ * one of these per row instead of the virtual Score::CalcScore. Each is
+ * a template on the number of 4-float latent chunks (aligned_k / kAlign)
+ * and the optimizer's aux size, so the per-feature inner loops have a
+ * constant trip count and stride and are fully unrolled.
+ *
+ * The arithmetic is the same, op for op and in the same order, as
+ * fm_score_wasm.cc / ffm_score_wasm.cc and score_wasm.h's linear_score,
+ * so results are bit-identical to those csrc score functions built
+ * alongside them (the training-time kernels), not to upstream's SSE
+ * CalcScore. FFM rows that wl_xl_set_parallel_nnz sends to
+ * ffm_parallel.h's bands are summed in another order and are not
+ * covered. Builds with upstream's SSE score functions do not use this
+ * file.
+ */
+
+#ifndef WL_XL_FAST_SCORE_H_
+#define WL_XL_FAST_SCORE_H_
+
+#include <string>
+
+#include "src/data/data_structure.h"
+#include "src/data/model_parameters.h"
+
+#include "simd_wasm.h"
+#include "wl_build.h"
+
+namespace wl_fast {
+
+using xLearn::index_t;
+using xLearn::real_t;
+using xLearn::SparseRow;
+using namespace wl_simd;
+
+/* Raw weight arrays of a prepared model */
+struct FastModel {
+  const real_t *w;
+  const real_t *v;
+  const real_t *b;
+  index_t num_feat;
+  index_t num_field;
+};
+
+typedef real_t (*FastScoreFn)(const SparseRow *row, const FastModel &m,
+                              real_t norm);
+
+template <int AUX>
+inline real_t linear_term(const SparseRow *row, const FastModel &m) {
+  real_t sum_w = 0;
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= m.num_feat) continue;
+    sum_w += m.w[iter->feat_id * AUX] * iter->feat_val;
+  }
+  return sum_w + m.b[0];
+}
+
+template <int AUX>
+real_t lr_score(const SparseRow *row, const FastModel &m, real_t) {
+  return linear_term<AUX>(row, m);
+}
+
+/* CHUNKS = aligned_k / kAlign */
+template <int CHUNKS, int AUX>
+real_t fm_score(const SparseRow *row, const FastModel &m, real_t norm) {
+  const int kStep = xLearn::kAlign * AUX;
+  const int kAlign0 = CHUNKS * kStep;
+  real_t sum_w = linear_term<AUX>(row, m);
+
+  f32x4 s[CHUNKS];
+  for (int d = 0; d < CHUNKS; ++d) s[d] = splat(0.0f);
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= m.num_feat) continue;
+    const real_t *vj = m.v + iter->feat_id * kAlign0;
+    f32x4 x = splat(iter->feat_val);
+    for (int d = 0; d < CHUNKS; ++d) {
+      s[d] = add(s[d], mul(load(vj + d * kStep), x));
+    }
+  }
+
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= m.num_feat) continue;
+    const real_t *vj = m.v + iter->feat_id * kAlign0;
+    f32x4 x = splat(iter->feat_val);
+    for (int d = 0; d < CHUNKS; ++d) {
+      f32x4 vx = mul(load(vj + d * kStep), x);
+      t = add(t, mul(vx, sub(s[d], vx)));
+    }
+  }
+
+  return sum_w + 0.5f * norm * hsum(t);
+}
+
+template <int CHUNKS, int AUX>
+real_t ffm_score(const SparseRow *row, const FastModel &m, real_t norm) {
+  const int kStep = xLearn::kAlign * AUX;
+  const int kAlign0 = CHUNKS * kStep;
+  index_t align1 = m.num_field * kAlign0;
+  real_t sum_w = linear_term<AUX>(row, m);
+
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter_i = row->begin();
+       iter_i != row->end(); ++iter_i) {
+    index_t j1 = iter_i->feat_id;
+    index_t f1 = iter_i->field_id;
+    if (j1 >= m.num_feat || f1 >= m.num_field) continue;
+    for (SparseRow::const_iterator iter_j = iter_i + 1;
+         iter_j != row->end(); ++iter_j) {
+      index_t j2 = iter_j->feat_id;
+      index_t f2 = iter_j->field_id;
+      if (j2 >= m.num_feat || f2 >= m.num_field) continue;
+      const real_t *w1 = m.v + j1 * align1 + f2 * kAlign0;
+      const real_t *w2 = m.v + j2 * align1 + f1 * kAlign0;
+      f32x4 xx = splat(iter_i->feat_val * iter_j->feat_val * norm);
+      for (int d = 0; d < CHUNKS; ++d) {
+        t = add(t, mul(mul(load(w1 + d * kStep), load(w2 + d * kStep)), xx));
+      }
+    }
+  }
+
+  return sum_w + hsum(t);
+}
+
+/* ---------- selection ---------- */
+
+/* Largest specialized latent size: aligned_k = 32 (k <= 32) */
+static const int kMaxChunks = 8;
+
+template <int AUX, int CHUNKS>
+struct ChunkTable {
+  static FastScoreFn fm(int chunks) {
+    return chunks == CHUNKS ? &fm_score<CHUNKS, AUX>
+                            : ChunkTable<AUX, CHUNKS - 1>::fm(chunks);
+  }
+  static FastScoreFn ffm(int chunks) {
+    return chunks == CHUNKS ? &ffm_score<CHUNKS, AUX>
+                            : ChunkTable<AUX, CHUNKS - 1>::ffm(chunks);
+  }
+};
+
+template <int AUX>
+struct ChunkTable<AUX, 0> {
+  static FastScoreFn fm(int) { return nullptr; }
+  static FastScoreFn ffm(int) { return nullptr; }
+};
+
+template <int AUX>
+FastScoreFn select_for_aux(const std::string &score_func, int chunks) {
+  if (WL_XL_HAS_LINEAR && score_func == "linear") return &lr_score<AUX>;
+  if (WL_XL_HAS_FM && score_func == "fm") {
+    return ChunkTable<AUX, kMaxChunks>::fm(chunks);
+  }
+  if (WL_XL_HAS_FFM && score_func == "ffm") {
+    return ChunkTable<AUX, kMaxChunks>::ffm(chunks);
+  }
+  return nullptr;
+}
+
+/*
+ * Specialized scorer for a model, or nullptr if its shape is not
+ * covered (callers then use the model's Score::CalcScore).
+ */
+inline FastScoreFn select(const std::string &score_func,
+                          index_t aligned_k, index_t aux_size) {
+  int chunks = (int)(aligned_k / xLearn::kAlign);
+  switch (aux_size) {
+    case 1: return select_for_aux<1>(score_func, chunks);
+    case 2: return select_for_aux<2>(score_func, chunks);
+    case 3: return select_for_aux<3>(score_func, chunks);
+    default: return nullptr;
+  }
+}
+
+}  // namespace wl_fast
+
+#endif  // WL_XL_FAST_SCORE_H_
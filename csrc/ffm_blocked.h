@@ -0,0 +1,337 @@
+/*
+ * ffm_blocked.h -- FFM weights in a blocked, weights-only layout
+ *
+ * Upstream stores each latent vector v_{j,f} as aligned_k floats in
+ * chunks of kAlign, every chunk followed by its optimizer state, so a
+ * pairwise interaction touches aux_size times the bytes it reads. A
+ * BlockedFFM keeps the same (feature, field) blocks weights-only and
+ * 16-byte aligned, with the optimizer state split out into aux_size - 1
+ * planes of the same shape (SoA). Linear weights and bias keep
+ * upstream's interleaved layout; they are read once per active feature.
+ *
+ * Scoring gathers, for every active entry of a row, the blocks of the
+ * fields present in the row into a contiguous tile before the O(nnz^2)
+ * interaction loop, so the loop only reads the tile. Scores and updates
+ * use the same operations, in the same order, as ffm_score_wasm.cc, and
+ * from_model / to_model are exact inverses, so a model converts to and
+ * from upstream's layout (and blob) without loss.
+ */
+
+#ifndef WL_XL_FFM_BLOCKED_H_
+#define WL_XL_FFM_BLOCKED_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "src/data/data_structure.h"
+#include "src/data/model_parameters.h"
+
+#include "simd_wasm.h"
+
+namespace wl_ffm {
+
+using xLearn::index_t;
+using xLearn::real_t;
+using xLearn::SparseRow;
+using namespace wl_simd;
+
+/* Largest tile (floats) gathered per row; longer rows read the blocks */
+static const size_t kMaxTileFloats = 1 << 16;
+
+/* 16-byte aligned float array */
+struct AlignedFloats {
+  real_t *data = nullptr;
+  size_t size = 0;
+
+  AlignedFloats() {}
+  AlignedFloats(const AlignedFloats &) = delete;
+  AlignedFloats &operator=(const AlignedFloats &) = delete;
+  ~AlignedFloats() { free(data); }
+
+  bool resize(size_t n) {
+    free(data);
+    data = nullptr;
+    size = 0;
+    void *p = nullptr;
+    if (posix_memalign(&p, 16, (n ? n : 1) * sizeof(real_t)) != 0) return false;
+    data = (real_t *)p;
+    size = n;
+    return true;
+  }
+};
+
+struct BlockedFFM {
+  std::string loss_func;
+  index_t num_feat = 0;
+  index_t num_field = 0;
+  index_t num_K = 0;
+  index_t aligned_k = 0;
+  index_t aux_size = 0;
+  std::vector<real_t> w;   /* num_feat * aux_size, upstream layout */
+  std::vector<real_t> b;   /* aux_size */
+  AlignedFloats v;         /* num_feat * num_field blocks of aligned_k */
+  AlignedFloats state;     /* aux_size - 1 planes shaped like v */
+
+  BlockedFFM() {}
+  BlockedFFM(const BlockedFFM &) = delete;
+  BlockedFFM &operator=(const BlockedFFM &) = delete;
+
+  size_t num_v() const { return (size_t)num_feat * num_field * aligned_k; }
+
+  real_t *block(index_t j, index_t f) {
+    return v.data + ((size_t)j * num_field + f) * aligned_k;
+  }
+  const real_t *block(index_t j, index_t f) const {
+    return v.data + ((size_t)j * num_field + f) * aligned_k;
+  }
+};
+
+/* ---------- conversion ---------- */
+
+/*
+ * Copy block n (aligned_k weights, then state) between upstream's
+ * interleaved chunks at src/dst and the split planes of m.
+ */
+inline void unpack_block(BlockedFFM &m, size_t n, const real_t *src) {
+  index_t k = m.aligned_k;
+  size_t nv = m.num_v();
+  for (index_t c = 0; c < k; c += xLearn::kAlign) {
+    const real_t *chunk = src + (size_t)c * m.aux_size;
+    memcpy(m.v.data + n * k + c, chunk, sizeof(real_t) * xLearn::kAlign);
+    for (index_t s = 1; s < m.aux_size; ++s) {
+      memcpy(m.state.data + (s - 1) * nv + n * k + c,
+             chunk + s * xLearn::kAlign, sizeof(real_t) * xLearn::kAlign);
+    }
+  }
+}
+
+inline void pack_block(const BlockedFFM &m, size_t n, real_t *dst) {
+  index_t k = m.aligned_k;
+  size_t nv = m.num_v();
+  for (index_t c = 0; c < k; c += xLearn::kAlign) {
+    real_t *chunk = dst + (size_t)c * m.aux_size;
+    memcpy(chunk, m.v.data + n * k + c, sizeof(real_t) * xLearn::kAlign);
+    for (index_t s = 1; s < m.aux_size; ++s) {
+      memcpy(chunk + s * xLearn::kAlign,
+             m.state.data + (s - 1) * nv + n * k + c,
+             sizeof(real_t) * xLearn::kAlign);
+    }
+  }
+}
+
+/* Blocked copy of an FFM model; false if allocation fails */
+inline bool from_model(xLearn::Model &model, BlockedFFM &m) {
+  m.loss_func = model.GetLossFunction();
+  m.num_feat = model.GetNumFeature();
+  m.num_field = model.GetNumField();
+  m.num_K = model.GetNumK();
+  m.aligned_k = model.get_aligned_k();
+  m.aux_size = model.GetAuxiliarySize();
+  const real_t *w = model.GetParameter_w();
+  m.w.assign(w, w + model.GetNumParameter_w());
+  m.b.assign(model.GetParameter_b(), model.GetParameter_b() + m.aux_size);
+
+  size_t nv = m.num_v();
+  if (!m.v.resize(nv) || !m.state.resize(nv * (m.aux_size - 1))) return false;
+  const real_t *v = model.GetParameter_v();
+  size_t src_block = (size_t)m.aux_size * m.aligned_k;
+  size_t nb = (size_t)m.num_feat * m.num_field;
+  for (size_t n = 0; n < nb; ++n) unpack_block(m, n, v + n * src_block);
+  return true;
+}
+
+/* Upstream model holding exactly m's weights and optimizer state */
+inline xLearn::Model *to_model(const BlockedFFM &m) {
+  xLearn::Model *model = new xLearn::Model();
+  model->Initialize("ffm", m.loss_func, m.num_feat, m.num_field, m.num_K,
+                    m.aux_size);
+  memcpy(model->GetParameter_w(), m.w.data(), sizeof(real_t) * m.w.size());
+  memcpy(model->GetParameter_b(), m.b.data(), sizeof(real_t) * m.aux_size);
+  real_t *v = model->GetParameter_v();
+  size_t dst_block = (size_t)m.aux_size * m.aligned_k;
+  size_t nb = (size_t)m.num_feat * m.num_field;
+  for (size_t n = 0; n < nb; ++n) pack_block(m, n, v + n * dst_block);
+  return model;
+}
+
+/* ---------- scoring ---------- */
+
+inline real_t linear_term(const SparseRow *row, const BlockedFFM &m) {
+  real_t sum_w = 0;
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= m.num_feat) continue;
+    sum_w += m.w[iter->feat_id * m.aux_size] * iter->feat_val;
+  }
+  return sum_w + m.b[0];
+}
+
+/* Interactions reading the blocks in place (rows too long to tile) */
+inline f32x4 pairs_direct(const SparseRow *row, const BlockedFFM &m,
+                          real_t norm) {
+  index_t k = m.aligned_k;
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter_i = row->begin();
+       iter_i != row->end(); ++iter_i) {
+    index_t j1 = iter_i->feat_id;
+    index_t f1 = iter_i->field_id;
+    if (j1 >= m.num_feat || f1 >= m.num_field) continue;
+    for (SparseRow::const_iterator iter_j = iter_i + 1;
+         iter_j != row->end(); ++iter_j) {
+      index_t j2 = iter_j->feat_id;
+      index_t f2 = iter_j->field_id;
+      if (j2 >= m.num_feat || f2 >= m.num_field) continue;
+      const real_t *w1 = m.block(j1, f2);
+      const real_t *w2 = m.block(j2, f1);
+      f32x4 xx = splat(iter_i->feat_val * iter_j->feat_val * norm);
+      for (index_t d = 0; d < k; d += xLearn::kAlign) {
+        t = add(t, mul(mul(load(w1 + d), load(w2 + d)), xx));
+      }
+    }
+  }
+  return t;
+}
+
+/* Per-thread gather buffers, sized by the longest row seen */
+struct Tile {
+  std::vector<const xLearn::Node *> nodes;  /* active entries */
+  std::vector<int> slot;                    /* field -> tile slot, -1 */
+  std::vector<index_t> fields;              /* slot -> field */
+  std::vector<real_t> buf;                  /* nodes x slots x aligned_k */
+};
+
+inline real_t score(const SparseRow *row, const BlockedFFM &m, real_t norm) {
+  real_t sum_w = linear_term(row, m);
+  index_t k = m.aligned_k;
+
+  thread_local Tile tile;
+  tile.nodes.clear();
+  tile.fields.clear();
+  if (tile.slot.size() < m.num_field) tile.slot.resize(m.num_field, -1);
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= m.num_feat || iter->field_id >= m.num_field) continue;
+    tile.nodes.push_back(&*iter);
+    if (tile.slot[iter->field_id] < 0) {
+      tile.slot[iter->field_id] = (int)tile.fields.size();
+      tile.fields.push_back(iter->field_id);
+    }
+  }
+
+  size_t nn = tile.nodes.size(), ns = tile.fields.size();
+  f32x4 t = splat(0.0f);
+  if (nn * ns * k > kMaxTileFloats) {
+    t = pairs_direct(row, m, norm);
+  } else {
+    /* tile[i][s] = v_{j_i, fields[s]} */
+    tile.buf.resize(nn * ns * k);
+    real_t *dst = tile.buf.data();
+    for (size_t i = 0; i < nn; ++i) {
+      for (size_t s = 0; s < ns; ++s, dst += k) {
+        memcpy(dst, m.block(tile.nodes[i]->feat_id, tile.fields[s]),
+               sizeof(real_t) * k);
+      }
+    }
+    const real_t *base = tile.buf.data();
+    for (size_t i = 0; i < nn; ++i) {
+      const xLearn::Node *a = tile.nodes[i];
+      const real_t *row_i = base + i * ns * k;
+      size_t s1 = (size_t)tile.slot[a->field_id];
+      for (size_t jj = i + 1; jj < nn; ++jj) {
+        const xLearn::Node *c = tile.nodes[jj];
+        const real_t *w1 = row_i + (size_t)tile.slot[c->field_id] * k;
+        const real_t *w2 = base + (jj * ns + s1) * k;
+        f32x4 xx = splat(a->feat_val * c->feat_val * norm);
+        for (index_t d = 0; d < k; d += xLearn::kAlign) {
+          t = add(t, mul(mul(load(w1 + d), load(w2 + d)), xx));
+        }
+      }
+    }
+  }
+  for (size_t s = 0; s < ns; ++s) tile.slot[tile.fields[s]] = -1;
+
+  return sum_w + hsum(t);
+}
+
+/* ---------- training ---------- */
+
+/*
+ * Opt::update4 on the chunk at w whose state lives in the planes: the
+ * chunk and its state are staged in upstream's interleaved order so the
+ * update rule (and its rounding) is the one the score functions use.
+ */
+template <class Opt>
+inline void update4_split(BlockedFFM &m, real_t *w, f32x4 grad,
+                          const OptParams &p) {
+  real_t tmp[3 * xLearn::kAlign];
+  size_t off = (size_t)(w - m.v.data);
+  size_t nv = m.num_v();
+  memcpy(tmp, w, sizeof(real_t) * xLearn::kAlign);
+  for (index_t s = 1; s < m.aux_size; ++s) {
+    memcpy(tmp + s * xLearn::kAlign, m.state.data + (s - 1) * nv + off,
+           sizeof(real_t) * xLearn::kAlign);
+  }
+  Opt::update4(tmp, grad, p);
+  memcpy(w, tmp, sizeof(real_t) * xLearn::kAlign);
+  for (index_t s = 1; s < m.aux_size; ++s) {
+    memcpy(m.state.data + (s - 1) * nv + off, tmp + s * xLearn::kAlign,
+           sizeof(real_t) * xLearn::kAlign);
+  }
+}
+
+/* One SGD-style step on row (same order as FFMScore::CalcGrad) */
+template <class Opt>
+void update(const SparseRow *row, BlockedFFM &m, real_t pg, real_t norm,
+            const OptParams &p) {
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= m.num_feat) continue;
+    Opt::update(&m.w[iter->feat_id * m.aux_size], pg * iter->feat_val, p);
+  }
+  /* bias is not regularized */
+  OptParams pb = p;
+  pb.lambda = 0.0f;
+  pb.lambda_1 = 0.0f;
+  pb.lambda_2 = 0.0f;
+  Opt::update(m.b.data(), pg, pb);
+
+  index_t k = m.aligned_k;
+  for (SparseRow::const_iterator iter_i = row->begin();
+       iter_i != row->end(); ++iter_i) {
+    index_t j1 = iter_i->feat_id;
+    index_t f1 = iter_i->field_id;
+    if (j1 >= m.num_feat || f1 >= m.num_field) continue;
+    for (SparseRow::const_iterator iter_j = iter_i + 1;
+         iter_j != row->end(); ++iter_j) {
+      index_t j2 = iter_j->feat_id;
+      index_t f2 = iter_j->field_id;
+      if (j2 >= m.num_feat || f2 >= m.num_field) continue;
+      real_t *w1 = m.block(j1, f2);
+      real_t *w2 = m.block(j2, f1);
+      f32x4 pgv = splat(pg * norm * iter_i->feat_val * iter_j->feat_val);
+      for (index_t d = 0; d < k; d += xLearn::kAlign) {
+        f32x4 a = load(w1 + d);
+        f32x4 b = load(w2 + d);
+        update4_split<Opt>(m, w1 + d, mul(pgv, b), p);
+        update4_split<Opt>(m, w2 + d, mul(pgv, a), p);
+      }
+    }
+  }
+}
+
+typedef void (*UpdateFn)(const SparseRow *row, BlockedFFM &m, real_t pg,
+                         real_t norm, const OptParams &p);
+
+/* update<Opt> for an optimizer name, or nullptr if it is unknown */
+inline UpdateFn select_update(const std::string &opt_type) {
+  if (opt_type == "sgd") return &update<SGD>;
+  if (opt_type == "adagrad") return &update<AdaGrad>;
+  if (opt_type == "ftrl") return &update<FTRL>;
+  return nullptr;
+}
+
+}  // namespace wl_ffm
+
+#endif  // WL_XL_FFM_BLOCKED_H_
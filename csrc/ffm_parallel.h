@@ -0,0 +1,158 @@
+/*
+ * ffm_parallel.h -- Intra-row parallel FFM scoring for very wide rows
+ *
+ * A row with n active entries has n(n-1)/2 pairwise interactions, so a
+ * single request of a few thousand features dominates scoring time and
+ * splitting work by row range cannot help it. Such rows are scored by
+ * cutting the interaction triangle into bands of consecutive outer
+ * entries i (each pairing i with every later entry), of about
+ * kPairsPerBand pairs each. Bands are computed independently, on a
+ * ThreadPool and the calling thread, into per-band partial sums that
+ * are then added in band order.
+ *
+ * Bands depend only on the row, never on the number of threads, so a
+ * wide row scores the same with 1 or N threads and in both builds.
+ * Inside a band the loop is ffm_score_wasm.cc's; only the additions
+ * across bands are regrouped, so a wide row's score can differ from the
+ * serial kernel's in the last bits. That is why banding is opt-in
+ * (wl_xl_set_parallel_nnz).
+ */
+
+#ifndef WL_XL_FFM_PARALLEL_H_
+#define WL_XL_FFM_PARALLEL_H_
+
+#include <algorithm>
+#include <future>
+#include <vector>
+
+#include "src/base/thread_pool.h"
+#include "src/data/data_structure.h"
+#include "src/data/model_parameters.h"
+
+#include "simd_wasm.h"
+
+namespace wl_par {
+
+using xLearn::index_t;
+using xLearn::real_t;
+using xLearn::SparseRow;
+using namespace wl_simd;
+
+/* Interactions per band (one task's work) */
+static const size_t kPairsPerBand = 1 << 15;
+
+/*
+ * Weights of an FFM model in either layout: v_{j,f} starts at
+ * v + j * feat_stride + f * field_stride and its kAlign-float chunks
+ * are chunk_stride floats apart (kAlign * aux_size upstream, kAlign for
+ * the blocked layout). Linear weights are w_stride floats apart.
+ */
+struct FFMView {
+  const real_t *w = nullptr;
+  const real_t *v = nullptr;
+  const real_t *b = nullptr;
+  index_t num_feat = 0;
+  index_t num_field = 0;
+  index_t aligned_k = 0;
+  size_t w_stride = 1;
+  size_t feat_stride = 0;
+  size_t field_stride = 0;
+  size_t chunk_stride = 0;
+
+  const real_t *vec(index_t j, index_t f) const {
+    return v + j * feat_stride + f * field_stride;
+  }
+};
+
+/* Per-call buffers, reused across the wide rows of one batch */
+struct Work {
+  std::vector<const xLearn::Node *> nodes;  /* active entries */
+  std::vector<size_t> bands;                /* band starts, then n */
+  std::vector<real_t> partial;              /* 4 floats per band */
+};
+
+/* Split entries [0, n) into bands of about kPairsPerBand pairs */
+inline void cut_bands(size_t n, std::vector<size_t> &bands) {
+  bands.clear();
+  bands.push_back(0);
+  size_t pairs = 0;
+  for (size_t i = 0; i + 1 < n; ++i) {
+    pairs += n - 1 - i;
+    if (pairs >= kPairsPerBand && i + 2 < n) {
+      bands.push_back(i + 1);
+      pairs = 0;
+    }
+  }
+  bands.push_back(n);
+}
+
+/* Interactions of outer entries [i0, i1) with every later entry */
+inline f32x4 band_pairs(const xLearn::Node *const *nodes, size_t n,
+                        size_t i0, size_t i1, const FFMView &m,
+                        real_t norm) {
+  f32x4 t = splat(0.0f);
+  for (size_t i = i0; i < i1; ++i) {
+    const xLearn::Node *a = nodes[i];
+    for (size_t j = i + 1; j < n; ++j) {
+      const xLearn::Node *c = nodes[j];
+      const real_t *w1 = m.vec(a->feat_id, c->field_id);
+      const real_t *w2 = m.vec(c->feat_id, a->field_id);
+      f32x4 xx = splat(a->feat_val * c->feat_val * norm);
+      for (index_t d = 0; d < m.aligned_k; d += xLearn::kAlign) {
+        size_t off = (d / xLearn::kAlign) * m.chunk_stride;
+        t = add(t, mul(mul(load(w1 + off), load(w2 + off)), xx));
+      }
+    }
+  }
+  return t;
+}
+
+/* Bands first, first + step, ... into their partial sums */
+inline void run_bands(Work &wk, size_t first, size_t step,
+                      const FFMView &m, real_t norm) {
+  size_t n = wk.nodes.size();
+  size_t nb = wk.bands.size() - 1;
+  for (size_t b = first; b < nb; b += step) {
+    store(wk.partial.data() + 4 * b,
+          band_pairs(wk.nodes.data(), n, wk.bands[b], wk.bands[b + 1], m, norm));
+  }
+}
+
+/*
+ * Score one row, spreading its bands over pool's threads and the
+ * calling thread (pool may be null: all bands run inline).
+ */
+inline real_t score(const SparseRow *row, const FFMView &m, real_t norm,
+                    ThreadPool *pool, Work &wk) {
+  real_t sum_w = 0;
+  wk.nodes.clear();
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= m.num_feat) continue;
+    sum_w += m.w[iter->feat_id * m.w_stride] * iter->feat_val;
+    if (iter->field_id < m.num_field) wk.nodes.push_back(&*iter);
+  }
+  sum_w += m.b[0];
+
+  cut_bands(wk.nodes.size(), wk.bands);
+  size_t nb = wk.bands.size() - 1;
+  wk.partial.resize(4 * nb);
+
+  size_t tasks = pool ? std::min(pool->ThreadNumber() + 1, nb) : 1;
+  std::vector<std::future<void>> done;
+  for (size_t t = 1; t < tasks; ++t) {
+    done.push_back(pool->enqueue([&wk, t, tasks, &m, norm]() {
+      run_bands(wk, t, tasks, m, norm);
+    }));
+  }
+  run_bands(wk, 0, tasks, m, norm);
+  for (std::future<void> &f : done) f.get();
+
+  f32x4 t = load(wk.partial.data());
+  for (size_t b = 1; b < nb; ++b) t = add(t, load(wk.partial.data() + 4 * b));
+  return sum_w + hsum(t);
+}
+
+}  // namespace wl_par
+
+#endif  // WL_XL_FFM_PARALLEL_H_
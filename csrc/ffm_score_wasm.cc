@@ -0,0 +1,112 @@
+/*
+ * ffm_score_wasm.cc -- WASM SIMD replacement for upstream ffm_score.cc
+ *
+ * Implements xLearn::FFMScore (declared in upstream src/score/ffm_score.h)
+ * with wasm_simd128 kernels from simd_wasm.h. Selected at build time by
+ * scripts/build-wasm.sh (SCORE_KERNELS=simd128, the default).
+ *
+ *   score = sum_i w_i x_i + b
+ *         + norm * sum_{i<j} <v_{i,f_j}, v_{j,f_i}> x_i x_j
+ */
+
+#include "src/score/ffm_score.h"
+
+#include "score_wasm.h"
+
+namespace xLearn {
+
+using namespace wl_simd;
+
+real_t FFMScore::CalcScore(const SparseRow* row,
+                           Model& model,
+                           real_t norm) {
+  real_t sum_w = linear_score(row, model);
+
+  index_t num_feat = model.GetNumFeature();
+  index_t num_field = model.GetNumField();
+  index_t align0 = model.GetAuxiliarySize() * model.get_aligned_k();
+  index_t align1 = num_field * align0;
+  index_t step = kAlign * model.GetAuxiliarySize();
+  const real_t *v = model.GetParameter_v();
+
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter_i = row->begin();
+       iter_i != row->end(); ++iter_i) {
+    index_t j1 = iter_i->feat_id;
+    index_t f1 = iter_i->field_id;
+    if (j1 >= num_feat || f1 >= num_field) continue;
+    for (SparseRow::const_iterator iter_j = iter_i + 1;
+         iter_j != row->end(); ++iter_j) {
+      index_t j2 = iter_j->feat_id;
+      index_t f2 = iter_j->field_id;
+      if (j2 >= num_feat || f2 >= num_field) continue;
+      const real_t *w1 = v + j1 * align1 + f2 * align0;
+      const real_t *w2 = v + j2 * align1 + f1 * align0;
+      f32x4 xx = splat(iter_i->feat_val * iter_j->feat_val * norm);
+      for (index_t c = 0; c < align0; c += step) {
+        t = add(t, mul(mul(load(w1 + c), load(w2 + c)), xx));
+      }
+    }
+  }
+
+  return sum_w + hsum(t);
+}
+
+namespace {
+
+/* d score / d v_{i,f_j} = norm * x_i x_j * v_{j,f_i} (and symmetric) */
+struct FFMGrad {
+  const SparseRow *row;
+  Model *model;
+  real_t pg;
+  real_t norm;
+  OptParams p;
+
+  template <class Opt>
+  void run() {
+    update_linear<Opt>(row, *model, pg, p);
+
+    index_t num_feat = model->GetNumFeature();
+    index_t num_field = model->GetNumField();
+    index_t align0 = model->GetAuxiliarySize() * model->get_aligned_k();
+    index_t align1 = num_field * align0;
+    index_t step = kAlign * model->GetAuxiliarySize();
+    real_t *v = model->GetParameter_v();
+
+    for (SparseRow::const_iterator iter_i = row->begin();
+         iter_i != row->end(); ++iter_i) {
+      index_t j1 = iter_i->feat_id;
+      index_t f1 = iter_i->field_id;
+      if (j1 >= num_feat || f1 >= num_field) continue;
+      for (SparseRow::const_iterator iter_j = iter_i + 1;
+           iter_j != row->end(); ++iter_j) {
+        index_t j2 = iter_j->feat_id;
+        index_t f2 = iter_j->field_id;
+        if (j2 >= num_feat || f2 >= num_field) continue;
+        real_t *w1 = v + j1 * align1 + f2 * align0;
+        real_t *w2 = v + j2 * align1 + f1 * align0;
+        f32x4 pgv = splat(pg * norm * iter_i->feat_val * iter_j->feat_val);
+        for (index_t c = 0; c < align0; c += step) {
+          f32x4 a = load(w1 + c);
+          f32x4 b = load(w2 + c);
+          Opt::update4(w1 + c, mul(pgv, b), p);
+          Opt::update4(w2 + c, mul(pgv, a), p);
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
+void FFMScore::CalcGrad(const SparseRow* row,
+                        Model& model,
+                        real_t pg,
+                        real_t norm) {
+  FFMGrad fn = { row, &model, pg, norm,
+                 { learning_rate_, regu_lambda_, alpha_, beta_,
+                   lambda_1_, lambda_2_ } };
+  dispatch_opt(opt_type_, fn);
+}
+
+}  // namespace xLearn
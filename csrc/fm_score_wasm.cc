@@ -0,0 +1,128 @@
+/*
+ * fm_score_wasm.cc -- WASM SIMD replacement for upstream fm_score.cc
+ *
+ * Implements xLearn::FMScore (declared in upstream src/score/fm_score.h)
+ * with wasm_simd128 kernels from simd_wasm.h instead of SSE intrinsics
+ * going through Emscripten's emulation headers. Selected at build time
+ * by scripts/build-wasm.sh (SCORE_KERNELS=simd128, the default).
+ *
+ *   score = sum_i w_i x_i + b
+ *         + 0.5 * norm * (|s|^2 - sum_i |v_i x_i|^2),  s = sum_i v_i x_i
+ */
+
+#include <vector>
+
+#include "src/score/fm_score.h"
+
+#include "score_wasm.h"
+
+namespace xLearn {
+
+using namespace wl_simd;
+
+/* s = sum_i v_i x_i over the features of row, aligned_k floats */
+static void fm_sum_v(const SparseRow *row, Model &model, real_t *s) {
+  index_t num_feat = model.GetNumFeature();
+  index_t aligned_k = model.get_aligned_k();
+  index_t align0 = model.GetAuxiliarySize() * aligned_k;
+  index_t step = kAlign * model.GetAuxiliarySize();
+  real_t *v = model.GetParameter_v();
+
+  for (index_t d = 0; d < aligned_k; d += kAlign) {
+    store(s + d, splat(0.0f));
+  }
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= num_feat) continue;
+    const real_t *vj = v + iter->feat_id * align0;
+    f32x4 x = splat(iter->feat_val);
+    for (index_t d = 0, c = 0; d < aligned_k; d += kAlign, c += step) {
+      store(s + d, add(load(s + d), mul(load(vj + c), x)));
+    }
+  }
+}
+
+real_t FMScore::CalcScore(const SparseRow* row,
+                          Model& model,
+                          real_t norm) {
+  real_t sum_w = linear_score(row, model);
+
+  index_t num_feat = model.GetNumFeature();
+  index_t aligned_k = model.get_aligned_k();
+  index_t align0 = model.GetAuxiliarySize() * aligned_k;
+  index_t step = kAlign * model.GetAuxiliarySize();
+  real_t *v = model.GetParameter_v();
+
+  thread_local std::vector<real_t> sv;
+  sv.resize(aligned_k);
+  real_t *s = sv.data();
+  fm_sum_v(row, model, s);
+
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= num_feat) continue;
+    const real_t *vj = v + iter->feat_id * align0;
+    f32x4 x = splat(iter->feat_val);
+    for (index_t d = 0, c = 0; d < aligned_k; d += kAlign, c += step) {
+      f32x4 vx = mul(load(vj + c), x);
+      t = add(t, mul(vx, sub(load(s + d), vx)));
+    }
+  }
+
+  return sum_w + 0.5f * norm * hsum(t);
+}
+
+namespace {
+
+/* d score / d v_i = norm * x_i * (s - v_i x_i) */
+struct FMGrad {
+  const SparseRow *row;
+  Model *model;
+  real_t pg;
+  real_t norm;
+  OptParams p;
+
+  template <class Opt>
+  void run() {
+    update_linear<Opt>(row, *model, pg, p);
+
+    index_t num_feat = model->GetNumFeature();
+    index_t aligned_k = model->get_aligned_k();
+    index_t align0 = model->GetAuxiliarySize() * aligned_k;
+    index_t step = kAlign * model->GetAuxiliarySize();
+    real_t *v = model->GetParameter_v();
+
+    /* s is taken before any update, as in the score */
+    thread_local std::vector<real_t> sv;
+    sv.resize(aligned_k);
+    real_t *s = sv.data();
+    fm_sum_v(row, *model, s);
+
+    for (SparseRow::const_iterator iter = row->begin();
+         iter != row->end(); ++iter) {
+      if (iter->feat_id >= num_feat) continue;
+      real_t *vj = v + iter->feat_id * align0;
+      f32x4 x = splat(iter->feat_val);
+      f32x4 pgx = splat(pg * norm * iter->feat_val);
+      for (index_t d = 0, c = 0; d < aligned_k; d += kAlign, c += step) {
+        f32x4 g = mul(pgx, sub(load(s + d), mul(load(vj + c), x)));
+        Opt::update4(vj + c, g, p);
+      }
+    }
+  }
+};
+
+}  // namespace
+
+void FMScore::CalcGrad(const SparseRow* row,
+                       Model& model,
+                       real_t pg,
+                       real_t norm) {
+  FMGrad fn = { row, &model, pg, norm,
+                { learning_rate_, regu_lambda_, alpha_, beta_,
+                  lambda_1_, lambda_2_ } };
+  dispatch_opt(opt_type_, fn);
+}
+
+}  // namespace xLearn
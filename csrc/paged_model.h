@@ -0,0 +1,277 @@
+/*
+ * paged_model.h -- Inference-only LR/FM/FFM models paged in on demand
+ *
+ * A PagedModel is the weight table of a model split into pages of
+ * block_feats consecutive features. Only the page table is parsed at
+ * load time; the JS side reads a page's bytes from the backing file
+ * (Node fd, Blob slice) into the buffer page_in() returns, right before
+ * a batch that touches it is scored. At most max_resident pages are
+ * kept, evicting the least recently used one not needed by the batch
+ * being scored.
+ *
+ * A page of n features holds fp32 w[n], then each feature's latent
+ * weights without optimizer state (aligned_k floats for FM, num_field
+ * blocks of aligned_k for FFM), contiguous.
+ */
+
+#ifndef WL_XL_PAGED_MODEL_H_
+#define WL_XL_PAGED_MODEL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "src/data/data_structure.h"
+#include "src/data/model_parameters.h"
+
+#include "simd_wasm.h"
+#include "wl_build.h"
+
+namespace wl_paged {
+
+using xLearn::index_t;
+using xLearn::real_t;
+using xLearn::SparseRow;
+using namespace wl_simd;
+
+struct Page {
+  uint32_t offset = 0;     /* byte offset of the page in the paged blob */
+  uint32_t length = 0;     /* bytes */
+  real_t *data = nullptr;  /* resident copy, or nullptr */
+  uint32_t last_use = 0;   /* batch tick that last touched the page */
+};
+
+struct PagedModel {
+  enum Kind { kLinear, kFM, kFFM };
+
+  std::string score_func;
+  Kind kind = kLinear;
+  index_t num_feat = 0;
+  index_t num_field = 0;
+  index_t num_K = 0;
+  index_t aligned_k = 0;
+  index_t block_feats = 0;
+  real_t b = 0;
+  std::vector<Page> pages;
+  size_t max_resident = 0;  /* 0: no limit */
+  size_t resident = 0;
+  uint32_t tick = 0;
+  uint32_t page_ins = 0;
+
+  PagedModel() {}
+  PagedModel(const PagedModel &) = delete;
+  PagedModel &operator=(const PagedModel &) = delete;
+  ~PagedModel() {
+    for (Page &p : pages) free(p.data);
+  }
+
+  /* Set score_func and kind; false if it is not linear/fm/ffm */
+  bool set_score_func(const std::string &name) {
+    score_func = name;
+    if (WL_XL_HAS_LINEAR && name == "linear") kind = kLinear;
+    else if (WL_XL_HAS_FM && name == "fm") kind = kFM;
+    else if (WL_XL_HAS_FFM && name == "ffm") kind = kFFM;
+    else return false;
+    return true;
+  }
+
+  /* Latent floats per feature */
+  index_t latent_size() const {
+    if (kind == kFM) return aligned_k;
+    if (kind == kFFM) return num_field * aligned_k;
+    return 0;
+  }
+
+  index_t num_pages() const {
+    return block_feats ? (num_feat + block_feats - 1) / block_feats : 0;
+  }
+
+  /* Features on page p (the last page may be short) */
+  index_t page_feats(index_t p) const {
+    index_t first = p * block_feats;
+    return std::min(block_feats, num_feat - first);
+  }
+
+  size_t page_bytes(index_t p) const {
+    return sizeof(real_t) * (size_t)page_feats(p) * (1 + latent_size());
+  }
+
+  /* Weights of feature j (its page must be resident) */
+  real_t w(index_t j) const {
+    return pages[j / block_feats].data[j % block_feats];
+  }
+
+  const real_t *v(index_t j) const {
+    index_t p = j / block_feats;
+    return pages[p].data + page_feats(p)
+           + (size_t)(j % block_feats) * latent_size();
+  }
+};
+
+/* ---------- page layout ---------- */
+
+/*
+ * Write the page holding features [first, first + count) of a trained
+ * model into dst (count * (1 + latent_size) floats), dropping the
+ * optimizer state that follows each weight and latent chunk.
+ */
+inline void fill_page(xLearn::Model &model, const PagedModel &pm,
+                      index_t first, index_t count, real_t *dst) {
+  index_t aux = model.GetAuxiliarySize();
+  index_t step = xLearn::kAlign * aux;
+  index_t k = pm.aligned_k;
+  index_t blocks = pm.kind == PagedModel::kFFM ? pm.num_field : 1;
+  const real_t *w = model.GetParameter_w();
+  const real_t *v = model.GetParameter_v();
+
+  for (index_t l = 0; l < count; ++l) dst[l] = w[(first + l) * aux];
+  real_t *out = dst + count;
+  for (index_t l = 0; l < count && k > 0; ++l) {
+    for (index_t f = 0; f < blocks; ++f) {
+      const real_t *src = v + ((size_t)(first + l) * blocks + f) * aux * k;
+      for (index_t d = 0; d < k; ++d) {
+        *out++ = src[(d / xLearn::kAlign) * step + d % xLearn::kAlign];
+      }
+    }
+  }
+}
+
+/* ---------- residency ---------- */
+
+/*
+ * Start a batch over rows: every page they touch is marked as used by
+ * it (so page_in() will not evict it), and the non-resident ones are
+ * appended to missing.
+ */
+inline void begin_batch(PagedModel &pm, const xLearn::DMatrix &dm,
+                        std::vector<index_t> &missing) {
+  ++pm.tick;
+  for (size_t i = 0; i < dm.row_length; ++i) {
+    const SparseRow *row = dm.row[i];
+    for (SparseRow::const_iterator iter = row->begin();
+         iter != row->end(); ++iter) {
+      if (iter->feat_id >= pm.num_feat) continue;
+      Page &p = pm.pages[iter->feat_id / pm.block_feats];
+      if (p.last_use == pm.tick) continue;
+      p.last_use = pm.tick;
+      if (!p.data) missing.push_back(iter->feat_id / pm.block_feats);
+    }
+  }
+}
+
+inline void drop(PagedModel &pm, index_t n) {
+  Page &p = pm.pages[n];
+  if (!p.data) return;
+  free(p.data);
+  p.data = nullptr;
+  --pm.resident;
+}
+
+/*
+ * Buffer of page n's length for the caller to fill, evicting least
+ * recently used pages beyond max_resident first. Pages used by the
+ * current batch are never evicted, so a batch wider than max_resident
+ * pages overshoots until the next one. nullptr if allocation fails.
+ */
+inline real_t *page_in(PagedModel &pm, index_t n) {
+  Page &p = pm.pages[n];
+  if (p.data) return p.data;
+  while (pm.max_resident && pm.resident >= pm.max_resident) {
+    Page *victim = nullptr;
+    for (Page &q : pm.pages) {
+      if (!q.data || q.last_use == pm.tick) continue;
+      if (!victim || q.last_use < victim->last_use) victim = &q;
+    }
+    if (!victim) break;
+    drop(pm, (index_t)(victim - pm.pages.data()));
+  }
+  p.data = (real_t *)malloc(p.length ? p.length : 1);
+  if (!p.data) return nullptr;
+  p.last_use = pm.tick;
+  ++pm.resident;
+  ++pm.page_ins;
+  return p.data;
+}
+
+/* ---------- scoring ---------- */
+
+/* Rows must only touch resident pages (begin_batch found none missing) */
+inline real_t linear_term(const SparseRow *row, const PagedModel &pm) {
+  real_t sum_w = 0;
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= pm.num_feat) continue;
+    sum_w += pm.w(iter->feat_id) * iter->feat_val;
+  }
+  return sum_w + pm.b;
+}
+
+inline real_t fm_score(const SparseRow *row, const PagedModel &pm,
+                       real_t norm) {
+  index_t k = pm.aligned_k;
+  thread_local std::vector<real_t> sv;
+  sv.resize(k);
+  real_t *s = sv.data();
+  for (index_t d = 0; d < k; d += xLearn::kAlign) store(s + d, splat(0.0f));
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= pm.num_feat) continue;
+    const real_t *vj = pm.v(iter->feat_id);
+    f32x4 x = splat(iter->feat_val);
+    for (index_t d = 0; d < k; d += xLearn::kAlign) {
+      store(s + d, add(load(s + d), mul(load(vj + d), x)));
+    }
+  }
+
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= pm.num_feat) continue;
+    const real_t *vj = pm.v(iter->feat_id);
+    f32x4 x = splat(iter->feat_val);
+    for (index_t d = 0; d < k; d += xLearn::kAlign) {
+      f32x4 vx = mul(load(vj + d), x);
+      t = add(t, mul(vx, sub(load(s + d), vx)));
+    }
+  }
+  return linear_term(row, pm) + 0.5f * norm * hsum(t);
+}
+
+inline real_t ffm_score(const SparseRow *row, const PagedModel &pm,
+                        real_t norm) {
+  index_t k = pm.aligned_k;
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter_i = row->begin();
+       iter_i != row->end(); ++iter_i) {
+    index_t j1 = iter_i->feat_id;
+    index_t f1 = iter_i->field_id;
+    if (j1 >= pm.num_feat || f1 >= pm.num_field) continue;
+    for (SparseRow::const_iterator iter_j = iter_i + 1;
+         iter_j != row->end(); ++iter_j) {
+      index_t j2 = iter_j->feat_id;
+      index_t f2 = iter_j->field_id;
+      if (j2 >= pm.num_feat || f2 >= pm.num_field) continue;
+      const real_t *w1 = pm.v(j1) + f2 * k;
+      const real_t *w2 = pm.v(j2) + f1 * k;
+      f32x4 xx = splat(iter_i->feat_val * iter_j->feat_val * norm);
+      for (index_t d = 0; d < k; d += xLearn::kAlign) {
+        t = add(t, mul(mul(load(w1 + d), load(w2 + d)), xx));
+      }
+    }
+  }
+  return linear_term(row, pm) + hsum(t);
+}
+
+inline real_t score(const SparseRow *row, const PagedModel &pm, real_t norm) {
+  switch (pm.kind) {
+    case PagedModel::kFM: return WL_XL_HAS_FM ? fm_score(row, pm, norm) : 0;
+    case PagedModel::kFFM: return WL_XL_HAS_FFM ? ffm_score(row, pm, norm) : 0;
+    default: return linear_term(row, pm);
+  }
+}
+
+}  // namespace wl_paged
+
+#endif  // WL_XL_PAGED_MODEL_H_
@@ -0,0 +1,244 @@
+/*
+ * quant_score.h -- Inference-only quantized LR/FM/FFM models
+ *
+ * A QuantModel keeps only what scoring reads: fp32 linear weights and
+ * bias, and the latent vectors without optimizer state, stored as fp16
+ * or int8. Each latent block (one aligned_k vector, i.e. v_j for FM or
+ * v_{j,f} for FFM) is contiguous; int8 blocks carry one fp32 scale
+ * (max |v| / 127). Scoring dequantizes four lanes at a time with the
+ * load_f16 / load_i8 kernels from simd_wasm.h.
+ *
+ * Compared with the trained model this drops the adagrad/ftrl state
+ * (2-3x) and shrinks each latent weight to 2 or 1 bytes.
+ */
+
+#ifndef WL_XL_QUANT_SCORE_H_
+#define WL_XL_QUANT_SCORE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/data/data_structure.h"
+#include "src/data/model_parameters.h"
+
+#include "simd_wasm.h"
+#include "wl_build.h"
+
+namespace wl_quant {
+
+using xLearn::index_t;
+using xLearn::real_t;
+using xLearn::SparseRow;
+using namespace wl_simd;
+
+struct QuantModel {
+  enum Kind { kLinear, kFM, kFFM };
+
+  std::string score_func;
+  Kind kind = kLinear;
+  index_t num_feat = 0;
+  index_t num_field = 0;
+  index_t aligned_k = 0;
+  index_t bits = 0;             /* 16 (fp16) or 8 (int8) */
+  std::vector<real_t> w;        /* num_feat */
+  real_t b = 0;
+  std::vector<real_t> scales;   /* one per block, int8 only */
+  std::vector<uint16_t> v16;    /* num_blocks * aligned_k */
+  std::vector<int8_t> v8;
+
+  /* Set score_func and kind; false if it is not linear/fm/ffm */
+  bool set_score_func(const std::string &name) {
+    score_func = name;
+    if (WL_XL_HAS_LINEAR && name == "linear") kind = kLinear;
+    else if (WL_XL_HAS_FM && name == "fm") kind = kFM;
+    else if (WL_XL_HAS_FFM && name == "ffm") kind = kFFM;
+    else return false;
+    return true;
+  }
+
+  index_t num_blocks() const {
+    if (kind == kFM) return num_feat;
+    if (kind == kFFM) return num_feat * num_field;
+    return 0;
+  }
+};
+
+/* ---------- quantization ---------- */
+
+/* float -> IEEE half, round to nearest even, saturating to max half */
+inline uint16_t float_to_half(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+  float a = std::fabs(f);
+  if (!(a < 65504.0f)) return sign | 0x7bff;
+  if (a < 6.103515625e-05f) {
+    /* subnormal: units of 2^-24 */
+    return sign | (uint16_t)std::nearbyint(a * 16777216.0f);
+  }
+  memcpy(&x, &a, sizeof(x));
+  uint32_t mant = x & 0x7fffff;
+  uint32_t exp = (x >> 23) - 112;
+  uint32_t h = (exp << 10) | (mant >> 13);
+  uint32_t rest = mant & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) h++;
+  return sign | (uint16_t)h;
+}
+
+/*
+ * Inference-only copy of model at bits = 16 or 8. The latent chunks of
+ * upstream's layout (kAlign weights followed by their opt state) are
+ * packed into contiguous aligned_k blocks.
+ */
+inline void quantize(xLearn::Model &model, index_t bits, QuantModel &q) {
+  index_t aux = model.GetAuxiliarySize();
+  index_t step = xLearn::kAlign * aux;
+  q.set_score_func(model.GetScoreFunction());
+  q.num_feat = model.GetNumFeature();
+  q.num_field = model.GetNumField();
+  q.aligned_k = q.kind == QuantModel::kLinear ? 0 : model.get_aligned_k();
+  q.bits = bits;
+
+  const real_t *w = model.GetParameter_w();
+  q.w.resize(q.num_feat);
+  for (index_t j = 0; j < q.num_feat; ++j) q.w[j] = w[j * aux];
+  q.b = model.GetParameter_b()[0];
+
+  index_t nb = q.num_blocks();
+  index_t k = q.aligned_k;
+  index_t src_block = aux * k;  /* align0 */
+  const real_t *v = model.GetParameter_v();
+  std::vector<real_t> block(k);
+  if (bits == 8) {
+    q.scales.resize(nb);
+    q.v8.resize((size_t)nb * k);
+  } else {
+    q.v16.resize((size_t)nb * k);
+  }
+
+  for (index_t n = 0; n < nb; ++n) {
+    const real_t *src = v + (size_t)n * src_block;
+    real_t max_abs = 0;
+    for (index_t d = 0; d < k; ++d) {
+      block[d] = src[(d / xLearn::kAlign) * step + d % xLearn::kAlign];
+      max_abs = std::max(max_abs, (real_t)std::fabs(block[d]));
+    }
+    if (bits == 8) {
+      real_t scale = max_abs > 0 ? max_abs / 127.0f : 1.0f;
+      q.scales[n] = scale;
+      int8_t *dst = &q.v8[(size_t)n * k];
+      for (index_t d = 0; d < k; ++d) {
+        dst[d] = (int8_t)std::lrint(block[d] / scale);
+      }
+    } else {
+      uint16_t *dst = &q.v16[(size_t)n * k];
+      for (index_t d = 0; d < k; ++d) dst[d] = float_to_half(block[d]);
+    }
+  }
+}
+
+/* ---------- scoring ---------- */
+
+/* Dequantizing accessors for latent block n, lanes [d, d + 4) */
+struct DecodeF16 {
+  const QuantModel &q;
+  f32x4 load(index_t n, index_t d) const {
+    return load_f16(&q.v16[(size_t)n * q.aligned_k + d]);
+  }
+};
+
+struct DecodeI8 {
+  const QuantModel &q;
+  f32x4 load(index_t n, index_t d) const {
+    return mul(load_i8(&q.v8[(size_t)n * q.aligned_k + d]),
+               splat(q.scales[n]));
+  }
+};
+
+inline real_t linear_term(const SparseRow *row, const QuantModel &q) {
+  real_t sum_w = 0;
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= q.num_feat) continue;
+    sum_w += q.w[iter->feat_id] * iter->feat_val;
+  }
+  return sum_w + q.b;
+}
+
+template <class Dec>
+real_t fm_score(const SparseRow *row, const QuantModel &q, const Dec &dec,
+                real_t norm) {
+  index_t k = q.aligned_k;
+  thread_local std::vector<real_t> sv;
+  sv.resize(k);
+  real_t *s = sv.data();
+  for (index_t d = 0; d < k; d += xLearn::kAlign) store(s + d, splat(0.0f));
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= q.num_feat) continue;
+    f32x4 x = splat(iter->feat_val);
+    for (index_t d = 0; d < k; d += xLearn::kAlign) {
+      store(s + d, add(load(s + d), mul(dec.load(iter->feat_id, d), x)));
+    }
+  }
+
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= q.num_feat) continue;
+    f32x4 x = splat(iter->feat_val);
+    for (index_t d = 0; d < k; d += xLearn::kAlign) {
+      f32x4 vx = mul(dec.load(iter->feat_id, d), x);
+      t = add(t, mul(vx, sub(load(s + d), vx)));
+    }
+  }
+  return linear_term(row, q) + 0.5f * norm * hsum(t);
+}
+
+template <class Dec>
+real_t ffm_score(const SparseRow *row, const QuantModel &q, const Dec &dec,
+                 real_t norm) {
+  index_t k = q.aligned_k;
+  f32x4 t = splat(0.0f);
+  for (SparseRow::const_iterator iter_i = row->begin();
+       iter_i != row->end(); ++iter_i) {
+    index_t j1 = iter_i->feat_id;
+    index_t f1 = iter_i->field_id;
+    if (j1 >= q.num_feat || f1 >= q.num_field) continue;
+    for (SparseRow::const_iterator iter_j = iter_i + 1;
+         iter_j != row->end(); ++iter_j) {
+      index_t j2 = iter_j->feat_id;
+      index_t f2 = iter_j->field_id;
+      if (j2 >= q.num_feat || f2 >= q.num_field) continue;
+      index_t n1 = j1 * q.num_field + f2;
+      index_t n2 = j2 * q.num_field + f1;
+      f32x4 xx = splat(iter_i->feat_val * iter_j->feat_val * norm);
+      for (index_t d = 0; d < k; d += xLearn::kAlign) {
+        t = add(t, mul(mul(dec.load(n1, d), dec.load(n2, d)), xx));
+      }
+    }
+  }
+  return linear_term(row, q) + hsum(t);
+}
+
+template <class Dec>
+real_t score_with(const SparseRow *row, const QuantModel &q, real_t norm) {
+  Dec dec = { q };
+  switch (q.kind) {
+    case QuantModel::kFM: return WL_XL_HAS_FM ? fm_score(row, q, dec, norm) : 0;
+    case QuantModel::kFFM: return WL_XL_HAS_FFM ? ffm_score(row, q, dec, norm) : 0;
+    default: return linear_term(row, q);
+  }
+}
+
+inline real_t score(const SparseRow *row, const QuantModel &q, real_t norm) {
+  return q.bits == 8 ? score_with<DecodeI8>(row, q, norm)
+                     : score_with<DecodeF16>(row, q, norm);
+}
+
+}  // namespace wl_quant
+
+#endif  // WL_XL_QUANT_SCORE_H_
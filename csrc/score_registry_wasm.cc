@@ -0,0 +1,40 @@
+/*
+ * score_registry_wasm.cc -- Score function registry of single-algorithm builds
+ *
+ * Replaces upstream score_function.cc in build-wasm.sh's lr, fm and ffm
+ * variants. Upstream registers all three score functions, and each
+ * registration is a static constructor that keeps its class (and all
+ * the code its vtable reaches) in the binary; this one registers only
+ * the score function the variant keeps (wl_build.h), so the others'
+ * files can be left out of the link.
+ */
+
+#include "src/score/score_function.h"
+
+#include "wl_build.h"
+
+#if WL_XL_HAS_LINEAR
+#include "src/score/linear_score.h"
+#endif
+#if WL_XL_HAS_FM
+#include "src/score/fm_score.h"
+#endif
+#if WL_XL_HAS_FFM
+#include "src/score/ffm_score.h"
+#endif
+
+namespace xLearn {
+
+CLASS_REGISTER_IMPLEMENT_REGISTRY(xLearn_score_registry, Score);
+
+#if WL_XL_HAS_LINEAR
+REGISTER_SCORE("linear", LinearScore);
+#endif
+#if WL_XL_HAS_FM
+REGISTER_SCORE("fm", FMScore);
+#endif
+#if WL_XL_HAS_FFM
+REGISTER_SCORE("ffm", FFMScore);
+#endif
+
+}  // namespace xLearn
@@ -0,0 +1,68 @@
+/*
+ * score_wasm.h -- Pieces shared by the WASM SIMD FM/FFM score functions
+ *
+ * Linear and bias terms (scalar: one weight per active feature) and the
+ * optimizer dispatch used by FMScore/FFMScore::CalcGrad.
+ */
+
+#ifndef WL_XL_SCORE_WASM_H_
+#define WL_XL_SCORE_WASM_H_
+
+#include <string>
+
+#include "src/data/data_structure.h"
+#include "src/data/model_parameters.h"
+
+#include "simd_wasm.h"
+
+namespace wl_simd {
+
+/* sum_i w_i x_i + b */
+inline xLearn::real_t linear_score(const xLearn::SparseRow *row,
+                                   xLearn::Model &model) {
+  xLearn::real_t *w = model.GetParameter_w();
+  xLearn::index_t num_feat = model.GetNumFeature();
+  xLearn::index_t aux_size = model.GetAuxiliarySize();
+  xLearn::real_t sum_w = 0;
+  for (xLearn::SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= num_feat) continue;  /* unseen feature */
+    sum_w += w[iter->feat_id * aux_size] * iter->feat_val;
+  }
+  return sum_w + model.GetParameter_b()[0];
+}
+
+template <class Opt>
+void update_linear(const xLearn::SparseRow *row, xLearn::Model &model,
+                   xLearn::real_t pg, const OptParams &p) {
+  xLearn::real_t *w = model.GetParameter_w();
+  xLearn::index_t num_feat = model.GetNumFeature();
+  xLearn::index_t aux_size = model.GetAuxiliarySize();
+  for (xLearn::SparseRow::const_iterator iter = row->begin();
+       iter != row->end(); ++iter) {
+    if (iter->feat_id >= num_feat) continue;
+    Opt::update(w + iter->feat_id * aux_size, pg * iter->feat_val, p);
+  }
+  /* bias is not regularized */
+  OptParams pb = p;
+  pb.lambda = 0.0f;
+  pb.lambda_1 = 0.0f;
+  pb.lambda_2 = 0.0f;
+  Opt::update(model.GetParameter_b(), pg, pb);
+}
+
+/* Call fn.template run<Opt>() for the optimizer named by opt_type. */
+template <class Fn>
+void dispatch_opt(const std::string &opt_type, Fn &fn) {
+  if (opt_type.compare("sgd") == 0) {
+    fn.template run<SGD>();
+  } else if (opt_type.compare("adagrad") == 0) {
+    fn.template run<AdaGrad>();
+  } else if (opt_type.compare("ftrl") == 0) {
+    fn.template run<FTRL>();
+  }
+}
+
+}  // namespace wl_simd
+
+#endif  // WL_XL_SCORE_WASM_H_
@@ -0,0 +1,199 @@
+/*
+ * simd_wasm.h -- 4-lane float kernels for the FM/FFM score functions
+ *
+ * The replacement score functions (fm_score_wasm.cc, ffm_score_wasm.cc)
+ * are written once against the small f32x4 API below. With -msimd128 it
+ * maps directly onto wasm_simd128.h; otherwise (or with
+ * -DWL_XL_SCALAR_KERNELS) it falls back to plain scalar lanes, which is
+ * the reference path the SIMD build is tested against. load_f16 and
+ * load_i8 widen quantized weights (quant_score.h) to f32x4.
+ *
+ * Latent vectors use upstream's layout: aligned_k floats stored in
+ * chunks of kAlign (4), each chunk followed by its optimizer state
+ * (adagrad: 4 accumulators, ftrl: 4 n + 4 z), so consecutive weight
+ * chunks are kAlign * aux_size floats apart.
+ */
+
+#ifndef WL_XL_SIMD_WASM_H_
+#define WL_XL_SIMD_WASM_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__wasm_simd128__) && !defined(WL_XL_SCALAR_KERNELS)
+#include <wasm_simd128.h>
+#define WL_XL_HAVE_SIMD128 1
+#endif
+
+namespace wl_simd {
+
+/*
+ * 2^112: rebias a half's exponent/mantissa bits (shifted into float
+ * position) from 15 to 127. Also maps half subnormals correctly.
+ */
+static const float kHalfToFloat = 5.192296858534828e+33f;
+
+/* ---------- f32x4 ---------- */
+
+#ifdef WL_XL_HAVE_SIMD128
+
+typedef v128_t f32x4;
+
+inline f32x4 load(const float *p) { return wasm_v128_load(p); }
+inline void store(float *p, f32x4 a) { wasm_v128_store(p, a); }
+inline f32x4 splat(float x) { return wasm_f32x4_splat(x); }
+inline f32x4 add(f32x4 a, f32x4 b) { return wasm_f32x4_add(a, b); }
+inline f32x4 sub(f32x4 a, f32x4 b) { return wasm_f32x4_sub(a, b); }
+inline f32x4 mul(f32x4 a, f32x4 b) { return wasm_f32x4_mul(a, b); }
+inline f32x4 div(f32x4 a, f32x4 b) { return wasm_f32x4_div(a, b); }
+inline f32x4 sqrt(f32x4 a) { return wasm_f32x4_sqrt(a); }
+
+/* (a0 + a1) + (a2 + a3), the same order as two SSE3 _mm_hadd_ps */
+inline float hsum(f32x4 a) {
+  f32x4 t = wasm_f32x4_add(a, wasm_i32x4_shuffle(a, a, 1, 0, 3, 2));
+  t = wasm_f32x4_add(t, wasm_i32x4_shuffle(t, t, 2, 3, 0, 1));
+  return wasm_f32x4_extract_lane(t, 0);
+}
+
+/* |z| <= l1 ? 0 : (sign(z) * l1 - z) / denom */
+inline f32x4 ftrl_weight(f32x4 z, f32x4 denom, float l1) {
+  f32x4 vl1 = wasm_f32x4_splat(l1);
+  f32x4 signed_l1 = wasm_v128_or(
+    wasm_v128_and(z, wasm_f32x4_splat(-0.0f)), vl1);
+  f32x4 w = wasm_f32x4_div(wasm_f32x4_sub(signed_l1, z), denom);
+  return wasm_v128_and(w, wasm_f32x4_gt(wasm_f32x4_abs(z), vl1));
+}
+
+/* 4 int8 -> 4 floats (no scale) */
+inline f32x4 load_i8(const int8_t *p) {
+  v128_t b = wasm_v128_load32_zero(p);
+  return wasm_f32x4_convert_i32x4(
+    wasm_i32x4_extend_low_i16x8(wasm_i16x8_extend_low_i8x16(b)));
+}
+
+/* 4 IEEE half -> 4 floats (finite values, subnormals included) */
+inline f32x4 load_f16(const uint16_t *p) {
+  v128_t h = wasm_u32x4_extend_low_u16x8(wasm_v128_load64_zero(p));
+  v128_t sign = wasm_i32x4_shl(wasm_v128_and(h, wasm_i32x4_splat(0x8000)), 16);
+  v128_t mag = wasm_i32x4_shl(wasm_v128_and(h, wasm_i32x4_splat(0x7fff)), 13);
+  return wasm_v128_or(wasm_f32x4_mul(mag, wasm_f32x4_splat(kHalfToFloat)), sign);
+}
+
+#else  /* scalar lanes */
+
+struct f32x4 { float v[4]; };
+
+#define WL_XL_LANES(expr) \
+  f32x4 r; for (int i = 0; i < 4; ++i) r.v[i] = (expr); return r
+
+inline f32x4 load(const float *p) { WL_XL_LANES(p[i]); }
+inline void store(float *p, f32x4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+inline f32x4 splat(float x) { WL_XL_LANES(x); }
+inline f32x4 add(f32x4 a, f32x4 b) { WL_XL_LANES(a.v[i] + b.v[i]); }
+inline f32x4 sub(f32x4 a, f32x4 b) { WL_XL_LANES(a.v[i] - b.v[i]); }
+inline f32x4 mul(f32x4 a, f32x4 b) { WL_XL_LANES(a.v[i] * b.v[i]); }
+inline f32x4 div(f32x4 a, f32x4 b) { WL_XL_LANES(a.v[i] / b.v[i]); }
+inline f32x4 sqrt(f32x4 a) { WL_XL_LANES(std::sqrt(a.v[i])); }
+
+inline float hsum(f32x4 a) {
+  return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]);
+}
+
+inline f32x4 ftrl_weight(f32x4 z, f32x4 denom, float l1) {
+  WL_XL_LANES(std::fabs(z.v[i]) <= l1 ? 0.0f
+              : ((z.v[i] < 0 ? -l1 : l1) - z.v[i]) / denom.v[i]);
+}
+
+inline f32x4 load_i8(const int8_t *p) { WL_XL_LANES((float)p[i]); }
+
+inline float half_to_float(uint16_t h) {
+  uint32_t mag = (uint32_t)(h & 0x7fff) << 13;
+  float f;
+  memcpy(&f, &mag, sizeof(f));
+  f *= kHalfToFloat;
+  return (h & 0x8000) ? -f : f;
+}
+
+inline f32x4 load_f16(const uint16_t *p) { WL_XL_LANES(half_to_float(p[i])); }
+
+#undef WL_XL_LANES
+
+#endif  /* WL_XL_HAVE_SIMD128 */
+
+/* ---------- optimizers ---------- */
+
+/*
+ * Update rules shared by the linear and latent terms. update() works on
+ * one scalar weight whose state follows it directly (w[1], w[2]);
+ * update4() works on one chunk of kAlign weights whose state follows in
+ * the next chunks (w + 4, w + 8). grad excludes regularization.
+ */
+struct OptParams {
+  float lr;
+  float lambda;
+  float alpha;
+  float beta;
+  float lambda_1;
+  float lambda_2;
+};
+
+struct SGD {
+  static void update(float *w, float grad, const OptParams &p) {
+    w[0] -= p.lr * (grad + p.lambda * w[0]);
+  }
+  static void update4(float *w, f32x4 grad, const OptParams &p) {
+    f32x4 vw = load(w);
+    f32x4 g = add(grad, mul(splat(p.lambda), vw));
+    store(w, sub(vw, mul(splat(p.lr), g)));
+  }
+};
+
+struct AdaGrad {
+  static void update(float *w, float grad, const OptParams &p) {
+    float g = grad + p.lambda * w[0];
+    w[1] += g * g;
+    w[0] -= p.lr * g / std::sqrt(w[1]);
+  }
+  static void update4(float *w, f32x4 grad, const OptParams &p) {
+    f32x4 vw = load(w);
+    f32x4 g = add(grad, mul(splat(p.lambda), vw));
+    f32x4 acc = add(load(w + 4), mul(g, g));
+    store(w + 4, acc);
+    store(w, sub(vw, div(mul(splat(p.lr), g), sqrt(acc))));
+  }
+};
+
+struct FTRL {
+  static void update(float *w, float g, const OptParams &p) {
+    float n_old = w[1];
+    float n_new = n_old + g * g;
+    float sigma = (std::sqrt(n_new) - std::sqrt(n_old)) / p.alpha;
+    w[2] += g - sigma * w[0];
+    w[1] = n_new;
+    float z = w[2];
+    if (std::fabs(z) <= p.lambda_1) {
+      w[0] = 0.0f;
+    } else {
+      float denom = (p.beta + std::sqrt(n_new)) / p.alpha + p.lambda_2;
+      w[0] = ((z < 0 ? -p.lambda_1 : p.lambda_1) - z) / denom;
+    }
+  }
+  static void update4(float *w, f32x4 g, const OptParams &p) {
+    f32x4 vw = load(w);
+    f32x4 n_old = load(w + 4);
+    f32x4 n_new = add(n_old, mul(g, g));
+    f32x4 sq_new = sqrt(n_new);
+    f32x4 sigma = div(sub(sq_new, sqrt(n_old)), splat(p.alpha));
+    f32x4 z = add(load(w + 8), sub(g, mul(sigma, vw)));
+    f32x4 denom = add(div(add(splat(p.beta), sq_new), splat(p.alpha)),
+                      splat(p.lambda_2));
+    store(w + 4, n_new);
+    store(w + 8, z);
+    store(w, ftrl_weight(z, denom, p.lambda_1));
+  }
+};
+
+}  // namespace wl_simd
+
+#endif  // WL_XL_SIMD_WASM_H_
@@ -5,6 +5,9 @@
  * synchronous version that executes tasks immediately in enqueue().
  * This avoids std::thread/mutex/condition_variable which require
  * pthreads support in Emscripten.
+ *
+ * Only force-included into the single-threaded build (wasm/xlearn.js).
+ * The pthreads build (wasm/xlearn-mt.js) uses upstream's ThreadPool.
  */
 
 #ifndef XLEARN_BASE_THREAD_POOL_H_
@@ -4,26 +4,100 @@
  * Wraps xLearn's C API for use from JavaScript via Emscripten.
  * Adds:
  *   - CSR DMatrix construction (not in upstream C API)
- *   - MEMFS-based model byte I/O (fit returns bytes, predict takes bytes)
+ *   - Hashed-feature DMatrix construction (fixed 2^b feature table)
+ *   - Reference-counted DMatrix shared by many handles
+ *   - Reusable batch DMatrix refilled in place (serving path)
+ *   - In-memory model byte I/O (no MEMFS round trip on fit or load)
+ *   - Prepared models (parse model bytes once, predict without MEMFS)
  *   - Safe prediction output (copies to caller buffer)
+ *   - Scratch arena for per-call temporaries from JS
+ *   - Quantized (fp16/int8) inference-only models
+ *   - Paged inference-only models (weights read in on demand)
+ *   - Blocked FFM weight layout (weights-only aligned blocks, SoA state)
+ *   - Epoch-wise training with validation metrics and snapshots
+ *   - Thread-local error state; upstream output muted at the stream
+ *   - Opt-in per-handle phase timers and heap counters
  *
  * Compile with: emcc csrc/wl_api.cpp + upstream sources
  */
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <iostream>
 #include <string>
 #include <vector>
 #include <memory>
 #include <stdexcept>
-#include <unistd.h>
-#include <fcntl.h>
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <emscripten/threading.h>
+#endif
 
 #include "src/c_api/c_api.h"
 #include "src/c_api/c_api_error.h"
 #include "src/data/data_structure.h"
+#include "src/data/model_parameters.h"
+#include "src/score/score_function.h"
+
+#include "eval_metrics.h"
+#include "fast_score.h"
+#include "ffm_blocked.h"
+#include "ffm_parallel.h"
+#include "paged_model.h"
+#include "quant_score.h"
+#include "wl_build.h"
+#include "wl_stats.h"
+
+/* ---------- handle state ---------- */
+
+/*
+ * Adapter handle returned by wl_xl_create. Wraps the upstream XLearn
+ * handle together with adapter-side state that must outlive a single
+ * call, such as a prepared (already parsed) model for prediction.
+ */
+struct WlHandle {
+  XL xl = nullptr;
+  std::unique_ptr<xLearn::Model> model;
+  std::unique_ptr<xLearn::Score> score;
+  /* Compile-time specialized scorer for model, or nullptr */
+  wl_fast::FastScoreFn fast_score = nullptr;
+  /* Inference-only quantized model (set instead of model/score) */
+  std::unique_ptr<wl_quant::QuantModel> qmodel;
+  xLearn::index_t quant_num_k = 0;
+  /* Inference-only paged model (set instead of model/score) */
+  std::unique_ptr<wl_paged::PagedModel> pmodel;
+  /* FFM model in the blocked layout (set instead of model) */
+  std::unique_ptr<wl_ffm::BlockedFFM> bmodel;
+  /* Keep FFM models in the blocked layout (wl_xl_set_layout) */
+  bool blocked_layout = false;
+  /* FFM rows with at least this many entries score in parallel bands
+     (wl_xl_set_parallel_nnz, 0: never, the default: banded sums differ
+     from the serial kernel's in the last bits) */
+  int parallel_nnz = 0;
+  /* Copy of model's w, v, b (with opt state) for early stopping */
+  std::vector<xLearn::real_t> snapshot;
+  /* Negatives kept per epoch by cross-entropy training, and the seed
+     choosing them (wl_xl_set_neg_sampling); epochs trained so far */
+  float neg_rate = 1.0f;
+  uint32_t neg_seed = 0;
+  uint32_t sample_epoch = 0;
+  /* Per-phase timers and counters, when enabled (wl_stats.h) */
+  std::unique_ptr<WlStats> stats;
+};
+
+static inline bool has_model(const WlHandle *h) {
+  return h->model || h->qmodel || h->pmodel || h->bmodel;
+}
+
+static inline WlHandle *as_handle(void *handle) {
+  return reinterpret_cast<WlHandle*>(handle);
+}
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,7 +105,12 @@ extern "C" {
 
 /* ---------- error handling ---------- */
 
-static char last_error[1024] = "";
+/*
+ * One error buffer per thread, so calls on different threads (pthread
+ * workers, or several handles driven concurrently) never see each
+ * other's messages. wl_xl_get_last_error reports the calling thread's.
+ */
+static thread_local char last_error[1024] = "";
 
 static void set_error(const char *msg) {
   strncpy(last_error, msg, sizeof(last_error) - 1);
@@ -42,6 +121,35 @@ const char* wl_xl_get_last_error(void) {
   return last_error;
 }
 
+#ifdef WL_XL_INFERENCE_ONLY
+/* What a training entry point of the inference-only build returns */
+static int no_training(const char *fn) {
+  set_error((std::string(fn) + ": this build is inference-only").c_str());
+  return -1;
+}
+#endif
+
+/* ---------- threading ---------- */
+
+/*
+ * Upper bound for nthread. The threaded build pre-spawns one pthread
+ * worker per logical core, and a pool task that needs a worker beyond
+ * that would deadlock the (blocked) calling thread, so nthread is capped
+ * there. The sequential ThreadPool shim only ever runs one thread.
+ */
+static int max_threads(void) {
+#ifdef __EMSCRIPTEN_PTHREADS__
+  int n = emscripten_num_logical_cores();
+  return n > 0 ? n : 1;
+#else
+  return 1;
+#endif
+}
+
+int wl_xl_max_threads(void) {
+  return max_threads();
+}
+
 /* ---------- handle lifecycle ---------- */
 
 int wl_xl_create(const char *model_type, void **out) {
@@ -50,6 +158,11 @@ int wl_xl_create(const char *model_type, void **out) {
     set_error("wl_xl_create: null argument");
     return -1;
   }
+  if (!wl_build_has(model_type)) {
+    set_error((std::string("wl_xl_create: this build has no ") + model_type
+               + " models").c_str());
+    return -1;
+  }
   XL handle = nullptr;
   int ret = XLearnCreate(model_type, &handle);
   if (ret != 0) {
@@ -59,20 +172,30 @@ int wl_xl_create(const char *model_type, void **out) {
   }
   /* Set WASM-friendly defaults */
   XLearnSetBool(&handle, "quiet", true);
-  XLearnSetBool(&handle, "lock_free", false);
   XLearnSetBool(&handle, "from_file", false);
   XLearnSetBool(&handle, "bin_out", false);
   XLearnSetBool(&handle, "early_stop", false);
-  XLearnSetInt(&handle, "nthread", 1);
   XLearnSetStr(&handle, "log", "/dev/null");
-  *out = handle;
+#ifdef __EMSCRIPTEN_PTHREADS__
+  /* Threaded build: upstream's lock-free (Hogwild) training on every core */
+  XLearnSetBool(&handle, "lock_free", true);
+  XLearnSetInt(&handle, "nthread", max_threads());
+#else
+  XLearnSetBool(&handle, "lock_free", false);
+  XLearnSetInt(&handle, "nthread", 1);
+#endif
+
+  WlHandle *h = new WlHandle();
+  h->xl = handle;
+  *out = h;
   return 0;
 }
 
 void wl_xl_free_handle(void *handle) {
   if (handle) {
-    XLearn *xl = reinterpret_cast<XLearn*>(handle);
-    delete xl;
+    WlHandle *h = as_handle(handle);
+    delete reinterpret_cast<XLearn*>(h->xl);
+    delete h;
   }
 }
 
@@ -83,7 +206,7 @@ int wl_xl_set_str(void *handle, const char *key, const char *value) {
     set_error("wl_xl_set_str: null argument");
     return -1;
   }
-  return XLearnSetStr(&handle, key, value);
+  return XLearnSetStr(&as_handle(handle)->xl, key, value);
 }
 
 int wl_xl_set_int(void *handle, const char *key, int value) {
@@ -91,7 +214,11 @@ int wl_xl_set_int(void *handle, const char *key, int value) {
     set_error("wl_xl_set_int: null argument");
     return -1;
   }
-  return XLearnSetInt(&handle, key, value);
+  if (strcmp(key, "nthread") == 0) {
+    int limit = max_threads();
+    if (value <= 0 || value > limit) value = limit;
+  }
+  return XLearnSetInt(&as_handle(handle)->xl, key, value);
 }
 
 int wl_xl_set_float(void *handle, const char *key, float value) {
@@ -99,7 +226,7 @@ int wl_xl_set_float(void *handle, const char *key, float value) {
     set_error("wl_xl_set_float: null argument");
     return -1;
   }
-  return XLearnSetFloat(&handle, key, value);
+  return XLearnSetFloat(&as_handle(handle)->xl, key, value);
 }
 
 int wl_xl_set_bool(void *handle, const char *key, int value) {
@@ -107,7 +234,257 @@ int wl_xl_set_bool(void *handle, const char *key, int value) {
     set_error("wl_xl_set_bool: null argument");
     return -1;
   }
-  return XLearnSetBool(&handle, key, (bool)value);
+  return XLearnSetBool(&as_handle(handle)->xl, key, (bool)value);
+}
+
+/*
+ * Negative downsampling for cross-entropy training: each epoch trains
+ * on all positives and a rate fraction of the negatives (0 < rate <= 1,
+ * 1: all), chosen by seed. The model's bias is corrected by log(rate)
+ * after every epoch, so its scores stay calibrated to the full data.
+ */
+int wl_xl_set_neg_sampling(void *handle, float rate, int seed) {
+  last_error[0] = '\0';
+  if (!handle || !(rate > 0.0f && rate <= 1.0f)) {
+    set_error("wl_xl_set_neg_sampling: rate must be in (0, 1]");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  h->neg_rate = rate;
+  h->neg_seed = (uint32_t)seed;
+  return 0;
+}
+
+/* ---------- stats ---------- */
+
+/*
+ * Turn the handle's stats on (zeroed) or off. Fails if the build has
+ * them compiled out (WL_XL_NO_STATS).
+ */
+int wl_xl_enable_stats(void *handle, int enable) {
+  last_error[0] = '\0';
+  if (!handle) {
+    set_error("wl_xl_enable_stats: null argument");
+    return -1;
+  }
+#ifdef WL_XL_NO_STATS
+  if (enable) {
+    set_error("wl_xl_enable_stats: stats are compiled out of this build");
+    return -1;
+  }
+#endif
+  WlHandle *h = as_handle(handle);
+  h->stats.reset(enable ? new WlStats() : nullptr);
+  if (h->stats) wl_stats_sample_heap(h->stats.get());
+  return 0;
+}
+
+/* Zero the counters of a handle with stats enabled */
+void wl_xl_reset_stats(void *handle) {
+  WlHandle *h = handle ? as_handle(handle) : nullptr;
+  if (h && h->stats) {
+    h->stats.reset(new WlStats());
+    wl_stats_sample_heap(h->stats.get());
+  }
+}
+
+/*
+ * Copy the handle's stats into out (kStatsLen doubles, layout in
+ * wl_stats.h). Returns the number written, 0 if stats are off, or -1
+ * if capacity is too small.
+ */
+int wl_xl_get_stats(void *handle, double *out, int capacity) {
+  last_error[0] = '\0';
+  if (!handle || !out) {
+    set_error("wl_xl_get_stats: null argument");
+    return -1;
+  }
+  const WlStats *st = as_handle(handle)->stats.get();
+  if (!st) return 0;
+  if (capacity < kStatsLen) {
+    set_error("wl_xl_get_stats: output buffer too small");
+    return -1;
+  }
+  int k = 0;
+  for (int p = 0; p < kNumPhases; ++p) {
+    out[k++] = st->ms[p];
+    out[k++] = st->calls[p];
+  }
+  out[k++] = st->bytes_copied;
+  out[k++] = st->allocs;
+  double heap = wl_heap_top();
+  out[k++] = heap;
+  out[k++] = std::max(st->peak_heap_bytes, heap);
+  return k;
+}
+
+/* ---------- memory accounting ---------- */
+
+/*
+ * Heap bytes held by a handle's model state (prepared model in any
+ * form, early-stopping snapshot, stats), for budgeting many models in
+ * one module. Counts the containers' payloads, not allocator overhead
+ * or upstream's trainer state while a fit runs.
+ */
+double wl_xl_handle_bytes(void *handle) {
+  if (!handle) return 0;
+  const WlHandle *h = as_handle(handle);
+  const double f = sizeof(xLearn::real_t);
+  double n = sizeof(WlHandle);
+  if (h->model) {
+    xLearn::Model *m = h->model.get();
+    n += f * ((double)m->GetNumParameter_w() + m->GetNumParameter_v()
+              + m->GetAuxiliarySize());
+  }
+  if (h->bmodel) {
+    const wl_ffm::BlockedFFM &m = *h->bmodel;
+    n += f * ((double)m.w.capacity() + m.b.capacity() + m.v.size
+              + m.state.size);
+  }
+  if (h->qmodel) {
+    const wl_quant::QuantModel &q = *h->qmodel;
+    n += f * ((double)q.w.capacity() + q.scales.capacity())
+      + 2.0 * q.v16.capacity() + q.v8.capacity();
+  }
+  if (h->pmodel) {
+    const wl_paged::PagedModel &pm = *h->pmodel;
+    n += (double)sizeof(wl_paged::Page) * pm.pages.capacity();
+    for (const wl_paged::Page &p : pm.pages) {
+      if (p.data) n += p.length;
+    }
+  }
+  n += f * (double)h->snapshot.capacity();
+  if (h->stats) n += sizeof(WlStats);
+  return n;
+}
+
+/* Top of the malloc heap (bytes); 0 outside Emscripten */
+double wl_xl_heap_top(void) {
+  return wl_heap_top();
+}
+
+/* ---------- DMatrix construction ---------- */
+
+/*
+ * Every DMatrix handed out is reference counted, so one training set
+ * can back many handles (e.g. a hyperparameter search) without being
+ * rebuilt: wl_xl_dmatrix_retain adds a reference, wl_xl_free_dmatrix
+ * drops one. The count is atomic, so handles trained on other threads
+ * may retain and release it too; training only reads the matrix.
+ */
+struct WlDMatrix : xLearn::DMatrix {
+  std::atomic<int> refs{1};
+  /* Per-row sample weights scaling each row's gradient in training
+     (wl_xl_dmatrix_set_weights; empty: every row weighs 1) */
+  std::vector<xLearn::real_t> weight;
+  /* Cleared rows a batch shrank away from, kept for its next refill */
+  std::vector<xLearn::SparseRow*> spare;
+
+  ~WlDMatrix() {
+    for (xLearn::SparseRow *r : spare) delete r;
+  }
+};
+
+/*
+ * Allocate a DMatrix with all nrow rows, labels and norms sized up
+ * front, so building it does not grow any vector element by element.
+ * Rows are filled in by the caller.
+ */
+static xLearn::DMatrix *alloc_dmatrix(int nrow, bool has_label) {
+  xLearn::DMatrix *matrix = new WlDMatrix();
+  matrix->has_label = has_label;
+  matrix->row_length = (xLearn::index_t)nrow;
+  matrix->row.assign((size_t)nrow, nullptr);
+  matrix->Y.assign((size_t)nrow, 0.0f);
+  matrix->norm.assign((size_t)nrow, 1.0f);
+  return matrix;
+}
+
+/* Append nrow empty rows to an existing DMatrix (geometric growth). */
+static void grow_dmatrix(xLearn::DMatrix *matrix, int nrow) {
+  size_t n = (size_t)matrix->row_length + (size_t)nrow;
+  matrix->row.resize(n, nullptr);
+  matrix->Y.resize(n, 0.0f);
+  matrix->norm.resize(n, 1.0f);
+  matrix->row_length = (xLearn::index_t)n;
+}
+
+static void destroy_dmatrix(xLearn::DMatrix *matrix) {
+  matrix->Reset();
+  delete static_cast<WlDMatrix*>(matrix);
+}
+
+/* Row i, emptied if it exists (a refilled batch) or new */
+static xLearn::SparseRow *reuse_row(xLearn::DMatrix *matrix, size_t i) {
+  xLearn::SparseRow *row = matrix->row[i];
+  if (row) {
+    row->clear();
+  } else {
+    row = new xLearn::SparseRow();
+    matrix->row[i] = row;
+  }
+  return row;
+}
+
+/* Row i from a dense row x. Zeros are skipped (match file-reader). */
+static void fill_dense_row(xLearn::DMatrix *matrix, size_t i,
+                           const float *x, int ncol,
+                           const int *field_map) {
+  /* count first to size the row */
+  int nnz = 0;
+  for (int j = 0; j < ncol; ++j) {
+    if (x[j] != 0.0f) nnz++;
+  }
+  xLearn::SparseRow *row = reuse_row(matrix, i);
+  row->reserve((size_t)nnz);
+
+  float norm = 0.0f;
+  for (int j = 0; j < ncol; ++j) {
+    float val = x[j];
+    if (val == 0.0f) continue;
+    xLearn::index_t field_id = field_map ? (xLearn::index_t)field_map[j] : 0;
+    row->push_back(xLearn::Node(field_id, (xLearn::index_t)j, val));
+    norm += val * val;
+  }
+  matrix->norm[i] = (norm > 0.0f) ? (1.0f / norm) : 1.0f;
+}
+
+/* Row i from CSR entries [start, end). */
+static void fill_csr_row(xLearn::DMatrix *matrix, size_t i,
+                         const float *values, const int *col_indices,
+                         int start, int end,
+                         const int *field_map) {
+  xLearn::SparseRow *row = reuse_row(matrix, i);
+  row->reserve(end > start ? (size_t)(end - start) : 0);
+
+  float norm = 0.0f;
+  for (int j = start; j < end; ++j) {
+    int col = col_indices[j];
+    float val = values[j];
+    xLearn::index_t field_id = field_map ? (xLearn::index_t)field_map[col] : 0;
+    row->push_back(xLearn::Node(field_id, (xLearn::index_t)col, val));
+    norm += val * val;
+  }
+  matrix->norm[i] = (norm > 0.0f) ? (1.0f / norm) : 1.0f;
+}
+
+/* 0 <= row_ptr[0] <= ... <= row_ptr[nrow] <= nnz */
+static bool csr_row_ptr_valid(const int *row_ptr, int nrow, int nnz) {
+  if (row_ptr[0] < 0 || row_ptr[nrow] > nnz) return false;
+  for (int i = 0; i < nrow; ++i) {
+    if (row_ptr[i] > row_ptr[i + 1]) return false;
+  }
+  return true;
+}
+
+/* Every entry's column in [0, ncol), the length of a field map; call
+   after csr_row_ptr_valid */
+static bool csr_cols_valid(const int *col_indices, const int *row_ptr,
+                           int nrow, int ncol) {
+  for (int j = row_ptr[0]; j < row_ptr[nrow]; ++j) {
+    if (col_indices[j] < 0 || col_indices[j] >= ncol) return false;
+  }
+  return true;
 }
 
 /* ---------- DMatrix from dense array ---------- */
@@ -124,29 +501,21 @@ int wl_xl_create_dmatrix_dense(
     return -1;
   }
 
+  xLearn::DMatrix *matrix = nullptr;
   try {
-    xLearn::DMatrix *matrix = new xLearn::DMatrix();
-    matrix->has_label = (label != nullptr);
+    matrix = alloc_dmatrix(nrow, label != nullptr);
 
     for (int i = 0; i < nrow; ++i) {
-      matrix->AddRow();
       if (label) {
         matrix->Y[i] = label[i];
       }
-      float norm = 0.0f;
-      for (int j = 0; j < ncol; ++j) {
-        float val = data[i * ncol + j];
-        if (val == 0.0f) continue;  /* skip zeros (match file-reader) */
-        xLearn::index_t field_id = field_map ? (xLearn::index_t)field_map[j] : 0;
-        matrix->AddNode(i, (xLearn::index_t)j, val, field_id);
-        norm += val * val;
-      }
-      matrix->norm[i] = (norm > 0.0f) ? (1.0f / norm) : 1.0f;
+      fill_dense_row(matrix, i, data + (size_t)i * ncol, ncol, field_map);
     }
 
     *out = matrix;
     return 0;
   } catch (const std::exception &e) {
+    if (matrix) destroy_dmatrix(matrix);
     set_error(e.what());
     return -1;
   }
@@ -168,161 +537,2041 @@ int wl_xl_create_dmatrix_csr(
     set_error("wl_xl_create_dmatrix_csr: invalid arguments");
     return -1;
   }
+  if (!csr_row_ptr_valid(row_ptr, nrow, nnz)) {
+    set_error("wl_xl_create_dmatrix_csr: row_ptr out of range");
+    return -1;
+  }
+  if (!csr_cols_valid(col_indices, row_ptr, nrow, ncol)) {
+    set_error("wl_xl_create_dmatrix_csr: column index out of range");
+    return -1;
+  }
 
+  xLearn::DMatrix *matrix = nullptr;
   try {
-    xLearn::DMatrix *matrix = new xLearn::DMatrix();
-    matrix->has_label = (label != nullptr);
+    matrix = alloc_dmatrix(nrow, label != nullptr);
 
     for (int i = 0; i < nrow; ++i) {
-      matrix->AddRow();
       if (label) {
         matrix->Y[i] = label[i];
       }
-      float norm = 0.0f;
-      int start = row_ptr[i];
-      int end = row_ptr[i + 1];
-      for (int j = start; j < end; ++j) {
-        int col = col_indices[j];
-        float val = values[j];
-        xLearn::index_t field_id = field_map ? (xLearn::index_t)field_map[col] : 0;
-        matrix->AddNode(i, (xLearn::index_t)col, val, field_id);
-        norm += val * val;
-      }
-      matrix->norm[i] = (norm > 0.0f) ? (1.0f / norm) : 1.0f;
+      fill_csr_row(matrix, i, values, col_indices,
+                   row_ptr[i], row_ptr[i + 1], field_map);
     }
 
     *out = matrix;
     return 0;
   } catch (const std::exception &e) {
+    if (matrix) destroy_dmatrix(matrix);
     set_error(e.what());
     return -1;
   }
 }
 
-void wl_xl_free_dmatrix(void *dmatrix) {
-  if (dmatrix) {
-    xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dmatrix);
-    dm->Reset();
-    delete dm;
+/* ---------- reusable batch DMatrix ---------- */
+
+/*
+ * A batch is an unlabeled DMatrix that is refilled in place for each
+ * request instead of being rebuilt. Rows past the new row count are
+ * cleared into the matrix's spare list and rows are cleared rather than
+ * freed, so row, node, label and norm capacity only ever grows: once a
+ * batch has seen its largest request shape, refilling allocates
+ * nothing. Batches are freed with wl_xl_free_dmatrix.
+ */
+
+int wl_xl_batch_create(void **out) {
+  last_error[0] = '\0';
+  if (!out) {
+    set_error("wl_xl_batch_create: null argument");
+    return -1;
+  }
+  try {
+    *out = alloc_dmatrix(0, false);
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
   }
 }
 
-/* ---------- stdout suppression ---------- */
+/* Resize a batch to nrow rows; false if others still hold it */
+static bool resize_batch(void *batch, int nrow, const char *fn) {
+  WlDMatrix *m = static_cast<WlDMatrix*>(
+    reinterpret_cast<xLearn::DMatrix*>(batch));
+  if (m->refs.load() > 1) {
+    set_error((std::string(fn) + ": batch is in use").c_str());
+    return false;
+  }
+  size_t n = (size_t)nrow;
+  while (m->row.size() > n) {
+    xLearn::SparseRow *r = m->row.back();
+    m->row.pop_back();
+    if (!r) continue;
+    r->clear();
+    m->spare.push_back(r);
+  }
+  while (m->row.size() < n) {
+    xLearn::SparseRow *r = nullptr;
+    if (!m->spare.empty()) {
+      r = m->spare.back();
+      m->spare.pop_back();
+    }
+    m->row.push_back(r);
+  }
+  m->Y.resize(n, 0.0f);
+  m->norm.resize(n, 1.0f);
+  m->row_length = (xLearn::index_t)n;
+  return true;
+}
 
-static int saved_stdout_fd = -1;
+int wl_xl_batch_fill_dense(void *batch, const float *data, int nrow, int ncol,
+                           const int *field_map) {
+  last_error[0] = '\0';
+  if (!batch || !data || nrow <= 0 || ncol <= 0) {
+    set_error("wl_xl_batch_fill_dense: invalid arguments");
+    return -1;
+  }
+  try {
+    if (!resize_batch(batch, nrow, "wl_xl_batch_fill_dense")) return -1;
+    xLearn::DMatrix *matrix = reinterpret_cast<xLearn::DMatrix*>(batch);
+    for (int i = 0; i < nrow; ++i) {
+      fill_dense_row(matrix, i, data + (size_t)i * ncol, ncol, field_map);
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
 
-static void suppress_stdout(void) {
-  fflush(stdout);
-  saved_stdout_fd = dup(1);
-  int devnull = open("/dev/null", O_WRONLY);
-  dup2(devnull, 1);
-  close(devnull);
+int wl_xl_batch_fill_csr(void *batch, const float *values, int nnz,
+                         const int *col_indices, const int *row_ptr, int nrow,
+                         int ncol, const int *field_map) {
+  last_error[0] = '\0';
+  if (!batch || !values || !col_indices || !row_ptr || nrow <= 0 || ncol <= 0) {
+    set_error("wl_xl_batch_fill_csr: invalid arguments");
+    return -1;
+  }
+  if (!csr_row_ptr_valid(row_ptr, nrow, nnz)) {
+    set_error("wl_xl_batch_fill_csr: row_ptr out of range");
+    return -1;
+  }
+  if (!csr_cols_valid(col_indices, row_ptr, nrow, ncol)) {
+    set_error("wl_xl_batch_fill_csr: column index out of range");
+    return -1;
+  }
+  try {
+    if (!resize_batch(batch, nrow, "wl_xl_batch_fill_csr")) return -1;
+    xLearn::DMatrix *matrix = reinterpret_cast<xLearn::DMatrix*>(batch);
+    for (int i = 0; i < nrow; ++i) {
+      fill_csr_row(matrix, i, values, col_indices,
+                   row_ptr[i], row_ptr[i + 1], field_map);
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
 }
 
-static void restore_stdout(void) {
-  if (saved_stdout_fd >= 0) {
-    fflush(stdout);
-    dup2(saved_stdout_fd, 1);
-    close(saved_stdout_fd);
-    saved_stdout_fd = -1;
+/* Rows and nodes a batch can hold without allocating */
+int wl_xl_batch_capacity(void *batch, int *rows, int *nodes) {
+  last_error[0] = '\0';
+  if (!batch) {
+    set_error("wl_xl_batch_capacity: null argument");
+    return -1;
+  }
+  WlDMatrix *m = static_cast<WlDMatrix*>(
+    reinterpret_cast<xLearn::DMatrix*>(batch));
+  size_t n = 0, total = 0;
+  for (xLearn::SparseRow *r : m->row) {
+    if (r) { total += r->capacity(); ++n; }
   }
+  for (xLearn::SparseRow *r : m->spare) { total += r->capacity(); ++n; }
+  if (rows) *rows = (int)n;
+  if (nodes) *nodes = (int)total;
+  return 0;
 }
 
-/* ---------- train ---------- */
+/* ---------- DMatrix from hashed features ---------- */
+
+/*
+ * Hashed input: each entry is a (field, token hash) pair, optionally
+ * with a value (1 when values is null). The pair is folded into one of
+ * 2^hash_bits feature ids, so the model never has more than 2^hash_bits
+ * features however large the vocabulary grows, and the field id comes
+ * with the entry instead of a per-column field map. Mixing the field in
+ * keeps equal tokens of different fields apart.
+ */
+static const int kMaxHashBits = 30;
 
-static int fit_counter = 0;
+static inline xLearn::index_t hash_feature(uint32_t field, uint32_t hash,
+                                           uint32_t mask) {
+  /* murmur3 fmix32 of the pair */
+  uint32_t h = hash ^ (field * 0x9e3779b1u);
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return (xLearn::index_t)(h & mask);
+}
 
-int wl_xl_fit(
-    void *handle,
-    void *dtrain,
-    void *dvalid,
-    char **out_model_buf,
-    int *out_model_len
+int wl_xl_create_dmatrix_hashed(
+    const int *fields, const uint32_t *hashes, const float *values, int nnz,
+    const int *row_ptr, int nrow,
+    int hash_bits,
+    const float *label,
+    void **out
 ) {
   last_error[0] = '\0';
-  if (!handle || !dtrain || !out_model_buf || !out_model_len) {
-    set_error("wl_xl_fit: null argument");
+  if (!fields || !hashes || !row_ptr || nrow <= 0 || !out ||
+      hash_bits < 1 || hash_bits > kMaxHashBits) {
+    set_error("wl_xl_create_dmatrix_hashed: invalid arguments");
     return -1;
   }
-
-  /* Assign DMatrix to handle */
-  DataHandle train_dh = dtrain;
-  int ret = XLearnSetDMatrix(&handle, "train", &train_dh);
-  if (ret != 0) {
-    const char *err = XLearnGetLastError();
-    set_error(err ? err : "XLearnSetDMatrix(train) failed");
+  if (!csr_row_ptr_valid(row_ptr, nrow, nnz)) {
+    set_error("wl_xl_create_dmatrix_hashed: row_ptr out of range");
     return -1;
   }
-
-  if (dvalid) {
-    DataHandle valid_dh = dvalid;
-    ret = XLearnSetDMatrix(&handle, "validate", &valid_dh);
-    if (ret != 0) {
-      const char *err = XLearnGetLastError();
-      set_error(err ? err : "XLearnSetDMatrix(validate) failed");
+  for (int j = row_ptr[0]; j < row_ptr[nrow]; ++j) {
+    if (fields[j] < 0) {
+      set_error("wl_xl_create_dmatrix_hashed: negative field id");
       return -1;
     }
   }
 
-  /* Train and save model to MEMFS */
-  char model_path[64];
-  snprintf(model_path, sizeof(model_path), "/tmp/wl_xl_model_%d", fit_counter++);
+  uint32_t mask = (uint32_t)((1u << hash_bits) - 1);
+  xLearn::DMatrix *matrix = nullptr;
+  try {
+    matrix = alloc_dmatrix(nrow, label != nullptr);
 
-  suppress_stdout();
-  ret = XLearnFit(&handle, model_path);
-  restore_stdout();
-  if (ret != 0) {
-    const char *err = XLearnGetLastError();
-    set_error(err ? err : "XLearnFit failed");
-    remove(model_path);
+    for (int i = 0; i < nrow; ++i) {
+      if (label) {
+        matrix->Y[i] = label[i];
+      }
+      int start = row_ptr[i], end = row_ptr[i + 1];
+      xLearn::SparseRow *row = new xLearn::SparseRow();
+      matrix->row[i] = row;
+      row->reserve(end > start ? (size_t)(end - start) : 0);
+
+      float norm = 0.0f;
+      for (int j = start; j < end; ++j) {
+        float val = values ? values[j] : 1.0f;
+        xLearn::index_t field_id = (xLearn::index_t)fields[j];
+        row->push_back(xLearn::Node(
+          field_id, hash_feature(field_id, hashes[j], mask), val));
+        norm += val * val;
+      }
+      matrix->norm[i] = (norm > 0.0f) ? (1.0f / norm) : 1.0f;
+    }
+
+    *out = matrix;
+    return 0;
+  } catch (const std::exception &e) {
+    if (matrix) destroy_dmatrix(matrix);
+    set_error(e.what());
     return -1;
   }
+}
 
-  /* Read model bytes from MEMFS */
-  FILE *f = fopen(model_path, "rb");
-  if (!f) {
-    set_error("wl_xl_fit: cannot read model file from MEMFS");
-    return -1;
+/* Drop a reference; the last one frees the DMatrix. */
+void wl_xl_free_dmatrix(void *dmatrix) {
+  if (dmatrix) {
+    WlDMatrix *m = static_cast<WlDMatrix*>(
+      reinterpret_cast<xLearn::DMatrix*>(dmatrix));
+    if (m->refs.fetch_sub(1) == 1) destroy_dmatrix(m);
   }
+}
 
-  fseek(f, 0, SEEK_END);
-  long size = ftell(f);
-  fseek(f, 0, SEEK_SET);
+/*
+ * Heap bytes held by a DMatrix: its rows' nodes, row objects, labels
+ * and norms (shared by every reference).
+ */
+double wl_xl_dmatrix_bytes(void *dmatrix) {
+  if (!dmatrix) return 0;
+  const WlDMatrix *m = static_cast<const WlDMatrix*>(
+    reinterpret_cast<const xLearn::DMatrix*>(dmatrix));
+  double n = sizeof(WlDMatrix)
+    + (double)sizeof(xLearn::SparseRow*) * (m->row.capacity() + m->spare.capacity())
+    + (double)sizeof(xLearn::real_t)
+      * (m->Y.capacity() + m->norm.capacity() + m->weight.capacity());
+  for (const xLearn::SparseRow *r : m->row) {
+    if (r) n += sizeof(*r) + (double)sizeof(xLearn::Node) * r->capacity();
+  }
+  for (const xLearn::SparseRow *r : m->spare) {
+    n += sizeof(*r) + (double)sizeof(xLearn::Node) * r->capacity();
+  }
+  return n;
+}
 
-  char *buf = (char *)malloc((size_t)size);
-  if (!buf) {
-    fclose(f);
-    remove(model_path);
-    set_error("wl_xl_fit: allocation failed");
+/* Add a reference to a DMatrix. Returns the new count. */
+int wl_xl_dmatrix_retain(void *dmatrix) {
+  last_error[0] = '\0';
+  if (!dmatrix) {
+    set_error("wl_xl_dmatrix_retain: null argument");
     return -1;
   }
-
-  fread(buf, 1, (size_t)size, f);
-  fclose(f);
-  remove(model_path);
-
-  *out_model_buf = buf;
-  *out_model_len = (int)size;
-  return 0;
+  WlDMatrix *m = static_cast<WlDMatrix*>(
+    reinterpret_cast<xLearn::DMatrix*>(dmatrix));
+  return m->refs.fetch_add(1) + 1;
 }
 
-/* ---------- predict ---------- */
+static inline const std::vector<xLearn::real_t> &row_weights(
+    const xLearn::DMatrix *dm) {
+  return static_cast<const WlDMatrix*>(dm)->weight;
+}
 
-int wl_xl_predict(
-    void *handle,
-    const char *model_buf, int model_len,
-    void *dtest,
-    float **out_preds, int *out_len
-) {
+/*
+ * Attach per-row sample weights (n == nrow, finite and >= 0) to a
+ * labeled DMatrix, or drop them with weights == nullptr. Every handle
+ * trained on the matrix uses them. Weights that are all 1 are dropped
+ * too, so such a matrix still trains with upstream's trainer.
+ */
+int wl_xl_dmatrix_set_weights(void *dmatrix, const float *weights, int n) {
   last_error[0] = '\0';
-  if (!handle || !model_buf || model_len <= 0 || !dtest || !out_preds || !out_len) {
-    set_error("wl_xl_predict: null argument");
+  if (!dmatrix) {
+    set_error("wl_xl_dmatrix_set_weights: null argument");
     return -1;
   }
-
+  WlDMatrix *m = static_cast<WlDMatrix*>(
+    reinterpret_cast<xLearn::DMatrix*>(dmatrix));
+  if (!weights) {
+    std::vector<xLearn::real_t>().swap(m->weight);
+    return 0;
+  }
+  if (!m->has_label || n != (int)m->row_length) {
+    set_error("wl_xl_dmatrix_set_weights: need one weight per labeled row");
+    return -1;
+  }
+  bool unit = true;
+  for (int i = 0; i < n; ++i) {
+    if (!(weights[i] >= 0.0f) || std::isinf(weights[i])) {
+      set_error("wl_xl_dmatrix_set_weights: weights must be finite and >= 0");
+      return -1;
+    }
+    unit = unit && weights[i] == 1.0f;
+  }
+  if (unit) {
+    std::vector<xLearn::real_t>().swap(m->weight);
+    return 0;
+  }
+  try {
+    m->weight.assign(weights, weights + n);
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* ---------- DMatrix from streamed chunks ---------- */
+
+/*
+ * Incremental DMatrix construction: begin, append any number of dense
+ * or CSR row chunks, then finish to get a regular DMatrix handle. Only
+ * the current chunk needs to be staged in the heap, so peak memory is
+ * the DMatrix itself plus one chunk.
+ */
+struct WlDMatrixBuilder {
+  xLearn::DMatrix *matrix = nullptr;
+  int ncol = 0;
+  std::vector<int> field_map;
+};
+
+int wl_xl_dmatrix_begin(int ncol, int has_label, const int *field_map,
+                        void **out) {
+  last_error[0] = '\0';
+  if (ncol <= 0 || !out) {
+    set_error("wl_xl_dmatrix_begin: invalid arguments");
+    return -1;
+  }
+  try {
+    WlDMatrixBuilder *b = new WlDMatrixBuilder();
+    b->ncol = ncol;
+    if (field_map) b->field_map.assign(field_map, field_map + ncol);
+    b->matrix = alloc_dmatrix(0, has_label != 0);
+    *out = b;
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+static int check_chunk_label(WlDMatrixBuilder *b, const float *label,
+                             const char *fn) {
+  if ((label != nullptr) != b->matrix->has_label) {
+    std::string msg = std::string(fn) + ": labels must match wl_xl_dmatrix_begin";
+    set_error(msg.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+int wl_xl_dmatrix_append_rows(void *builder, const float *data, int nrow,
+                              const float *label) {
+  last_error[0] = '\0';
+  if (!builder || !data || nrow <= 0) {
+    set_error("wl_xl_dmatrix_append_rows: invalid arguments");
+    return -1;
+  }
+  WlDMatrixBuilder *b = reinterpret_cast<WlDMatrixBuilder*>(builder);
+  if (check_chunk_label(b, label, "wl_xl_dmatrix_append_rows") != 0) return -1;
+
+  try {
+    const int *fmap = b->field_map.empty() ? nullptr : b->field_map.data();
+    size_t base = b->matrix->row_length;
+    grow_dmatrix(b->matrix, nrow);
+    for (int i = 0; i < nrow; ++i) {
+      if (label) b->matrix->Y[base + i] = label[i];
+      fill_dense_row(b->matrix, base + i, data + (size_t)i * b->ncol,
+                     b->ncol, fmap);
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+int wl_xl_dmatrix_append_csr(void *builder,
+                             const float *values, int nnz,
+                             const int *col_indices,
+                             const int *row_ptr, int nrow,
+                             const float *label) {
+  last_error[0] = '\0';
+  if (!builder || !values || !col_indices || !row_ptr || nrow <= 0) {
+    set_error("wl_xl_dmatrix_append_csr: invalid arguments");
+    return -1;
+  }
+  WlDMatrixBuilder *b = reinterpret_cast<WlDMatrixBuilder*>(builder);
+  if (check_chunk_label(b, label, "wl_xl_dmatrix_append_csr") != 0) return -1;
+  if (!csr_row_ptr_valid(row_ptr, nrow, nnz)) {
+    set_error("wl_xl_dmatrix_append_csr: row_ptr out of range");
+    return -1;
+  }
+  if (!csr_cols_valid(col_indices, row_ptr, nrow, b->ncol)) {
+    set_error("wl_xl_dmatrix_append_csr: column index out of range");
+    return -1;
+  }
+
+  try {
+    const int *fmap = b->field_map.empty() ? nullptr : b->field_map.data();
+    size_t base = b->matrix->row_length;
+    grow_dmatrix(b->matrix, nrow);
+    for (int i = 0; i < nrow; ++i) {
+      if (label) b->matrix->Y[base + i] = label[i];
+      fill_csr_row(b->matrix, base + i, values, col_indices,
+                   row_ptr[i], row_ptr[i + 1], fmap);
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* Release the builder and hand over the DMatrix it built. */
+int wl_xl_dmatrix_finish(void *builder, void **out) {
+  last_error[0] = '\0';
+  if (!builder || !out) {
+    set_error("wl_xl_dmatrix_finish: null argument");
+    return -1;
+  }
+  WlDMatrixBuilder *b = reinterpret_cast<WlDMatrixBuilder*>(builder);
+  if (b->matrix->row_length == 0) {
+    set_error("wl_xl_dmatrix_finish: no rows appended");
+    return -1;
+  }
+  *out = b->matrix;
+  delete b;
+  return 0;
+}
+
+/* Discard a builder and everything appended to it. */
+void wl_xl_dmatrix_abort(void *builder) {
+  if (builder) {
+    WlDMatrixBuilder *b = reinterpret_cast<WlDMatrixBuilder*>(builder);
+    destroy_dmatrix(b->matrix);
+    delete b;
+  }
+}
+
+/* ---------- upstream output ---------- */
+
+/*
+ * Upstream prints its banner, progress and epoch tables to std::cout.
+ * Rather than redirecting fd 1 around every call (process-wide, racy
+ * and a handful of syscalls each time), the stream is detached once at
+ * startup: with no streambuf every insertion fails its sentry before
+ * formatting anything, so upstream's logging costs nothing and writes
+ * nothing. wl_xl_set_verbose(1) reattaches it for debugging.
+ */
+static std::streambuf *cout_buf = std::cout.rdbuf(nullptr);
+
+void wl_xl_set_verbose(int verbose) {
+  std::cout.rdbuf(verbose ? cout_buf : nullptr);
+}
+
+/* ---------- model blob I/O ---------- */
+
+/*
+ * Cursor over an in-memory copy of upstream's binary model format, as
+ * written by xLearn::Model::Serialize:
+ *
+ *   size_t, char[]     score function name
+ *   size_t, char[]     loss function name
+ *   index_t x 4        num_feat, num_field, num_K, aux_size
+ *   index_t, real_t[]  w (linear weights, interleaved with opt state)
+ *   index_t, real_t[]  v (latent factors, count is 0 for linear)
+ *   real_t[aux_size]   b (bias and its opt state)
+ */
+struct BlobReader {
+  const char *pos;
+  const char *end;
+
+  bool read(void *dst, size_t n) {
+    if ((size_t)(end - pos) < n) return false;
+    memcpy(dst, pos, n);
+    pos += n;
+    return true;
+  }
+
+  bool read_string(std::string &out) {
+    size_t len = 0;
+    if (!read(&len, sizeof(len)) || (size_t)(end - pos) < len) return false;
+    out.assign(pos, len);
+    pos += len;
+    return true;
+  }
+};
+
+struct BlobWriter {
+  char *pos;
+
+  void write(const void *src, size_t n) {
+    memcpy(pos, src, n);
+    pos += n;
+  }
+
+  void write_string(const std::string &str) {
+    size_t len = str.size();
+    write(&len, sizeof(len));
+    write(str.data(), len);
+  }
+};
+
+/* Exact byte length of a model in upstream's binary format. */
+static size_t model_blob_size(xLearn::Model *model) {
+  return 2 * sizeof(size_t)
+    + model->GetScoreFunction().size()
+    + model->GetLossFunction().size()
+    + 6 * sizeof(xLearn::index_t)
+    + sizeof(xLearn::real_t) * ((size_t)model->GetNumParameter_w()
+                                + model->GetNumParameter_v()
+                                + model->GetAuxiliarySize());
+}
+
+/* Serialize a model into buf, which must hold model_blob_size() bytes. */
+static void write_model(xLearn::Model *model, char *buf) {
+  BlobWriter w = { buf };
+  xLearn::index_t num_feat = model->GetNumFeature();
+  xLearn::index_t num_field = model->GetNumField();
+  xLearn::index_t num_K = model->GetNumK();
+  xLearn::index_t aux_size = model->GetAuxiliarySize();
+  xLearn::index_t num_w = model->GetNumParameter_w();
+  xLearn::index_t num_v = model->GetNumParameter_v();
+
+  w.write_string(model->GetScoreFunction());
+  w.write_string(model->GetLossFunction());
+  w.write(&num_feat, sizeof(num_feat));
+  w.write(&num_field, sizeof(num_field));
+  w.write(&num_K, sizeof(num_K));
+  w.write(&aux_size, sizeof(aux_size));
+  w.write(&num_w, sizeof(num_w));
+  w.write(model->GetParameter_w(), sizeof(xLearn::real_t) * num_w);
+  w.write(&num_v, sizeof(num_v));
+  if (num_v > 0) {
+    w.write(model->GetParameter_v(), sizeof(xLearn::real_t) * num_v);
+  }
+  w.write(model->GetParameter_b(), sizeof(xLearn::real_t) * aux_size);
+}
+
+/* model_blob_size() of a blocked model's upstream equivalent */
+static size_t blocked_blob_size(const wl_ffm::BlockedFFM &m) {
+  return 2 * sizeof(size_t) + 3 + m.loss_func.size()
+    + 6 * sizeof(xLearn::index_t)
+    + sizeof(xLearn::real_t) * (m.w.size() + m.num_v() * m.aux_size
+                                + m.aux_size);
+}
+
+/* write_model() of a blocked model, re-interleaving v block by block */
+static void write_blocked(const wl_ffm::BlockedFFM &m, char *buf) {
+  BlobWriter w = { buf };
+  xLearn::index_t num_w = (xLearn::index_t)m.w.size();
+  xLearn::index_t num_v = (xLearn::index_t)(m.num_v() * m.aux_size);
+
+  w.write_string("ffm");
+  w.write_string(m.loss_func);
+  w.write(&m.num_feat, sizeof(m.num_feat));
+  w.write(&m.num_field, sizeof(m.num_field));
+  w.write(&m.num_K, sizeof(m.num_K));
+  w.write(&m.aux_size, sizeof(m.aux_size));
+  w.write(&num_w, sizeof(num_w));
+  w.write(m.w.data(), sizeof(xLearn::real_t) * num_w);
+  w.write(&num_v, sizeof(num_v));
+  std::vector<xLearn::real_t> block((size_t)m.aux_size * m.aligned_k);
+  size_t nb = (size_t)m.num_feat * m.num_field;
+  for (size_t n = 0; n < nb; ++n) {
+    wl_ffm::pack_block(m, n, block.data());
+    w.write(block.data(), sizeof(xLearn::real_t) * block.size());
+  }
+  w.write(m.b.data(), sizeof(xLearn::real_t) * m.aux_size);
+}
+
+/* Parse model bytes into a freshly initialized xLearn::Model. */
+static xLearn::Model *parse_model(const char *buf, int len) {
+  BlobReader r = { buf, buf + len };
+  std::string score_func, loss_func;
+  xLearn::index_t num_feat = 0, num_field = 0, num_K = 0, aux_size = 0;
+  if (!r.read_string(score_func) || !r.read_string(loss_func) ||
+      !r.read(&num_feat, sizeof(num_feat)) ||
+      !r.read(&num_field, sizeof(num_field)) ||
+      !r.read(&num_K, sizeof(num_K)) ||
+      !r.read(&aux_size, sizeof(aux_size))) {
+    set_error("wl_xl_load_model: truncated model header");
+    return nullptr;
+  }
+
+  std::unique_ptr<xLearn::Model> model(new xLearn::Model());
+  model->Initialize(score_func, loss_func, num_feat, num_field, num_K, aux_size);
+
+  xLearn::index_t num_w = 0, num_v = 0;
+  if (!r.read(&num_w, sizeof(num_w)) || num_w != model->GetNumParameter_w() ||
+      !r.read(model->GetParameter_w(), sizeof(xLearn::real_t) * num_w) ||
+      !r.read(&num_v, sizeof(num_v)) || num_v != model->GetNumParameter_v() ||
+      (num_v > 0 &&
+       !r.read(model->GetParameter_v(), sizeof(xLearn::real_t) * num_v)) ||
+      !r.read(model->GetParameter_b(), sizeof(xLearn::real_t) * aux_size)) {
+    set_error("wl_xl_load_model: model parameters do not match header");
+    return nullptr;
+  }
+  return model.release();
+}
+
+/*
+ * Move an FFM model into the blocked layout (other models stay as
+ * they are). The upstream copy is freed once the blocked one is built.
+ */
+static int to_blocked(WlHandle *h) {
+  if (!WL_XL_HAS_FFM || !h->model || h->model->GetScoreFunction() != "ffm") {
+    return 0;
+  }
+  std::unique_ptr<wl_ffm::BlockedFFM> bm(new wl_ffm::BlockedFFM());
+  if (!wl_ffm::from_model(*h->model, *bm)) {
+    set_error("blocked layout: allocation failed");
+    return -1;
+  }
+  wl_stats_alloc(h->stats.get());
+  h->bmodel = std::move(bm);
+  h->model.reset();
+  h->fast_score = nullptr;
+  return 0;
+}
+
+/*
+ * The handle's full-precision model in upstream's layout: the resident
+ * one, or a copy of the blocked model in tmp. nullptr if it has none.
+ */
+static xLearn::Model *full_model(WlHandle *h,
+                                 std::unique_ptr<xLearn::Model> &tmp) {
+  if (h->model) return h->model.get();
+  if (!h->bmodel) return nullptr;
+  tmp.reset(wl_ffm::to_model(*h->bmodel));
+  return tmp.get();
+}
+
+/* Make model the handle's prepared model. Takes ownership. */
+static int install_model(WlHandle *h, xLearn::Model *model) {
+  std::unique_ptr<xLearn::Model> owned(model);
+  std::unique_ptr<xLearn::Score> score(
+    CREATE_SCORE(owned->GetScoreFunction().c_str()));
+  if (!score) {
+    set_error("unknown score function in model");
+    return -1;
+  }
+  wl_stats_alloc(h->stats.get());
+  h->model = std::move(owned);
+  h->score = std::move(score);
+  h->qmodel.reset();
+  h->pmodel.reset();
+  h->bmodel.reset();
+  h->snapshot.clear();
+#ifdef WL_XL_UPSTREAM_SCORE
+  h->fast_score = nullptr;
+#else
+  h->fast_score = wl_fast::select(h->model->GetScoreFunction(),
+                                  h->model->get_aligned_k(),
+                                  h->model->GetAuxiliarySize());
+#endif
+  if (h->blocked_layout) return to_blocked(h);
+  return 0;
+}
+
+int wl_xl_load_model(void *handle, const char *model_buf, int model_len) {
+  last_error[0] = '\0';
+  if (!handle || !model_buf || model_len <= 0) {
+    set_error("wl_xl_load_model: null argument");
+    return -1;
+  }
+
+  WlHandle *h = as_handle(handle);
+  try {
+    WlPhaseTimer timer(h->stats.get(), kPhaseLoad);
+    wl_stats_bytes(h->stats.get(), model_len);
+    xLearn::Model *model = parse_model(model_buf, model_len);
+    if (!model) return -1;
+    return install_model(h, model);
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+int wl_xl_model_size(void *handle) {
+  last_error[0] = '\0';
+  WlHandle *h = handle ? as_handle(handle) : nullptr;
+  if (h && h->bmodel) return (int)blocked_blob_size(*h->bmodel);
+  if (!h || !h->model) {
+    set_error("wl_xl_model_size: no model loaded");
+    return -1;
+  }
+  return (int)model_blob_size(h->model.get());
+}
+
+int wl_xl_save_model(void *handle, char *buf, int len) {
+  last_error[0] = '\0';
+  if (!handle || !buf) {
+    set_error("wl_xl_save_model: null argument");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (!h->model && !h->bmodel) {
+    set_error("wl_xl_save_model: no model loaded");
+    return -1;
+  }
+  size_t size = h->bmodel ? blocked_blob_size(*h->bmodel)
+                          : model_blob_size(h->model.get());
+  if ((size_t)len < size) {
+    set_error("wl_xl_save_model: buffer too small");
+    return -1;
+  }
+  WlPhaseTimer timer(h->stats.get(), kPhaseSave);
+  wl_stats_bytes(h->stats.get(), (double)size);
+  if (h->bmodel) {
+    write_blocked(*h->bmodel, buf);
+  } else {
+    write_model(h->model.get(), buf);
+  }
+  return 0;
+}
+
+/* ---------- FFM layout ---------- */
+
+/*
+ * Select the layout FFM models on this handle are kept in: 0 for
+ * upstream's interleaved one, 1 for the blocked one (ffm_blocked.h).
+ * A resident model is converted in place; later fits and loads follow
+ * the setting. Other model types ignore it.
+ */
+int wl_xl_set_layout(void *handle, int blocked) {
+  last_error[0] = '\0';
+  if (!handle || blocked < 0 || blocked > 1) {
+    set_error("wl_xl_set_layout: invalid arguments");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  h->blocked_layout = blocked != 0;
+  try {
+    if (blocked) return to_blocked(h);
+    if (!h->bmodel) return 0;
+    std::unique_ptr<xLearn::Model> model(wl_ffm::to_model(*h->bmodel));
+    return install_model(h, model.release());
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/*
+ * Score FFM rows of at least min_nnz entries with intra-row parallel
+ * bands (ffm_parallel.h) on up to nthread threads; 0 turns it off.
+ * Other model types ignore it.
+ */
+int wl_xl_set_parallel_nnz(void *handle, int min_nnz) {
+  last_error[0] = '\0';
+  if (!handle || min_nnz < 0) {
+    set_error("wl_xl_set_parallel_nnz: invalid arguments");
+    return -1;
+  }
+  as_handle(handle)->parallel_nnz = min_nnz;
+  return 0;
+}
+
+/* ---------- quantized model I/O ---------- */
+
+/*
+ * Inference-only model format (see quant_score.h):
+ *
+ *   char[4]            "WLQ1"
+ *   size_t, char[]     score function name
+ *   index_t x 5        num_feat, num_field, num_K, aligned_k, bits
+ *   real_t[num_feat]   w
+ *   real_t             b
+ *   real_t[blocks]     per-block scales (bits == 8 only)
+ *   uint16_t/int8_t[blocks * aligned_k]  v
+ */
+static const char kQuantMagic[4] = { 'W', 'L', 'Q', '1' };
+
+static size_t quant_v_bytes(const wl_quant::QuantModel &q) {
+  return q.bits == 8 ? q.v8.size() : q.v16.size() * sizeof(uint16_t);
+}
+
+static size_t quant_blob_size(const wl_quant::QuantModel &q) {
+  return sizeof(kQuantMagic)
+         + sizeof(size_t) + q.score_func.size()
+         + 5 * sizeof(xLearn::index_t)
+         + sizeof(xLearn::real_t) * (q.w.size() + 1 + q.scales.size())
+         + quant_v_bytes(q);
+}
+
+static void write_quant(const wl_quant::QuantModel &q, xLearn::index_t num_K,
+                        char *buf) {
+  BlobWriter w = { buf };
+  w.write(kQuantMagic, sizeof(kQuantMagic));
+  w.write_string(q.score_func);
+  w.write(&q.num_feat, sizeof(q.num_feat));
+  w.write(&q.num_field, sizeof(q.num_field));
+  w.write(&num_K, sizeof(num_K));
+  w.write(&q.aligned_k, sizeof(q.aligned_k));
+  w.write(&q.bits, sizeof(q.bits));
+  w.write(q.w.data(), sizeof(xLearn::real_t) * q.w.size());
+  w.write(&q.b, sizeof(q.b));
+  w.write(q.scales.data(), sizeof(xLearn::real_t) * q.scales.size());
+  if (q.bits == 8) {
+    w.write(q.v8.data(), q.v8.size());
+  } else {
+    w.write(q.v16.data(), q.v16.size() * sizeof(uint16_t));
+  }
+}
+
+static wl_quant::QuantModel *parse_quant(const char *buf, int len,
+                                         xLearn::index_t *num_K) {
+  BlobReader r = { buf, buf + len };
+  char magic[4];
+  std::string score_func;
+  std::unique_ptr<wl_quant::QuantModel> q(new wl_quant::QuantModel());
+  if (!r.read(magic, sizeof(magic)) ||
+      memcmp(magic, kQuantMagic, sizeof(magic)) != 0) {
+    set_error("wl_xl_load_quantized: not a quantized model");
+    return nullptr;
+  }
+  if (!r.read_string(score_func) ||
+      !r.read(&q->num_feat, sizeof(q->num_feat)) ||
+      !r.read(&q->num_field, sizeof(q->num_field)) ||
+      !r.read(num_K, sizeof(*num_K)) ||
+      !r.read(&q->aligned_k, sizeof(q->aligned_k)) ||
+      !r.read(&q->bits, sizeof(q->bits))) {
+    set_error("wl_xl_load_quantized: truncated header");
+    return nullptr;
+  }
+  if (!q->set_score_func(score_func) || (q->bits != 8 && q->bits != 16) ||
+      q->aligned_k % xLearn::kAlign != 0) {
+    set_error("wl_xl_load_quantized: unsupported model");
+    return nullptr;
+  }
+
+  size_t nv = (size_t)q->num_blocks() * q->aligned_k;
+  q->w.resize(q->num_feat);
+  if (q->bits == 8) {
+    q->scales.resize(q->num_blocks());
+    q->v8.resize(nv);
+  } else {
+    q->v16.resize(nv);
+  }
+  if (!r.read(q->w.data(), sizeof(xLearn::real_t) * q->w.size()) ||
+      !r.read(&q->b, sizeof(q->b)) ||
+      !r.read(q->scales.data(), sizeof(xLearn::real_t) * q->scales.size()) ||
+      !r.read(q->bits == 8 ? (void *)q->v8.data() : (void *)q->v16.data(),
+              quant_v_bytes(*q))) {
+    set_error("wl_xl_load_quantized: truncated weights");
+    return nullptr;
+  }
+  return q.release();
+}
+
+/*
+ * Quantize the handle's model to bits = 16 (fp16) or 8 (int8 with
+ * per-block scales) and return the inference-only blob in a malloc'd
+ * buffer (free with wl_xl_free_buffer).
+ */
+int wl_xl_save_quantized(void *handle, int bits, char **out_buf,
+                         int *out_len) {
+  last_error[0] = '\0';
+  if (!handle || !out_buf || !out_len || (bits != 8 && bits != 16)) {
+    set_error("wl_xl_save_quantized: invalid arguments");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  try {
+    WlPhaseTimer timer(h->stats.get(), kPhaseSave);
+    wl_quant::QuantModel q;
+    xLearn::index_t num_K;
+    std::unique_ptr<xLearn::Model> tmp;
+    if (xLearn::Model *model = full_model(h, tmp)) {
+      wl_quant::quantize(*model, (xLearn::index_t)bits, q);
+      num_K = model->GetNumK();
+    } else if (h->qmodel && h->qmodel->bits == (xLearn::index_t)bits) {
+      q = *h->qmodel;
+      num_K = h->quant_num_k;
+    } else {
+      set_error("wl_xl_save_quantized: no full-precision model loaded");
+      return -1;
+    }
+
+    size_t size = quant_blob_size(q);
+    char *buf = (char *)malloc(size);
+    if (!buf) {
+      set_error("wl_xl_save_quantized: allocation failed");
+      return -1;
+    }
+    wl_stats_alloc(h->stats.get());
+    wl_stats_bytes(h->stats.get(), (double)size);
+    write_quant(q, num_K, buf);
+    *out_buf = buf;
+    *out_len = (int)size;
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* Make a quantized blob the handle's (inference-only) prepared model. */
+int wl_xl_load_quantized(void *handle, const char *buf, int len) {
+  last_error[0] = '\0';
+  if (!handle || !buf || len <= 0) {
+    set_error("wl_xl_load_quantized: null argument");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  try {
+    WlPhaseTimer timer(h->stats.get(), kPhaseLoad);
+    wl_stats_bytes(h->stats.get(), len);
+    xLearn::index_t num_K = 0;
+    wl_quant::QuantModel *q = parse_quant(buf, len, &num_K);
+    if (!q) return -1;
+    h->qmodel.reset(q);
+    h->quant_num_k = num_K;
+    h->pmodel.reset();
+    h->model.reset();
+    h->bmodel.reset();
+    h->score.reset();
+    h->fast_score = nullptr;
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* ---------- paged model I/O ---------- */
+
+/*
+ * Inference-only paged model format (see paged_model.h):
+ *
+ *   char[4]            "WLP1"
+ *   uint32_t           header bytes (everything before the first page)
+ *   size_t, char[]     score function name
+ *   index_t x 5        num_feat, num_field, num_K, aligned_k, block_feats
+ *   real_t             b
+ *   uint32_t[pages+1]  page byte offsets from the blob start (last = end)
+ *   pages              real_t w[n], real_t v[n * latent] per page
+ *
+ * Only the header is handed to wl_xl_load_paged; pages are read by the
+ * caller into the buffers wl_xl_paged_page_in returns.
+ */
+static const char kPagedMagic[4] = { 'W', 'L', 'P', '1' };
+
+static size_t paged_header_size(const wl_paged::PagedModel &pm) {
+  return sizeof(kPagedMagic) + sizeof(uint32_t)
+         + sizeof(size_t) + pm.score_func.size()
+         + 5 * sizeof(xLearn::index_t) + sizeof(xLearn::real_t)
+         + sizeof(uint32_t) * ((size_t)pm.num_pages() + 1);
+}
+
+/*
+ * Split the handle's full-precision model into pages of block_features
+ * features and return header + pages in a malloc'd buffer (free with
+ * wl_xl_free_buffer).
+ */
+int wl_xl_save_paged(void *handle, int block_features, char **out_buf,
+                     int *out_len) {
+  last_error[0] = '\0';
+  if (!handle || !out_buf || !out_len || block_features <= 0) {
+    set_error("wl_xl_save_paged: invalid arguments");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (!h->model && !h->bmodel) {
+    set_error("wl_xl_save_paged: no full-precision model loaded");
+    return -1;
+  }
+
+  try {
+    std::unique_ptr<xLearn::Model> tmp;
+    xLearn::Model *model = full_model(h, tmp);
+    wl_paged::PagedModel pm;
+    if (!pm.set_score_func(model->GetScoreFunction())) {
+      set_error("wl_xl_save_paged: unsupported score function");
+      return -1;
+    }
+    pm.num_feat = model->GetNumFeature();
+    pm.num_field = model->GetNumField();
+    pm.num_K = model->GetNumK();
+    pm.aligned_k = pm.kind == wl_paged::PagedModel::kLinear
+                   ? 0 : model->get_aligned_k();
+    pm.block_feats = (xLearn::index_t)block_features;
+    pm.b = model->GetParameter_b()[0];
+
+    xLearn::index_t np = pm.num_pages();
+    std::vector<uint32_t> offsets((size_t)np + 1);
+    size_t size = paged_header_size(pm);
+    for (xLearn::index_t p = 0; p < np; ++p) {
+      offsets[p] = (uint32_t)size;
+      size += pm.page_bytes(p);
+    }
+    offsets[np] = (uint32_t)size;
+    if (size > 0x7fffffff) {
+      set_error("wl_xl_save_paged: model too large");
+      return -1;
+    }
+
+    char *buf = (char *)malloc(size);
+    if (!buf) {
+      set_error("wl_xl_save_paged: allocation failed");
+      return -1;
+    }
+    uint32_t header_len = offsets[0];
+    BlobWriter w = { buf };
+    w.write(kPagedMagic, sizeof(kPagedMagic));
+    w.write(&header_len, sizeof(header_len));
+    w.write_string(pm.score_func);
+    w.write(&pm.num_feat, sizeof(pm.num_feat));
+    w.write(&pm.num_field, sizeof(pm.num_field));
+    w.write(&pm.num_K, sizeof(pm.num_K));
+    w.write(&pm.aligned_k, sizeof(pm.aligned_k));
+    w.write(&pm.block_feats, sizeof(pm.block_feats));
+    w.write(&pm.b, sizeof(pm.b));
+    w.write(offsets.data(), sizeof(uint32_t) * offsets.size());
+    for (xLearn::index_t p = 0; p < np; ++p) {
+      wl_paged::fill_page(*model, pm, p * pm.block_feats, pm.page_feats(p),
+                          (xLearn::real_t *)(buf + offsets[p]));
+    }
+
+    *out_buf = buf;
+    *out_len = (int)size;
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/*
+ * Make a paged model, given just its header, the handle's prepared
+ * model. No page is resident; at most max_resident (0: all) are kept.
+ */
+int wl_xl_load_paged(void *handle, const char *header, int len,
+                     int max_resident) {
+  last_error[0] = '\0';
+  if (!handle || !header || len <= 0 || max_resident < 0) {
+    set_error("wl_xl_load_paged: invalid arguments");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  try {
+    WlPhaseTimer timer(h->stats.get(), kPhaseLoad);
+    wl_stats_bytes(h->stats.get(), len);
+    BlobReader r = { header, header + len };
+    char magic[4];
+    uint32_t header_len = 0;
+    std::string score_func;
+    std::unique_ptr<wl_paged::PagedModel> pm(new wl_paged::PagedModel());
+    if (!r.read(magic, sizeof(magic)) ||
+        memcmp(magic, kPagedMagic, sizeof(magic)) != 0 ||
+        !r.read(&header_len, sizeof(header_len))) {
+      set_error("wl_xl_load_paged: not a paged model");
+      return -1;
+    }
+    if (!r.read_string(score_func) ||
+        !r.read(&pm->num_feat, sizeof(pm->num_feat)) ||
+        !r.read(&pm->num_field, sizeof(pm->num_field)) ||
+        !r.read(&pm->num_K, sizeof(pm->num_K)) ||
+        !r.read(&pm->aligned_k, sizeof(pm->aligned_k)) ||
+        !r.read(&pm->block_feats, sizeof(pm->block_feats)) ||
+        !r.read(&pm->b, sizeof(pm->b))) {
+      set_error("wl_xl_load_paged: truncated header");
+      return -1;
+    }
+    if (!pm->set_score_func(score_func) || pm->block_feats == 0 ||
+        pm->aligned_k % xLearn::kAlign != 0) {
+      set_error("wl_xl_load_paged: unsupported model");
+      return -1;
+    }
+
+    xLearn::index_t np = pm->num_pages();
+    std::vector<uint32_t> offsets((size_t)np + 1);
+    if (!r.read(offsets.data(), sizeof(uint32_t) * offsets.size()) ||
+        header_len != paged_header_size(*pm) || offsets[0] != header_len) {
+      set_error("wl_xl_load_paged: truncated page table");
+      return -1;
+    }
+    pm->pages.resize(np);
+    for (xLearn::index_t p = 0; p < np; ++p) {
+      if (offsets[p + 1] < offsets[p] ||
+          offsets[p + 1] - offsets[p] != pm->page_bytes(p)) {
+        set_error("wl_xl_load_paged: page table does not match header");
+        return -1;
+      }
+      pm->pages[p].offset = offsets[p];
+      pm->pages[p].length = offsets[p + 1] - offsets[p];
+    }
+    pm->max_resident = (size_t)max_resident;
+
+    h->pmodel = std::move(pm);
+    h->qmodel.reset();
+    h->model.reset();
+    h->bmodel.reset();
+    h->score.reset();
+    h->fast_score = nullptr;
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/*
+ * Start a batch over dmatrix: its pages are protected from eviction
+ * until the next batch. Writes up to capacity ids of the pages it needs
+ * that are not resident and returns their count.
+ */
+int wl_xl_paged_missing(void *handle, void *dmatrix, int *out_pages,
+                        int capacity) {
+  last_error[0] = '\0';
+  if (!handle || !dmatrix || (!out_pages && capacity > 0)) {
+    set_error("wl_xl_paged_missing: invalid arguments");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (!h->pmodel) {
+    set_error("wl_xl_paged_missing: no paged model loaded");
+    return -1;
+  }
+  try {
+    std::vector<xLearn::index_t> missing;
+    wl_paged::begin_batch(*h->pmodel,
+                          *reinterpret_cast<xLearn::DMatrix*>(dmatrix),
+                          missing);
+    for (size_t i = 0; i < missing.size() && (int)i < capacity; ++i) {
+      out_pages[i] = (int)missing[i];
+    }
+    return (int)missing.size();
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* Byte range of page in the paged blob (either out pointer may be null) */
+int wl_xl_paged_page_info(void *handle, int page, int *offset, int *length) {
+  last_error[0] = '\0';
+  WlHandle *h = handle ? as_handle(handle) : nullptr;
+  if (!h || !h->pmodel || page < 0 ||
+      (size_t)page >= h->pmodel->pages.size()) {
+    set_error("wl_xl_paged_page_info: no such page");
+    return -1;
+  }
+  const wl_paged::Page &p = h->pmodel->pages[page];
+  if (offset) *offset = (int)p.offset;
+  if (length) *length = (int)p.length;
+  return 0;
+}
+
+/*
+ * Buffer for page's bytes, which the caller must fill before the next
+ * predict. Evicts least recently used pages over the resident limit.
+ */
+void *wl_xl_paged_page_in(void *handle, int page) {
+  last_error[0] = '\0';
+  WlHandle *h = handle ? as_handle(handle) : nullptr;
+  if (!h || !h->pmodel || page < 0 ||
+      (size_t)page >= h->pmodel->pages.size()) {
+    set_error("wl_xl_paged_page_in: no such page");
+    return nullptr;
+  }
+  bool resident = h->pmodel->pages[page].data != nullptr;
+  void *buf = wl_paged::page_in(*h->pmodel, (xLearn::index_t)page);
+  if (!buf) {
+    set_error("wl_xl_paged_page_in: allocation failed");
+  } else if (!resident) {
+    /* The caller reads the page into buf */
+    wl_stats_alloc(h->stats.get());
+    wl_stats_bytes(h->stats.get(), h->pmodel->pages[page].length);
+  }
+  return buf;
+}
+
+/* Release a resident page (e.g. after its read failed) */
+void wl_xl_paged_drop(void *handle, int page) {
+  WlHandle *h = handle ? as_handle(handle) : nullptr;
+  if (!h || !h->pmodel || page < 0 ||
+      (size_t)page >= h->pmodel->pages.size()) return;
+  wl_paged::drop(*h->pmodel, (xLearn::index_t)page);
+}
+
+/* Paging counters (any out pointer may be null) */
+int wl_xl_paged_stats(void *handle, int *resident, int *num_pages,
+                      int *page_ins) {
+  last_error[0] = '\0';
+  if (!handle || !as_handle(handle)->pmodel) {
+    set_error("wl_xl_paged_stats: no paged model loaded");
+    return -1;
+  }
+  const wl_paged::PagedModel &pm = *as_handle(handle)->pmodel;
+  if (resident) *resident = (int)pm.resident;
+  if (num_pages) *num_pages = (int)pm.pages.size();
+  if (page_ins) *page_ins = (int)pm.page_ins;
+  return 0;
+}
+
+/* ---------- DMatrix binary cache ---------- */
+
+/*
+ * A built DMatrix written out as it sits in memory, so reloading a
+ * training set is a few bulk copies rather than a rebuild: parsing,
+ * float conversion, field lookup and norms are all done already.
+ *
+ *   char[4]            "WLDM"
+ *   uint32_t x 3       nrow, flags (1: labels, 2: sample weights), nnz
+ *   real_t[nrow]       Y (only with labels)
+ *   real_t[nrow]       sample weights (only with weights)
+ *   real_t[nrow]       norm
+ *   uint32_t[nrow+1]   row offsets into nodes
+ *   Node[nnz]          (field_id, feat_id, feat_val) per entry
+ *
+ * Every field is 4 bytes wide, so a blob copied to a 4-byte aligned
+ * address has its nodes aligned and each row is assigned straight from
+ * the blob.
+ */
+static const char kDMatrixMagic[4] = { 'W', 'L', 'D', 'M' };
+static const uint32_t kDMatrixLabels = 1;
+static const uint32_t kDMatrixWeights = 2;
+
+static_assert(sizeof(xLearn::Node) == 3 * sizeof(uint32_t),
+              "DMatrix cache stores nodes as three 4-byte fields");
+
+/* Serialize a DMatrix into a malloc'd buffer (free with wl_xl_free_buffer). */
+int wl_xl_save_dmatrix(void *dmatrix, char **out_buf, int *out_len) {
+  last_error[0] = '\0';
+  if (!dmatrix || !out_buf || !out_len) {
+    set_error("wl_xl_save_dmatrix: null argument");
+    return -1;
+  }
+  const xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dmatrix);
+  try {
+    uint32_t nrow = (uint32_t)dm->row_length;
+    bool has_label = dm->has_label;
+    bool has_weight = !row_weights(dm).empty();
+    uint32_t flags = (has_label ? kDMatrixLabels : 0) | (has_weight ? kDMatrixWeights : 0);
+    size_t nnz = 0;
+    for (uint32_t i = 0; i < nrow; ++i) nnz += dm->row[i]->size();
+
+    size_t size = sizeof(kDMatrixMagic) + 3 * sizeof(uint32_t)
+                  + sizeof(xLearn::real_t) * (size_t)nrow
+                    * (1 + (has_label ? 1 : 0) + (has_weight ? 1 : 0))
+                  + sizeof(uint32_t) * ((size_t)nrow + 1)
+                  + sizeof(xLearn::Node) * nnz;
+    if (nnz > UINT32_MAX || size > (size_t)INT_MAX) {
+      set_error("wl_xl_save_dmatrix: DMatrix too large for one blob");
+      return -1;
+    }
+    char *buf = (char *)malloc(size);
+    if (!buf) {
+      set_error("wl_xl_save_dmatrix: allocation failed");
+      return -1;
+    }
+
+    BlobWriter w = { buf };
+    uint32_t n32 = (uint32_t)nnz;
+    w.write(kDMatrixMagic, sizeof(kDMatrixMagic));
+    w.write(&nrow, sizeof(nrow));
+    w.write(&flags, sizeof(flags));
+    w.write(&n32, sizeof(n32));
+    if (has_label) w.write(dm->Y.data(), sizeof(xLearn::real_t) * nrow);
+    if (has_weight) w.write(row_weights(dm).data(), sizeof(xLearn::real_t) * nrow);
+    w.write(dm->norm.data(), sizeof(xLearn::real_t) * nrow);
+    uint32_t off = 0;
+    w.write(&off, sizeof(off));
+    for (uint32_t i = 0; i < nrow; ++i) {
+      off += (uint32_t)dm->row[i]->size();
+      w.write(&off, sizeof(off));
+    }
+    for (uint32_t i = 0; i < nrow; ++i) {
+      const xLearn::SparseRow *row = dm->row[i];
+      if (!row->empty()) w.write(row->data(), sizeof(xLearn::Node) * row->size());
+    }
+    *out_buf = buf;
+    *out_len = (int)size;
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* Rebuild a DMatrix from a wl_xl_save_dmatrix blob. */
+int wl_xl_load_dmatrix(const char *buf, int len, void **out) {
+  last_error[0] = '\0';
+  if (!buf || len <= 0 || !out) {
+    set_error("wl_xl_load_dmatrix: invalid arguments");
+    return -1;
+  }
+  BlobReader r = { buf, buf + len };
+  char magic[4];
+  uint32_t nrow = 0, flags = 0, nnz = 0;
+  if (!r.read(magic, sizeof(magic)) ||
+      memcmp(magic, kDMatrixMagic, sizeof(magic)) != 0) {
+    set_error("wl_xl_load_dmatrix: not a cached DMatrix");
+    return -1;
+  }
+  if (!r.read(&nrow, sizeof(nrow)) || !r.read(&flags, sizeof(flags)) ||
+      !r.read(&nnz, sizeof(nnz)) || nrow == 0) {
+    set_error("wl_xl_load_dmatrix: truncated header");
+    return -1;
+  }
+  bool has_label = (flags & kDMatrixLabels) != 0;
+  bool has_weight = (flags & kDMatrixWeights) != 0;
+  if ((flags & ~(kDMatrixLabels | kDMatrixWeights)) || (has_weight && !has_label)) {
+    set_error("wl_xl_load_dmatrix: unknown flags");
+    return -1;
+  }
+  size_t body = sizeof(xLearn::real_t) * (size_t)nrow
+                * (1 + (has_label ? 1 : 0) + (has_weight ? 1 : 0))
+                + sizeof(uint32_t) * ((size_t)nrow + 1)
+                + sizeof(xLearn::Node) * (size_t)nnz;
+  if ((size_t)(r.end - r.pos) != body) {
+    set_error("wl_xl_load_dmatrix: size does not match header");
+    return -1;
+  }
+
+  xLearn::DMatrix *matrix = nullptr;
+  try {
+    matrix = alloc_dmatrix((int)nrow, has_label);
+    if (has_label) r.read(matrix->Y.data(), sizeof(xLearn::real_t) * nrow);
+    if (has_weight) {
+      std::vector<xLearn::real_t> &weight = static_cast<WlDMatrix*>(matrix)->weight;
+      weight.resize(nrow);
+      r.read(weight.data(), sizeof(xLearn::real_t) * nrow);
+    }
+    r.read(matrix->norm.data(), sizeof(xLearn::real_t) * nrow);
+    std::vector<uint32_t> offsets((size_t)nrow + 1);
+    r.read(offsets.data(), sizeof(uint32_t) * offsets.size());
+    if (offsets[0] != 0 || offsets[nrow] != nnz) {
+      destroy_dmatrix(matrix);
+      set_error("wl_xl_load_dmatrix: row offsets out of range");
+      return -1;
+    }
+
+    const char *nodes = r.pos;
+    bool aligned = ((uintptr_t)nodes % alignof(xLearn::Node)) == 0;
+    for (uint32_t i = 0; i < nrow; ++i) {
+      uint32_t start = offsets[i], end = offsets[i + 1];
+      if (end < start || end > nnz) {
+        destroy_dmatrix(matrix);
+        set_error("wl_xl_load_dmatrix: row offsets out of range");
+        return -1;
+      }
+      xLearn::SparseRow *row = new xLearn::SparseRow();
+      matrix->row[i] = row;
+      if (aligned) {
+        const xLearn::Node *first = reinterpret_cast<const xLearn::Node*>(nodes) + start;
+        row->assign(first, first + (end - start));
+      } else {
+        row->reserve(end - start);
+        for (uint32_t j = start; j < end; ++j) {
+          uint32_t f[3];
+          memcpy(f, nodes + sizeof(xLearn::Node) * j, sizeof(f));
+          xLearn::real_t val;
+          memcpy(&val, &f[2], sizeof(val));
+          row->push_back(xLearn::Node(f[0], f[1], val));
+        }
+      }
+    }
+    *out = matrix;
+    return 0;
+  } catch (const std::exception &e) {
+    if (matrix) destroy_dmatrix(matrix);
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* ---------- train ---------- */
+
+#ifndef WL_XL_INFERENCE_ONLY
+/*
+ * Same steps as upstream XLearnFit, except the solver hands its model
+ * over (Solver::ReleaseModel, patched in by build-wasm.sh) instead of
+ * serializing it to model_file. Input comes from the handle's DMatrix
+ * or, with from_file, from train_set_file.
+ */
+static int train_model(WlHandle *h) {
+  XLearn *x = reinterpret_cast<XLearn*>(h->xl);
+  xLearn::HyperParam &hp = x->GetHyperParam();
+  hp.model_file = "none";
+  hp.is_train = true;
+
+  xLearn::Model *model = nullptr;
+  try {
+    WlPhaseTimer timer(h->stats.get(), kPhaseFit);
+    x->GetSolver().Initialize(hp);
+    x->GetSolver().StartWork();
+    model = x->GetSolver().ReleaseModel();
+    x->GetSolver().Clear();
+  } catch (const std::exception &e) {
+    delete model;
+    set_error(e.what());
+    return -1;
+  }
+
+  if (!model) {
+    set_error("solver produced no model");
+    return -1;
+  }
+
+  try {
+    return install_model(h, model);
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+static bool adapter_training(const WlHandle *h, const xLearn::DMatrix *dm);
+static int train_epochs(WlHandle *h, void *dtrain, void *dvalid);
+#endif
+
+/*
+ * Train on dtrain (and optionally dvalid) and keep the trained model on
+ * the handle as its prepared model. Model bytes are only produced on
+ * demand by wl_xl_save_model, so nothing is written to MEMFS. With
+ * sample weights or negative sampling, which upstream's trainer does
+ * not know, the epochs run in the adapter's loop (as wl_xl_fit_epoch):
+ * rows in order, on one thread.
+ */
+int wl_xl_fit_model(void *handle, void *dtrain, void *dvalid) {
+  last_error[0] = '\0';
+#ifdef WL_XL_INFERENCE_ONLY
+  return no_training("wl_xl_fit_model");
+#else
+  if (!handle || !dtrain) {
+    set_error("wl_xl_fit_model: null argument");
+    return -1;
+  }
+
+  WlHandle *h = as_handle(handle);
+  if (adapter_training(h, reinterpret_cast<xLearn::DMatrix*>(dtrain))) {
+    return train_epochs(h, dtrain, dvalid);
+  }
+
+  XL xl = h->xl;
+
+  /* Assign DMatrix to handle */
+  DataHandle train_dh = dtrain;
+  int ret = XLearnSetDMatrix(&xl, "train", &train_dh);
+  if (ret != 0) {
+    const char *err = XLearnGetLastError();
+    set_error(err ? err : "XLearnSetDMatrix(train) failed");
+    return -1;
+  }
+
+  if (dvalid) {
+    DataHandle valid_dh = dvalid;
+    ret = XLearnSetDMatrix(&xl, "validate", &valid_dh);
+    if (ret != 0) {
+      const char *err = XLearnGetLastError();
+      set_error(err ? err : "XLearnSetDMatrix(validate) failed");
+      return -1;
+    }
+  }
+
+  return train_model(h);
+#endif
+}
+
+/*
+ * Out-of-core training: the solver's own Reader streams train_path (and
+ * valid_path) from the filesystem instead of a resident DMatrix. The
+ * path may be on a mounted NODEFS/WORKERFS. With on_disk, the file is
+ * read in block_size MB blocks per epoch so the whole dataset is never
+ * in the heap; otherwise upstream's in-memory reader loads it once.
+ */
+int wl_xl_fit_file(void *handle, const char *train_path,
+                   const char *valid_path, int on_disk, int block_size) {
+  last_error[0] = '\0';
+#ifdef WL_XL_INFERENCE_ONLY
+  return no_training("wl_xl_fit_file");
+#else
+  if (!handle || !train_path) {
+    set_error("wl_xl_fit_file: null argument");
+    return -1;
+  }
+
+  WlHandle *h = as_handle(handle);
+  if (h->neg_rate < 1.0f) {
+    set_error("wl_xl_fit_file: negative sampling needs an in-memory DMatrix");
+    return -1;
+  }
+  XL xl = h->xl;
+  if (XLearnSetTrain(&xl, train_path) != 0 ||
+      (valid_path && XLearnSetValidate(&xl, valid_path) != 0)) {
+    const char *err = XLearnGetLastError();
+    set_error(err ? err : "XLearnSetTrain failed");
+    return -1;
+  }
+
+  xLearn::HyperParam &hp = reinterpret_cast<XLearn*>(xl)->GetHyperParam();
+  hp.from_file = true;
+  hp.on_disk = on_disk != 0;
+  if (block_size > 0) hp.block_size = block_size;
+
+  int ret = train_model(h);
+
+  /* Back to DMatrix input for any later fit on this handle */
+  hp.from_file = false;
+  hp.on_disk = false;
+  hp.train_set_file.clear();
+  hp.validate_set_file.clear();
+  return ret;
+#endif
+}
+
+/* Dimensions of the prepared model (any out pointer may be null). */
+int wl_xl_model_shape(void *handle, int *num_feature, int *num_field,
+                      int *num_k) {
+  last_error[0] = '\0';
+  if (!handle || !has_model(as_handle(handle))) {
+    set_error("wl_xl_model_shape: no model loaded");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (h->qmodel) {
+    if (num_feature) *num_feature = (int)h->qmodel->num_feat;
+    if (num_field) *num_field = (int)h->qmodel->num_field;
+    if (num_k) *num_k = (int)h->quant_num_k;
+    return 0;
+  }
+  if (h->pmodel) {
+    if (num_feature) *num_feature = (int)h->pmodel->num_feat;
+    if (num_field) *num_field = (int)h->pmodel->num_field;
+    if (num_k) *num_k = (int)h->pmodel->num_K;
+    return 0;
+  }
+  if (h->bmodel) {
+    if (num_feature) *num_feature = (int)h->bmodel->num_feat;
+    if (num_field) *num_field = (int)h->bmodel->num_field;
+    if (num_k) *num_k = (int)h->bmodel->num_K;
+    return 0;
+  }
+  xLearn::Model *model = h->model.get();
+  if (num_feature) *num_feature = (int)model->GetNumFeature();
+  if (num_field) *num_field = (int)model->GetNumField();
+  if (num_k) *num_k = (int)model->GetNumK();
+  return 0;
+}
+
+/* Train and return the serialized model in a malloc'd buffer. */
+int wl_xl_fit(
+    void *handle,
+    void *dtrain,
+    void *dvalid,
+    char **out_model_buf,
+    int *out_model_len
+) {
+  last_error[0] = '\0';
+  if (!handle || !dtrain || !out_model_buf || !out_model_len) {
+    set_error("wl_xl_fit: null argument");
+    return -1;
+  }
+
+  if (wl_xl_fit_model(handle, dtrain, dvalid) != 0) return -1;
+
+  /* same blob as wl_xl_save_model: the blocked one under layout 1 */
+  int size = wl_xl_model_size(handle);
+  if (size < 0) return -1;
+  char *buf = (char *)malloc(size);
+  if (!buf) {
+    set_error("wl_xl_fit: allocation failed");
+    return -1;
+  }
+  if (wl_xl_save_model(handle, buf, size) != 0) {
+    free(buf);
+    return -1;
+  }
+
+  *out_model_buf = buf;
+  *out_model_len = size;
+  return 0;
+}
+
+/* ---------- incremental training ---------- */
+
+#ifndef WL_XL_INFERENCE_ONLY
+/* Optimizer state floats per weight, as laid out by Model::Initialize */
+static xLearn::index_t opt_aux_size(const std::string &opt_type) {
+  if (opt_type.compare("sgd") == 0) return 1;
+  if (opt_type.compare("adagrad") == 0) return 2;
+  if (opt_type.compare("ftrl") == 0) return 3;
+  return 0;
+}
+
+/* d loss / d score, matching upstream CrossEntropyLoss / SquaredLoss */
+static inline xLearn::real_t loss_grad(bool cross_entropy,
+                                       xLearn::real_t pred,
+                                       xLearn::real_t y) {
+  if (cross_entropy) {
+    xLearn::real_t sy = y > 0 ? 1.0f : -1.0f;
+    return -sy / (1.0f + std::exp(sy * pred));
+  }
+  return pred - y;
+}
+#endif
+
+/* Per-row loss: log loss for cross-entropy, squared error otherwise */
+static inline double loss_value(bool cross_entropy, xLearn::real_t pred,
+                                xLearn::real_t y) {
+  if (cross_entropy) return wl_eval::logistic_loss(pred, y);
+  double d = pred - y;
+  return d * d;
+}
+
+static inline bool is_cross_entropy(const WlHandle *h) {
+  const std::string &loss = h->bmodel ? h->bmodel->loss_func
+                                      : h->model->GetLossFunction();
+  return loss.compare("cross-entropy") == 0;
+}
+
+#ifndef WL_XL_INFERENCE_ONLY
+/* Whether training on dm needs the adapter's loop (upstream's trainer
+   has no sample weights and no negative sampling) */
+static bool adapter_training(const WlHandle *h, const xLearn::DMatrix *dm) {
+  return !row_weights(dm).empty() || h->neg_rate < 1.0f;
+}
+
+/* Uniform in [0, 1) from (key, i): murmur3's finalizer */
+static inline float unit_hash(uint32_t key, size_t i) {
+  uint32_t x = key ^ ((uint32_t)i * 0x9e3779b1u);
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+/*
+ * Weight of row i in one epoch: its sample weight, or 0 for a negative
+ * left out by negative sampling. Which negatives are kept depends only
+ * on the seed, the epoch and the row, so a fit is reproducible.
+ */
+struct EpochRows {
+  const xLearn::real_t *weight = nullptr;
+  const xLearn::real_t *Y = nullptr;
+  float rate = 1.0f;
+  uint32_t key = 0;
+
+  xLearn::real_t operator()(size_t i) const {
+    if (rate < 1.0f && !(Y[i] > 0) && unit_hash(key, i) >= rate) return 0;
+    return weight ? weight[i] : 1.0f;
+  }
+};
+
+/* Model bias (b[0]) that negative sampling corrects */
+static xLearn::real_t *bias_param(WlHandle *h) {
+  return h->bmodel ? h->bmodel->b.data() : h->model->GetParameter_b();
+}
+
+/*
+ * One pass of upstream's lock-based per-row step over dm, each row's
+ * gradient scaled by its weight (EpochRows). Returns the weighted mean
+ * loss of the predictions made before each update, which is what
+ * upstream reports as the epoch's train loss. With negative sampling
+ * the bias is trained in the sampled data's scale, and moved back by
+ * log(rate) afterwards: kept negatives stand for 1 / rate as many, so
+ * the sampled odds are the full data's divided by rate.
+ */
+static double run_epoch(WlHandle *h, xLearn::DMatrix *dm,
+                        xLearn::HyperParam &hp) {
+  bool cross_entropy = is_cross_entropy(h);
+  EpochRows rows;
+  const std::vector<xLearn::real_t> &weight = row_weights(dm);
+  if (!weight.empty()) rows.weight = weight.data();
+  rows.Y = dm->Y.data();
+  if (cross_entropy) rows.rate = h->neg_rate;
+  rows.key = h->neg_seed * 0x27d4eb2fu + h->sample_epoch++;
+  xLearn::real_t shift = rows.rate < 1.0f ? std::log(rows.rate) : 0.0f;
+  xLearn::real_t *b = bias_param(h);
+  b[0] -= shift;
+
+  size_t n = dm->row_length;
+  double loss = 0, total = 0;
+  if (h->bmodel) {
+    wl_ffm::UpdateFn update = wl_ffm::select_update(hp.opt_type);
+    if (!update) throw std::runtime_error("unknown optimizer: " + hp.opt_type);
+    wl_simd::OptParams p = { hp.learning_rate, hp.regu_lambda, hp.alpha,
+                             hp.beta, hp.lambda_1, hp.lambda_2 };
+    for (size_t i = 0; i < n; ++i) {
+      xLearn::real_t w = rows(i);
+      if (w == 0) continue;
+      xLearn::SparseRow *row = dm->row[i];
+      xLearn::real_t norm = hp.norm ? dm->norm[i] : 1.0f;
+      xLearn::real_t pred = wl_ffm::score(row, *h->bmodel, norm);
+      loss += w * loss_value(cross_entropy, pred, dm->Y[i]);
+      total += w;
+      xLearn::real_t pg = w * loss_grad(cross_entropy, pred, dm->Y[i]);
+      update(row, *h->bmodel, pg, norm, p);
+    }
+  } else {
+    h->score->Initialize(hp.learning_rate, hp.regu_lambda,
+                         hp.alpha, hp.beta, hp.lambda_1, hp.lambda_2,
+                         hp.opt_type);
+    for (size_t i = 0; i < n; ++i) {
+      xLearn::real_t w = rows(i);
+      if (w == 0) continue;
+      xLearn::SparseRow *row = dm->row[i];
+      xLearn::real_t norm = hp.norm ? dm->norm[i] : 1.0f;
+      xLearn::real_t pred = h->score->CalcScore(row, *h->model, norm);
+      loss += w * loss_value(cross_entropy, pred, dm->Y[i]);
+      total += w;
+      xLearn::real_t pg = w * loss_grad(cross_entropy, pred, dm->Y[i]);
+      h->score->CalcGrad(row, *h->model, pg, norm);
+    }
+  }
+  b[0] += shift;
+  return total > 0 ? loss / total : 0;
+}
+#endif
+
+/*
+ * Continue training the handle's resident model on dtrain for `epochs`
+ * passes. Weights and optimizer state (adagrad sums, ftrl n/z) carry
+ * over from the previous fit; learning-rate and regularization params
+ * are read from the handle. Features or fields beyond the model's
+ * original width are ignored, as at prediction time.
+ */
+int wl_xl_partial_fit(void *handle, void *dtrain, int epochs) {
+  last_error[0] = '\0';
+#ifdef WL_XL_INFERENCE_ONLY
+  return no_training("wl_xl_partial_fit");
+#else
+  if (!handle || !dtrain || epochs <= 0) {
+    set_error("wl_xl_partial_fit: invalid arguments");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (!h->model && !h->bmodel) {
+    set_error(h->qmodel ? "wl_xl_partial_fit: quantized models are inference-only"
+              : h->pmodel ? "wl_xl_partial_fit: paged models are inference-only"
+              : "wl_xl_partial_fit: no model loaded");
+    return -1;
+  }
+
+  xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dtrain);
+  if (!dm->has_label) {
+    set_error("wl_xl_partial_fit: training data has no labels");
+    return -1;
+  }
+
+  xLearn::HyperParam &hp = reinterpret_cast<XLearn*>(h->xl)->GetHyperParam();
+  xLearn::index_t aux = h->bmodel ? h->bmodel->aux_size
+                                  : h->model->GetAuxiliarySize();
+  if (opt_aux_size(hp.opt_type) != aux) {
+    set_error("wl_xl_partial_fit: opt does not match the model's optimizer state");
+    return -1;
+  }
+
+  try {
+    WlPhaseTimer timer(h->stats.get(), kPhaseFit);
+    for (int e = 0; e < epochs; ++e) run_epoch(h, dm, hp);
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+#endif
+}
+
+/* ---------- epoch-wise training ---------- */
+
+static void score_rows(WlHandle *h, xLearn::DMatrix *dm, float *out);
+
+/*
+ * Start training on dtrain one epoch at a time: the solver builds and
+ * initializes the model exactly as for wl_xl_fit_model, but trains no
+ * epoch. Each wl_xl_fit_epoch call then makes one pass.
+ */
+int wl_xl_fit_begin(void *handle, void *dtrain) {
+  last_error[0] = '\0';
+#ifdef WL_XL_INFERENCE_ONLY
+  return no_training("wl_xl_fit_begin");
+#else
+  if (!handle || !dtrain) {
+    set_error("wl_xl_fit_begin: null argument");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  XL xl = h->xl;
+  DataHandle train_dh = dtrain;
+  if (XLearnSetDMatrix(&xl, "train", &train_dh) != 0) {
+    const char *err = XLearnGetLastError();
+    set_error(err ? err : "XLearnSetDMatrix(train) failed");
+    return -1;
+  }
+
+  XLearn *x = reinterpret_cast<XLearn*>(xl);
+  xLearn::HyperParam &hp = x->GetHyperParam();
+  hp.model_file = "none";
+  hp.is_train = true;
+
+  xLearn::Model *model = nullptr;
+  try {
+    WlPhaseTimer timer(h->stats.get(), kPhaseFit);
+    x->GetSolver().Initialize(hp);
+    model = x->GetSolver().ReleaseModel();
+    x->GetSolver().Clear();
+  } catch (const std::exception &e) {
+    delete model;
+    set_error(e.what());
+    return -1;
+  }
+
+  if (!model) {
+    set_error("solver produced no model");
+    return -1;
+  }
+  h->sample_epoch = 0;
+  try {
+    return install_model(h, model);
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+#endif
+}
+
+/*
+ * One training epoch over dtrain, then an evaluation pass over dvalid
+ * (optional). out_metrics receives the train loss, validation loss and
+ * validation metric (accuracy for binary, RMSE for regression); the
+ * validation entries are NaN without dvalid.
+ */
+int wl_xl_fit_epoch(void *handle, void *dtrain, void *dvalid,
+                    float *out_metrics) {
+  last_error[0] = '\0';
+#ifdef WL_XL_INFERENCE_ONLY
+  return no_training("wl_xl_fit_epoch");
+#else
+  if (!handle || !dtrain || !out_metrics) {
+    set_error("wl_xl_fit_epoch: null argument");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (!h->model && !h->bmodel) {
+    set_error("wl_xl_fit_epoch: call wl_xl_fit_begin first");
+    return -1;
+  }
+  xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dtrain);
+  xLearn::DMatrix *dv = reinterpret_cast<xLearn::DMatrix*>(dvalid);
+  if (!dm->has_label || (dv && !dv->has_label)) {
+    set_error("wl_xl_fit_epoch: training and validation data need labels");
+    return -1;
+  }
+
+  try {
+    xLearn::HyperParam &hp = reinterpret_cast<XLearn*>(h->xl)->GetHyperParam();
+    {
+      WlPhaseTimer timer(h->stats.get(), kPhaseFit);
+      out_metrics[0] = (float)run_epoch(h, dm, hp);
+    }
+    out_metrics[1] = out_metrics[2] = NAN;
+    if (!dv || dv->row_length == 0) return 0;
+
+    bool cross_entropy = is_cross_entropy(h);
+    size_t n = dv->row_length;
+    std::vector<float> pred(n);
+    score_rows(h, dv, pred.data());
+    double loss = 0, metric = 0;
+    for (size_t i = 0; i < n; ++i) {
+      xLearn::real_t y = dv->Y[i];
+      double l = loss_value(cross_entropy, pred[i], y);
+      loss += l;
+      if (cross_entropy) {
+        metric += (pred[i] > 0) == (y > 0) ? 1 : 0;
+      } else {
+        metric += l;
+      }
+    }
+    out_metrics[1] = (float)(loss / n);
+    out_metrics[2] = (float)(cross_entropy ? metric / n : std::sqrt(metric / n));
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+#endif
+}
+
+/*
+ * Arrays holding the resident model's weights and optimizer state (w,
+ * v, b; blocked FFM: w, v, state planes, b). Returns how many were
+ * filled, 0 without a trainable model.
+ */
+static int weight_spans(WlHandle *h, xLearn::real_t *ptr[4], size_t len[4]) {
+  if (h->bmodel) {
+    wl_ffm::BlockedFFM &m = *h->bmodel;
+    ptr[0] = m.w.data();     len[0] = m.w.size();
+    ptr[1] = m.v.data;       len[1] = m.v.size;
+    ptr[2] = m.state.data;   len[2] = m.state.size;
+    ptr[3] = m.b.data();     len[3] = m.b.size();
+    return 4;
+  }
+  if (!h->model) return 0;
+  xLearn::Model *m = h->model.get();
+  ptr[0] = m->GetParameter_w();  len[0] = m->GetNumParameter_w();
+  ptr[1] = m->GetParameter_v();  len[1] = m->GetNumParameter_v();
+  ptr[2] = m->GetParameter_b();  len[2] = m->GetAuxiliarySize();
+  return 3;
+}
+
+/* Keep a copy of the resident weights (and optimizer state) */
+int wl_xl_snapshot_model(void *handle) {
+  last_error[0] = '\0';
+  xLearn::real_t *ptr[4];
+  size_t len[4];
+  int n = handle ? weight_spans(as_handle(handle), ptr, len) : 0;
+  if (!n) {
+    set_error("wl_xl_snapshot_model: no model loaded");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  try {
+    size_t total = 0;
+    for (int s = 0; s < n; ++s) total += len[s];
+    h->snapshot.resize(total);
+    xLearn::real_t *dst = h->snapshot.data();
+    for (int s = 0; s < n; ++s) {
+      if (len[s]) memcpy(dst, ptr[s], sizeof(xLearn::real_t) * len[s]);
+      dst += len[s];
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    set_error(e.what());
+    return -1;
+  }
+}
+
+/* Put the last snapshot back into the resident model */
+int wl_xl_restore_snapshot(void *handle) {
+  last_error[0] = '\0';
+  WlHandle *h = handle ? as_handle(handle) : nullptr;
+  xLearn::real_t *ptr[4];
+  size_t len[4];
+  int n = h ? weight_spans(h, ptr, len) : 0;
+  if (!n || h->snapshot.empty()) {
+    set_error("wl_xl_restore_snapshot: no snapshot");
+    return -1;
+  }
+  size_t total = 0;
+  for (int s = 0; s < n; ++s) total += len[s];
+  if (h->snapshot.size() != total) {
+    set_error("wl_xl_restore_snapshot: snapshot does not match model");
+    return -1;
+  }
+  const xLearn::real_t *src = h->snapshot.data();
+  for (int s = 0; s < n; ++s) {
+    if (len[s]) memcpy(ptr[s], src, sizeof(xLearn::real_t) * len[s]);
+    src += len[s];
+  }
+  return 0;
+}
+
+#ifndef WL_XL_INFERENCE_ONLY
+/*
+ * wl_xl_fit_begin, then the handle's epoch count of wl_xl_fit_epoch
+ * passes. With dvalid and early_stop, training stops once validation
+ * loss has not improved for stop_window epochs and keeps the best
+ * epoch's weights, as upstream's trainer does.
+ */
+static int train_epochs(WlHandle *h, void *dtrain, void *dvalid) {
+  if (wl_xl_fit_begin(h, dtrain) != 0) return -1;
+  xLearn::HyperParam &hp = reinterpret_cast<XLearn*>(h->xl)->GetHyperParam();
+  bool early_stop = dvalid && hp.early_stop;
+  float metrics[3];
+  float best = INFINITY;
+  int best_epoch = 0, epoch = 0;
+  while (epoch < hp.num_epoch) {
+    ++epoch;
+    if (wl_xl_fit_epoch(h, dtrain, dvalid, metrics) != 0) return -1;
+    if (!early_stop) continue;
+    if (metrics[1] < best) {
+      best = metrics[1];
+      best_epoch = epoch;
+      if (wl_xl_snapshot_model(h) != 0) return -1;
+    }
+    if (epoch - best_epoch >= hp.stop_window) break;
+  }
+  int ret = best_epoch && best_epoch != epoch ? wl_xl_restore_snapshot(h) : 0;
+  std::vector<xLearn::real_t>().swap(h->snapshot);
+  return ret;
+}
+#endif
+
+/* ---------- predict ---------- */
+
+static std::atomic<int> pred_counter{0};
+
+int wl_xl_predict(
+    void *handle,
+    const char *model_buf, int model_len,
+    void *dtest,
+    float **out_preds, int *out_len
+) {
+  last_error[0] = '\0';
+#ifdef WL_XL_INFERENCE_ONLY
+  return no_training("wl_xl_predict");
+#else
+  if (!handle || !model_buf || model_len <= 0 || !dtest || !out_preds || !out_len) {
+    set_error("wl_xl_predict: null argument");
+    return -1;
+  }
+
+  XL xl = as_handle(handle)->xl;
+
   /* Write model bytes to MEMFS */
   char model_path[64];
-  snprintf(model_path, sizeof(model_path), "/tmp/wl_xl_pred_%d", fit_counter++);
+  snprintf(model_path, sizeof(model_path), "/tmp/wl_xl_pred_%d", pred_counter++);
 
   FILE *f = fopen(model_path, "wb");
   if (!f) {
@@ -334,7 +2583,7 @@ int wl_xl_predict(
 
   /* Assign test DMatrix */
   DataHandle test_dh = dtest;
-  int ret = XLearnSetDMatrix(&handle, "test", &test_dh);
+  int ret = XLearnSetDMatrix(&xl, "test", &test_dh);
   if (ret != 0) {
     remove(model_path);
     const char *err = XLearnGetLastError();
@@ -345,9 +2594,11 @@ int wl_xl_predict(
   /* Predict */
   uint64_t length = 0;
   const float *arr = nullptr;
-  suppress_stdout();
-  ret = XLearnPredictForMat(&handle, model_path, &length, &arr);
-  restore_stdout();
+  {
+    /* Model parse and scoring both happen inside upstream's predict */
+    WlPhaseTimer timer(as_handle(handle)->stats.get(), kPhaseScore);
+    ret = XLearnPredictForMat(&xl, model_path, &length, &arr);
+  }
   remove(model_path);
 
   if (ret != 0) {
@@ -368,6 +2619,328 @@ int wl_xl_predict(
   *out_preds = result;
   *out_len = n;
   return 0;
+#endif
+}
+
+static wl_fast::FastModel fast_model(xLearn::Model *model) {
+  wl_fast::FastModel m;
+  m.w = model->GetParameter_w();
+  m.v = model->GetParameter_v();
+  m.b = model->GetParameter_b();
+  m.num_feat = model->GetNumFeature();
+  m.num_field = model->GetNumField();
+  return m;
+}
+
+/*
+ * Paged models can only score dm once every page it touches is
+ * resident (see wl_xl_paged_missing).
+ */
+static bool pages_ready(WlHandle *h, xLearn::DMatrix *dm, const char *fn) {
+  if (!h->pmodel) return true;
+  std::vector<xLearn::index_t> missing;
+  wl_paged::begin_batch(*h->pmodel, *dm, missing);
+  if (missing.empty()) return true;
+  set_error((std::string(fn) + ": weight pages not resident").c_str());
+  return false;
+}
+
+/*
+ * Intra-row parallel scoring of one call's wide FFM rows. The thread
+ * pool belongs to the call (every model of a wl_xl_predict_many call
+ * shares one), is only started when a wide row shows up and is joined
+ * when the call returns. A pool kept any longer would hold pthread
+ * workers that a later fit or another pool needs (see max_threads).
+ */
+struct WlWide {
+  wl_par::FFMView view;
+  size_t min_nnz = 0;  /* 0: off for this handle */
+  size_t threads = 1;
+  std::unique_ptr<ThreadPool> *pool = nullptr;  /* the call's pool */
+  wl_par::Work work;
+
+  bool wants(const xLearn::SparseRow *row) const {
+    return WL_XL_HAS_FFM && min_nnz && row->size() >= min_nnz;
+  }
+
+  xLearn::real_t score(const xLearn::SparseRow *row, xLearn::real_t norm) {
+    /* the calling thread takes a share, so threads - 1 pool threads */
+    if (threads > 1 && (!*pool || (*pool)->ThreadNumber() != threads - 1)) {
+      pool->reset();  /* join the old threads before starting new ones */
+      pool->reset(new ThreadPool(threads - 1));
+    }
+    return wl_par::score(row, view, norm, threads > 1 ? pool->get() : nullptr, work);
+  }
+};
+
+/* Set up wide for h's model (left off unless it is a full FFM model),
+   starting threads in the call's pool */
+static void init_wide(WlHandle *h, WlWide &wide,
+                      std::unique_ptr<ThreadPool> &pool) {
+  if (h->parallel_nnz <= 0) return;
+  wl_par::FFMView &v = wide.view;
+  if (h->bmodel) {
+    const wl_ffm::BlockedFFM &m = *h->bmodel;
+    v.w = m.w.data();
+    v.v = m.v.data;
+    v.b = m.b.data();
+    v.num_feat = m.num_feat;
+    v.num_field = m.num_field;
+    v.aligned_k = m.aligned_k;
+    v.w_stride = m.aux_size;
+    v.field_stride = m.aligned_k;
+    v.feat_stride = (size_t)m.num_field * m.aligned_k;
+    v.chunk_stride = xLearn::kAlign;
+  } else if (h->model && h->model->GetScoreFunction() == "ffm") {
+    xLearn::Model *m = h->model.get();
+    size_t aux = m->GetAuxiliarySize();
+    v.w = m->GetParameter_w();
+    v.v = m->GetParameter_v();
+    v.b = m->GetParameter_b();
+    v.num_feat = m->GetNumFeature();
+    v.num_field = m->GetNumField();
+    v.aligned_k = m->get_aligned_k();
+    v.w_stride = aux;
+    v.field_stride = (size_t)v.aligned_k * aux;
+    v.feat_stride = (size_t)v.num_field * v.field_stride;
+    v.chunk_stride = xLearn::kAlign * aux;
+  } else {
+    return;
+  }
+  int nthread = reinterpret_cast<XLearn*>(h->xl)->GetHyperParam().thread_number;
+  wide.min_nnz = (size_t)h->parallel_nnz;
+  wide.pool = &pool;
+  wide.threads = (size_t)std::max(1, std::min(nthread, max_threads()));
+}
+
+/*
+ * Same per-row scoring as upstream Loss::Predict, through the
+ * specialized scorer when the model shape has one.
+ */
+static void score_rows(WlHandle *h, xLearn::DMatrix *dm, float *out) {
+  bool is_norm = reinterpret_cast<XLearn*>(h->xl)->GetHyperParam().norm;
+  size_t n = dm->row_length;
+  std::unique_ptr<ThreadPool> pool;
+  WlWide wide;
+  init_wide(h, wide, pool);
+  if (h->qmodel) {
+    for (size_t i = 0; i < n; ++i) {
+      xLearn::real_t norm = is_norm ? dm->norm[i] : 1.0f;
+      out[i] = wl_quant::score(dm->row[i], *h->qmodel, norm);
+    }
+    return;
+  }
+  if (h->pmodel) {
+    for (size_t i = 0; i < n; ++i) {
+      xLearn::real_t norm = is_norm ? dm->norm[i] : 1.0f;
+      out[i] = wl_paged::score(dm->row[i], *h->pmodel, norm);
+    }
+    return;
+  }
+  if (WL_XL_HAS_FFM && h->bmodel) {
+    for (size_t i = 0; i < n; ++i) {
+      xLearn::real_t norm = is_norm ? dm->norm[i] : 1.0f;
+      out[i] = wide.wants(dm->row[i]) ? wide.score(dm->row[i], norm)
+               : wl_ffm::score(dm->row[i], *h->bmodel, norm);
+    }
+    return;
+  }
+  if (h->fast_score) {
+    wl_fast::FastModel m = fast_model(h->model.get());
+    for (size_t i = 0; i < n; ++i) {
+      xLearn::real_t norm = is_norm ? dm->norm[i] : 1.0f;
+      out[i] = wide.wants(dm->row[i]) ? wide.score(dm->row[i], norm)
+               : h->fast_score(dm->row[i], m, norm);
+    }
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    xLearn::real_t norm = is_norm ? dm->norm[i] : 1.0f;
+    out[i] = wide.wants(dm->row[i]) ? wide.score(dm->row[i], norm)
+             : h->score->CalcScore(dm->row[i], *h->model, norm);
+  }
+}
+
+int wl_xl_predict_loaded(
+    void *handle,
+    void *dtest,
+    float **out_preds, int *out_len
+) {
+  last_error[0] = '\0';
+  if (!handle || !dtest || !out_preds || !out_len) {
+    set_error("wl_xl_predict_loaded: null argument");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (!has_model(h)) {
+    set_error("wl_xl_predict_loaded: no model loaded");
+    return -1;
+  }
+
+  xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dtest);
+  if (!pages_ready(h, dm, "wl_xl_predict_loaded")) return -1;
+  int n = (int)dm->row_length;
+  WlPhaseTimer timer(h->stats.get(), kPhaseScore);
+  float *result = (float *)malloc((size_t)(n > 0 ? n : 1) * sizeof(float));
+  if (!result) {
+    set_error("wl_xl_predict_loaded: allocation failed");
+    return -1;
+  }
+  wl_stats_alloc(h->stats.get());
+
+  score_rows(h, dm, result);
+
+  *out_preds = result;
+  *out_len = n;
+  return 0;
+}
+
+/*
+ * Score into a caller-owned buffer of capacity floats, so repeated
+ * small-batch calls allocate nothing. Returns the number of rows
+ * written, or -1 if out is too small (nothing is written).
+ */
+int wl_xl_predict_into(void *handle, void *dtest, float *out, int capacity) {
+  last_error[0] = '\0';
+  if (!handle || !dtest || !out) {
+    set_error("wl_xl_predict_into: null argument");
+    return -1;
+  }
+  WlHandle *h = as_handle(handle);
+  if (!has_model(h)) {
+    set_error("wl_xl_predict_into: no model loaded");
+    return -1;
+  }
+
+  xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dtest);
+  int n = (int)dm->row_length;
+  if (n > capacity) {
+    set_error("wl_xl_predict_into: output buffer too small");
+    return -1;
+  }
+  if (!pages_ready(h, dm, "wl_xl_predict_into")) return -1;
+
+  WlPhaseTimer timer(h->stats.get(), kPhaseScore);
+  score_rows(h, dm, out);
+  return n;
+}
+
+/*
+ * wl_xl_predict_into, then the logistic link over the scores: out gets
+ * 1 - p and p per row (2 doubles), so JS receives the probabilities
+ * without a pass over the scores. Returns the number of rows.
+ */
+int wl_xl_predict_proba(void *handle, void *dtest, float *scores,
+                        int capacity, double *out) {
+  last_error[0] = '\0';
+  if (!out) {
+    set_error("wl_xl_predict_proba: null argument");
+    return -1;
+  }
+  int n = wl_xl_predict_into(handle, dtest, scores, capacity);
+  if (n < 0) return -1;
+  wl_eval::proba(scores, (size_t)n, out);
+  return n;
+}
+
+/*
+ * Score dtest into scores (as wl_xl_predict_into) and evaluate them
+ * against labels (nrow floats; null: dtest's own labels). metric is a
+ * wl_eval::Metric: 0 accuracy, 1 log loss, 2 AUC, 3 RMSE, 4 R2; the
+ * value is written to out_value. Returns the number of rows.
+ */
+int wl_xl_evaluate(void *handle, void *dtest, const float *labels,
+                   int metric, float *scores, int capacity,
+                   double *out_value) {
+  last_error[0] = '\0';
+  if (!dtest || !out_value) {
+    set_error("wl_xl_evaluate: null argument");
+    return -1;
+  }
+  if (metric < wl_eval::kAccuracy || metric > wl_eval::kR2) {
+    set_error("wl_xl_evaluate: unknown metric");
+    return -1;
+  }
+  xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dtest);
+  if (!labels) {
+    if (!dm->has_label) {
+      set_error("wl_xl_evaluate: data has no labels");
+      return -1;
+    }
+    labels = dm->Y.data();
+  }
+  int n = wl_xl_predict_into(handle, dtest, scores, capacity);
+  if (n < 0) return -1;
+  *out_value = wl_eval::evaluate(metric, scores, labels, (size_t)n);
+  return n;
+}
+
+/*
+ * Score one DMatrix against n_models prepared handles. Output is
+ * model-major (out[m * nrow + i]); each row is visited once and scored
+ * by every model while its nodes are still in cache.
+ */
+int wl_xl_predict_many(
+    void **handles, int n_models,
+    void *dtest,
+    float **out_preds, int *out_rows
+) {
+  last_error[0] = '\0';
+  if (!handles || n_models <= 0 || !dtest || !out_preds || !out_rows) {
+    set_error("wl_xl_predict_many: invalid arguments");
+    return -1;
+  }
+
+  std::vector<WlHandle*> hs((size_t)n_models);
+  std::vector<wl_fast::FastModel> fms((size_t)n_models);
+  std::vector<bool> is_norm((size_t)n_models);
+  std::unique_ptr<ThreadPool> pool;  /* shared by the wide rows of every model */
+  std::vector<WlWide> wide((size_t)n_models);
+  for (int m = 0; m < n_models; ++m) {
+    hs[m] = handles[m] ? as_handle(handles[m]) : nullptr;
+    if (!hs[m] || !has_model(hs[m])) {
+      set_error("wl_xl_predict_many: no model loaded");
+      return -1;
+    }
+    if (hs[m]->model) fms[m] = fast_model(hs[m]->model.get());
+    init_wide(hs[m], wide[m], pool);
+    is_norm[m] = reinterpret_cast<XLearn*>(hs[m]->xl)->GetHyperParam().norm;
+  }
+
+  xLearn::DMatrix *dm = reinterpret_cast<xLearn::DMatrix*>(dtest);
+  for (int m = 0; m < n_models; ++m) {
+    if (!pages_ready(hs[m], dm, "wl_xl_predict_many")) return -1;
+  }
+  size_t n = dm->row_length;
+  double t0 = wl_stats_now();
+  float *result = (float *)malloc((n > 0 ? n : 1) * n_models * sizeof(float));
+  if (!result) {
+    set_error("wl_xl_predict_many: allocation failed");
+    return -1;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    xLearn::SparseRow *row = dm->row[i];
+    for (int m = 0; m < n_models; ++m) {
+      xLearn::real_t norm = is_norm[m] ? dm->norm[i] : 1.0f;
+      WlHandle *hm = hs[m];
+      result[(size_t)m * n + i] =
+        wide[m].wants(row) ? wide[m].score(row, norm)
+        : hm->qmodel ? wl_quant::score(row, *hm->qmodel, norm)
+        : hm->pmodel ? wl_paged::score(row, *hm->pmodel, norm)
+        : WL_XL_HAS_FFM && hm->bmodel ? wl_ffm::score(row, *hm->bmodel, norm)
+        : hm->fast_score ? hm->fast_score(row, fms[m], norm)
+        : hm->score->CalcScore(row, *hm->model, norm);
+    }
+  }
+
+  /* Rows are scored by all models together; each is charged its share */
+  double ms = (wl_stats_now() - t0) / n_models;
+  for (int m = 0; m < n_models; ++m) wl_stats_add(hs[m]->stats.get(), kPhaseScore, ms);
+
+  *out_preds = result;
+  *out_rows = (int)n;
+  return 0;
 }
 
 /* ---------- memory management ---------- */
@@ -376,6 +2949,63 @@ void wl_xl_free_buffer(void *ptr) {
   free(ptr);
 }
 
+/* ---------- scratch arena ---------- */
+
+/*
+ * Bump allocator for the JS bridge's per-call temporaries (out-pointers,
+ * C strings, staged inputs). Everything handed out is released at once
+ * by wl_xl_scratch_reset, so a long-running process does not churn
+ * dlmalloc with millions of tiny malloc/free pairs.
+ *
+ * Requests that do not fit the current block are served by malloc and
+ * freed on reset; the block then grows to the high-water mark so the
+ * next call fits. Requests of kScratchLarge bytes or more always go to
+ * malloc so one big fit does not pin a big arena forever.
+ */
+static const size_t kScratchLarge = 1 << 20;
+
+static struct {
+  char *base = nullptr;
+  size_t cap = 0;
+  size_t used = 0;
+  size_t high_water = 0;
+  std::vector<void*> overflow;
+} scratch;
+
+void *wl_xl_scratch_alloc(int size) {
+  if (size < 0) return nullptr;
+  size_t n = ((size_t)size + 7) & ~(size_t)7;
+  if (n == 0) n = 8;
+  if (n < kScratchLarge) {
+    scratch.high_water += n;
+    if (scratch.used + n <= scratch.cap) {
+      void *p = scratch.base + scratch.used;
+      scratch.used += n;
+      return p;
+    }
+  }
+  void *p = malloc(n);
+  if (p) scratch.overflow.push_back(p);
+  return p;
+}
+
+void wl_xl_scratch_reset(void) {
+  for (void *p : scratch.overflow) free(p);
+  scratch.overflow.clear();
+  if (scratch.high_water > scratch.cap) {
+    size_t cap = scratch.cap ? scratch.cap : 4096;
+    while (cap < scratch.high_water) cap *= 2;
+    char *base = (char *)malloc(cap);
+    if (base) {
+      free(scratch.base);
+      scratch.base = base;
+      scratch.cap = cap;
+    }
+  }
+  scratch.used = 0;
+  scratch.high_water = 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
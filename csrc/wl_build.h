@@ -0,0 +1,54 @@
+/*
+ * wl_build.h -- Model types and features a build variant compiles in
+ *
+ * build-wasm.sh's single-algorithm variants define one of
+ * WL_XL_ONLY_LINEAR, WL_XL_ONLY_FM or WL_XL_ONLY_FFM. The other model
+ * types are then rejected by wl_xl_create and every branch that
+ * dispatches to their kernels is a compile-time constant false, so the
+ * kernels (specialized scorers, quantized, paged, blocked and parallel
+ * FFM code) are never instantiated. The matching score function files
+ * are left out of the link and score_registry_wasm.cc registers only
+ * the one kept.
+ *
+ * WL_XL_INFERENCE_ONLY (the infer variant) turns the training entry
+ * points into stubs that fail, so nothing reachable from the exports
+ * calls into upstream's solver, trainer or readers.
+ */
+
+#ifndef WL_XL_BUILD_H_
+#define WL_XL_BUILD_H_
+
+#include <cstring>
+
+#if defined(WL_XL_ONLY_LINEAR) + defined(WL_XL_ONLY_FM) + \
+    defined(WL_XL_ONLY_FFM) > 1
+#error "define at most one of WL_XL_ONLY_LINEAR, WL_XL_ONLY_FM, WL_XL_ONLY_FFM"
+#endif
+
+#if defined(WL_XL_ONLY_LINEAR)
+#define WL_XL_HAS_LINEAR 1
+#define WL_XL_HAS_FM 0
+#define WL_XL_HAS_FFM 0
+#elif defined(WL_XL_ONLY_FM)
+#define WL_XL_HAS_LINEAR 0
+#define WL_XL_HAS_FM 1
+#define WL_XL_HAS_FFM 0
+#elif defined(WL_XL_ONLY_FFM)
+#define WL_XL_HAS_LINEAR 0
+#define WL_XL_HAS_FM 0
+#define WL_XL_HAS_FFM 1
+#else
+#define WL_XL_HAS_LINEAR 1
+#define WL_XL_HAS_FM 1
+#define WL_XL_HAS_FFM 1
+#endif
+
+/* Whether this build scores models of score function name */
+static inline bool wl_build_has(const char *name) {
+  if (std::strcmp(name, "linear") == 0) return WL_XL_HAS_LINEAR;
+  if (std::strcmp(name, "fm") == 0) return WL_XL_HAS_FM;
+  if (std::strcmp(name, "ffm") == 0) return WL_XL_HAS_FFM;
+  return false;
+}
+
+#endif  // WL_XL_BUILD_H_
@@ -0,0 +1,123 @@
+/*
+ * wl_stats.h -- Opt-in per-handle timers and counters for the bridge
+ *
+ * A handle with stats enabled (wl_xl_enable_stats) owns a WlStats that
+ * accumulates, per phase, wall time and call count, plus bytes copied
+ * across the bridge, allocations the bridge made for the handle and the
+ * heap top (current, peak). A handle without stats has a null pointer,
+ * so each instrumented call costs one branch; building with
+ * -DWL_XL_NO_STATS compiles the timers out entirely.
+ *
+ * Phases cover the C side only (train, model parse, scoring, model
+ * serialization). The JS bridge times its own input conversion and
+ * output copies.
+ */
+
+#ifndef WL_XL_STATS_H_
+#define WL_XL_STATS_H_
+
+#include <stdint.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#endif
+
+enum WlPhase {
+  kPhaseFit = 0,   /* training (fit, partial fit, epochs) */
+  kPhaseLoad,      /* model bytes parsed and installed */
+  kPhaseScore,     /* rows scored against the prepared model */
+  kPhaseSave,      /* model serialized into a buffer */
+  kNumPhases
+};
+
+/*
+ * Layout written by wl_xl_get_stats (doubles): ms and calls for each
+ * phase in WlPhase order, then bytes_copied, allocs, heap_bytes,
+ * peak_heap_bytes.
+ */
+static const int kStatsLen = 2 * kNumPhases + 4;
+
+struct WlStats {
+  double ms[kNumPhases] = {};
+  double calls[kNumPhases] = {};
+  double bytes_copied = 0;
+  double allocs = 0;
+  double heap_bytes = 0;
+  double peak_heap_bytes = 0;
+};
+
+static inline double wl_now_ms() {
+#ifdef __EMSCRIPTEN__
+  return emscripten_get_now();
+#else
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/* Top of the malloc heap (bytes), a cheap proxy for heap in use */
+static inline double wl_heap_top() {
+#ifdef __EMSCRIPTEN__
+  return (double)(uintptr_t)sbrk(0);
+#else
+  return 0;
+#endif
+}
+
+static inline void wl_stats_sample_heap(WlStats *s) {
+  s->heap_bytes = wl_heap_top();
+  if (s->heap_bytes > s->peak_heap_bytes) s->peak_heap_bytes = s->heap_bytes;
+}
+
+#ifndef WL_XL_NO_STATS
+
+/* Clock for manually timed phases (0 when stats are compiled out) */
+static inline double wl_stats_now() { return wl_now_ms(); }
+
+/* Charge ms of wall time and one call to a phase */
+static inline void wl_stats_add(WlStats *s, int phase, double ms) {
+  if (!s) return;
+  s->ms[phase] += ms;
+  s->calls[phase] += 1;
+  wl_stats_sample_heap(s);
+}
+
+/* Times one phase over its scope when s is non-null */
+struct WlPhaseTimer {
+  WlStats *s;
+  int phase;
+  double t0;
+
+  WlPhaseTimer(WlStats *s, int phase)
+    : s(s), phase(phase), t0(s ? wl_now_ms() : 0) {}
+  ~WlPhaseTimer() {
+    if (s) wl_stats_add(s, phase, wl_now_ms() - t0);
+  }
+};
+
+static inline void wl_stats_bytes(WlStats *s, double n) {
+  if (s) s->bytes_copied += n;
+}
+
+static inline void wl_stats_alloc(WlStats *s) {
+  if (s) s->allocs += 1;
+}
+
+#else  /* WL_XL_NO_STATS */
+
+static inline double wl_stats_now() { return 0; }
+static inline void wl_stats_add(WlStats *, int, double) {}
+
+struct WlPhaseTimer {
+  WlPhaseTimer(WlStats *, int) {}
+};
+
+static inline void wl_stats_bytes(WlStats *, double) {}
+static inline void wl_stats_alloc(WlStats *) {}
+
+#endif  /* WL_XL_NO_STATS */
+
+#endif  // WL_XL_STATS_H_
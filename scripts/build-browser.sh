@@ -41,7 +41,7 @@ EXPORTS=$(node -e "
 
 echo "=== Building browser bundles ==="
 echo "  Package: ${NAME}"
-echo "  Files: ${NAME}.js, ${NAME}.mjs"
+echo "  Files: ${NAME}.js, ${NAME}.mjs, ${NAME}-worker.js"
 echo "  Exports: ${EXPORTS}"
 
 mkdir -p "$DIST_DIR"
@@ -52,6 +52,8 @@ if [ ! -f "${PROJECT_DIR}/scripts/empty.js" ]; then
 fi
 
 # Common esbuild flags
+# The pthreads build loads itself as a worker script, so it cannot be
+# inlined; loadXLearn() falls back to the single-threaded build.
 COMMON_FLAGS=(
   --bundle
   --platform=browser
@@ -60,6 +62,8 @@ COMMON_FLAGS=(
   --alias:node:crypto=./scripts/empty.js
   --alias:node:path=./scripts/empty.js
   --alias:ws=./scripts/empty.js
+  --alias:worker_threads=./scripts/empty.js
+  --external:../wasm/xlearn-mt.js
   --define:__dirname='""'
   --define:__filename='""'
 )
@@ -85,5 +89,11 @@ DESTRUCTURE=$(IFS=','; echo "${KEYS[*]}")
 EXPORT_LINE=$(IFS=','; echo "${KEYS[*]}")
 echo "var {${DESTRUCTURE}}=${INTERNAL};export{${EXPORT_LINE}};" >> "${DIST_DIR}/${NAME}.mjs"
 
+# Worker script for XLearnEngine (pass its URL as workerUrl)
+npx esbuild "${PROJECT_DIR}/src/worker.js" \
+  "${COMMON_FLAGS[@]}" \
+  --format=iife \
+  --outfile="${DIST_DIR}/${NAME}-worker.js"
+
 echo "=== Browser bundles built ==="
-ls -lh "${DIST_DIR}/${NAME}.js" "${DIST_DIR}/${NAME}.mjs"
+ls -lh "${DIST_DIR}/${NAME}.js" "${DIST_DIR}/${NAME}.mjs" "${DIST_DIR}/${NAME}-worker.js"
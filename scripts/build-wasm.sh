@@ -42,6 +42,13 @@ if grep -q 'pos + kChunkSize, end' src/base/file_util.h 2>/dev/null; then
   echo "  Patching std::min type mismatch in file_util.h"
   sed -i 's/std::min(pos + kChunkSize, end)/std::min(pos + (long)kChunkSize, end)/g' src/base/file_util.h
 fi
+
+# Patch 3: Let the adapter take ownership of the trained model
+# (wl_xl_fit_model keeps it resident instead of serializing to MEMFS)
+if ! grep -q 'ReleaseModel' src/solver/solver.h 2>/dev/null; then
+  echo "  Patching Solver::ReleaseModel() into solver.h"
+  sed -i 's/^\(\s*\)void StartWork();/&\n\1Model* ReleaseModel() { Model* m = model_; model_ = nullptr; return m; }/' src/solver/solver.h
+fi
 cd "$PROJECT_DIR"
 
 echo "=== Compiling WASM ==="
@@ -66,44 +73,187 @@ SOURCES=(
   "${UPSTREAM_DIR}/src/reader/file_splitor.cc"
   "${UPSTREAM_DIR}/src/reader/parser.cc"
   "${UPSTREAM_DIR}/src/reader/reader.cc"
-  "${UPSTREAM_DIR}/src/score/ffm_score.cc"
-  "${UPSTREAM_DIR}/src/score/fm_score.cc"
-  "${UPSTREAM_DIR}/src/score/linear_score.cc"
-  "${UPSTREAM_DIR}/src/score/score_function.cc"
   "${UPSTREAM_DIR}/src/solver/checker.cc"
   "${UPSTREAM_DIR}/src/solver/inference.cc"
   "${UPSTREAM_DIR}/src/solver/solver.cc"
   "${UPSTREAM_DIR}/src/solver/trainer.cc"
 )
 
-EXPORTED_FUNCTIONS='["_wl_xl_get_last_error","_wl_xl_create","_wl_xl_free_handle","_wl_xl_set_str","_wl_xl_set_int","_wl_xl_set_float","_wl_xl_set_bool","_wl_xl_create_dmatrix_dense","_wl_xl_create_dmatrix_csr","_wl_xl_free_dmatrix","_wl_xl_fit","_wl_xl_predict","_wl_xl_free_buffer","_malloc","_free"]'
+# Score functions, per model type (the single-algorithm variants link one)
+LINEAR_SOURCES=("${UPSTREAM_DIR}/src/score/linear_score.cc")
+
+# FM/FFM score functions: simd128 (default) uses the wasm_simd128 kernels
+# in csrc/, sse compiles upstream's SSE3 code through Emscripten's
+# emulation headers, scalar uses csrc/ with plain scalar lanes.
+SCORE_KERNELS="${SCORE_KERNELS:-simd128}"
+SCORE_FLAGS=()
+case "$SCORE_KERNELS" in
+  simd128|scalar)
+    FM_SOURCES=("${PROJECT_DIR}/csrc/fm_score_wasm.cc")
+    FFM_SOURCES=("${PROJECT_DIR}/csrc/ffm_score_wasm.cc")
+    if [ "$SCORE_KERNELS" = scalar ]; then
+      SCORE_FLAGS+=(-DWL_XL_SCALAR_KERNELS)
+    fi
+    ;;
+  sse)
+    FM_SOURCES=("${UPSTREAM_DIR}/src/score/fm_score.cc")
+    FFM_SOURCES=("${UPSTREAM_DIR}/src/score/ffm_score.cc")
+    # fast_score.h mirrors the simd128 kernels; predict via CalcScore here
+    SCORE_FLAGS+=(-DWL_XL_UPSTREAM_SCORE)
+    ;;
+  *)
+    echo "ERROR: unknown SCORE_KERNELS=${SCORE_KERNELS} (simd128, sse, scalar)"
+    exit 1
+    ;;
+esac
+
+# Every model type, registered by upstream's score_function.cc
+ALL_SCORE_SOURCES=(
+  "${UPSTREAM_DIR}/src/score/score_function.cc"
+  "${LINEAR_SOURCES[@]}"
+  "${FM_SOURCES[@]}"
+  "${FFM_SOURCES[@]}"
+)
+
+# Extra single-threaded targets, e.g. VARIANTS="speed infer lr fm ffm"
+# (npm run build:variants). Each is a wasm/xlearn-<name>.js + .wasm pair
+# (not SINGLE_FILE), so browsers stream-compile the binary:
+#   speed      every model type and training, -O3 -flto
+#   infer      scoring and model I/O only (training entry points stubbed,
+#              no filesystem), -Os -flto
+#   lr/fm/ffm  one model type with training, -Os -flto
+VARIANTS="${VARIANTS:-}"
+for v in $VARIANTS; do
+  case "$v" in
+    speed|infer|lr|fm|ffm) ;;
+    *)
+      echo "ERROR: unknown variant ${v} (speed, infer, lr, fm, ffm)"
+      exit 1
+      ;;
+  esac
+done
+
+# Per-handle stats (model.stats()) are built in; STATS=0 compiles the
+# timers out entirely
+STATS="${STATS:-1}"
+STATS_FLAGS=()
+if [ "$STATS" = 0 ]; then
+  STATS_FLAGS+=(-DWL_XL_NO_STATS)
+fi
+
+EXPORTED_FUNCTIONS='["_wl_xl_get_last_error","_wl_xl_set_verbose","_wl_xl_max_threads","_wl_xl_create","_wl_xl_free_handle","_wl_xl_set_str","_wl_xl_set_int","_wl_xl_set_float","_wl_xl_set_bool","_wl_xl_set_neg_sampling","_wl_xl_create_dmatrix_dense","_wl_xl_create_dmatrix_csr","_wl_xl_create_dmatrix_hashed","_wl_xl_free_dmatrix","_wl_xl_dmatrix_retain","_wl_xl_dmatrix_set_weights","_wl_xl_dmatrix_bytes","_wl_xl_dmatrix_begin","_wl_xl_dmatrix_append_rows","_wl_xl_dmatrix_append_csr","_wl_xl_dmatrix_finish","_wl_xl_dmatrix_abort","_wl_xl_batch_create","_wl_xl_batch_fill_dense","_wl_xl_batch_fill_csr","_wl_xl_batch_capacity","_wl_xl_save_dmatrix","_wl_xl_load_dmatrix","_wl_xl_fit","_wl_xl_fit_model","_wl_xl_fit_file","_wl_xl_fit_begin","_wl_xl_fit_epoch","_wl_xl_snapshot_model","_wl_xl_restore_snapshot","_wl_xl_model_shape","_wl_xl_partial_fit","_wl_xl_predict","_wl_xl_load_model","_wl_xl_model_size","_wl_xl_save_model","_wl_xl_set_layout","_wl_xl_set_parallel_nnz","_wl_xl_save_quantized","_wl_xl_load_quantized","_wl_xl_save_paged","_wl_xl_load_paged","_wl_xl_paged_missing","_wl_xl_paged_page_info","_wl_xl_paged_page_in","_wl_xl_paged_drop","_wl_xl_paged_stats","_wl_xl_enable_stats","_wl_xl_reset_stats","_wl_xl_get_stats","_wl_xl_handle_bytes","_wl_xl_heap_top","_wl_xl_predict_loaded","_wl_xl_predict_many","_wl_xl_predict_into","_wl_xl_predict_proba","_wl_xl_evaluate","_wl_xl_free_buffer","_wl_xl_scratch_alloc","_wl_xl_scratch_reset","_malloc","_free"]'
+
+EXPORTED_RUNTIME_METHODS='["ccall","getValue","setValue","HEAPF32","HEAPF64","HEAP32","HEAPU8"]'
+FS_RUNTIME_METHODS='["ccall","getValue","setValue","HEAPF32","HEAPF64","HEAP32","HEAPU8","FS"]'
+
+# Flags shared by every build target
+BASE_FLAGS=(
+  -I "${PROJECT_DIR}/csrc"
+  -I "${UPSTREAM_DIR}"
+  -I "${UPSTREAM_DIR}/src"
+  -std=c++11
+  -msimd128 -msse3
+  ${SCORE_FLAGS[@]+"${SCORE_FLAGS[@]}"}
+  ${STATS_FLAGS[@]+"${STATS_FLAGS[@]}"}
+  -s MODULARIZE=1
+  -s EXPORT_NAME=createXLearn
+  -s EXPORTED_FUNCTIONS="${EXPORTED_FUNCTIONS}"
+  -s ALLOW_MEMORY_GROWTH=1
+  -Wno-deprecated-register
+  -Wno-sign-compare
+  -Wno-unused-variable
+  -Wno-unused-but-set-variable
+)
+
+# Host files for fitFile(): NODEFS in Node, WORKERFS for File/Blob in workers
+FS_FLAGS=(
+  -s FORCE_FILESYSTEM=1
+  -lnodefs.js
+  -lworkerfs.js
+  -s EXPORTED_RUNTIME_METHODS="${FS_RUNTIME_METHODS}"
+)
 
-EXPORTED_RUNTIME_METHODS='["ccall","getValue","setValue","HEAPF32","HEAPU8"]'
+# Default targets: the binary is embedded in the JS, so bundlers inline it
+COMMON_FLAGS=(
+  "${BASE_FLAGS[@]}"
+  "${FS_FLAGS[@]}"
+  -s SINGLE_FILE=1
+  -s SINGLE_FILE_BINARY_ENCODE=0
+  -O2
+)
 
+# Single-threaded build: upstream ThreadPool replaced by the inline shim
+echo "  xlearn.js (single-threaded)"
 em++ \
-  "${SOURCES[@]}" \
-  -I "${PROJECT_DIR}/csrc" \
-  -I "${UPSTREAM_DIR}" \
-  -I "${UPSTREAM_DIR}/src" \
+  "${SOURCES[@]}" "${ALL_SCORE_SOURCES[@]}" \
+  "${COMMON_FLAGS[@]}" \
   -include "${PROJECT_DIR}/csrc/thread_pool_wasm.h" \
   -o "${OUTPUT_DIR}/xlearn.js" \
-  -std=c++11 \
-  -msimd128 -msse3 \
-  -s MODULARIZE=1 \
-  -s SINGLE_FILE=1 \
-  -s SINGLE_FILE_BINARY_ENCODE=0 \
-  -s EXPORT_NAME=createXLearn \
-  -s FORCE_FILESYSTEM=1 \
-  -s EXPORTED_FUNCTIONS="${EXPORTED_FUNCTIONS}" \
-  -s EXPORTED_RUNTIME_METHODS="${EXPORTED_RUNTIME_METHODS}" \
-  -s ALLOW_MEMORY_GROWTH=1 \
   -s INITIAL_MEMORY=16777216 \
-  -s ENVIRONMENT='web,node' \
-  -Wno-deprecated-register \
-  -Wno-sign-compare \
-  -Wno-unused-variable \
-  -Wno-unused-but-set-variable \
-  -O2
+  -s ENVIRONMENT='web,node'
+
+# Multi-threaded build: upstream ThreadPool on Emscripten pthreads.
+# Workers are pre-spawned (one per logical core) because a blocked main
+# thread cannot start new ones; wl_xl_create caps nthread to the same
+# count. Requires SharedArrayBuffer (cross-origin isolation in browsers).
+PTHREAD_POOL_SIZE_EXPR='(typeof navigator!=="undefined"&&navigator.hardwareConcurrency)||require("os").cpus().length'
+echo "  xlearn-mt.js (pthreads)"
+em++ \
+  "${SOURCES[@]}" "${ALL_SCORE_SOURCES[@]}" \
+  "${COMMON_FLAGS[@]}" \
+  -pthread \
+  -o "${OUTPUT_DIR}/xlearn-mt.js" \
+  -s PTHREAD_POOL_SIZE="${PTHREAD_POOL_SIZE_EXPR}" \
+  -s INITIAL_MEMORY=67108864 \
+  -s MAXIMUM_MEMORY=4294967296 \
+  -s ENVIRONMENT='web,worker,node' \
+  -Wno-pthreads-mem-growth
+
+# Variants. With LTO the linker drops whatever no export reaches; infer
+# and the single-algorithm builds compile training / the other model
+# types out of wl_api.cpp (csrc/wl_build.h). Upstream's solver, trainer
+# and readers stay in the infer source list: c_api.cc, which creates the
+# handles, embeds a Solver and references them from XLearnFit and
+# XLearnPredict, so they must resolve. Nothing in wl_api.cpp calls them
+# there, so LTO drops their code; the build prints each variant's size.
+for v in $VARIANTS; do
+  echo "  xlearn-${v}.js + xlearn-${v}.wasm"
+  V_SOURCES=("${SOURCES[@]}")
+  V_FLAGS=("${BASE_FLAGS[@]}" -flto)
+  case "$v" in
+    speed)
+      V_SOURCES+=("${ALL_SCORE_SOURCES[@]}")
+      V_FLAGS+=("${FS_FLAGS[@]}" -O3)
+      ;;
+    infer)
+      V_SOURCES+=("${ALL_SCORE_SOURCES[@]}")
+      V_FLAGS+=(
+        -DWL_XL_INFERENCE_ONLY
+        -s EXPORTED_RUNTIME_METHODS="${EXPORTED_RUNTIME_METHODS}"
+        -Os
+      )
+      ;;
+    lr)
+      V_SOURCES+=("${PROJECT_DIR}/csrc/score_registry_wasm.cc" "${LINEAR_SOURCES[@]}")
+      V_FLAGS+=(-DWL_XL_ONLY_LINEAR "${FS_FLAGS[@]}" -Os)
+      ;;
+    fm)
+      V_SOURCES+=("${PROJECT_DIR}/csrc/score_registry_wasm.cc" "${FM_SOURCES[@]}")
+      V_FLAGS+=(-DWL_XL_ONLY_FM "${FS_FLAGS[@]}" -Os)
+      ;;
+    ffm)
+      V_SOURCES+=("${PROJECT_DIR}/csrc/score_registry_wasm.cc" "${FFM_SOURCES[@]}")
+      V_FLAGS+=(-DWL_XL_ONLY_FFM "${FS_FLAGS[@]}" -Os)
+      ;;
+  esac
+  em++ \
+    "${V_SOURCES[@]}" \
+    "${V_FLAGS[@]}" \
+    -include "${PROJECT_DIR}/csrc/thread_pool_wasm.h" \
+    -o "${OUTPUT_DIR}/xlearn-${v}.js" \
+    -s INITIAL_MEMORY=16777216 \
+    -s ENVIRONMENT='web,worker,node'
+done
 
 echo "=== Verifying exports ==="
 bash "${SCRIPT_DIR}/verify-exports.sh"
@@ -114,10 +264,15 @@ upstream: xlearn v0.44
 upstream_commit: $(cd "$UPSTREAM_DIR" && git rev-parse HEAD 2>/dev/null || echo "unknown")
 build_date: $(date -u +%Y-%m-%dT%H:%M:%SZ)
 emscripten: $(em++ --version | head -1)
-build_flags: -O2 SINGLE_FILE=1 sequential-threadpool
+build_flags: -O2 SINGLE_FILE=1 score_kernels=${SCORE_KERNELS}
+variants: xlearn.js (sequential-threadpool), xlearn-mt.js (pthreads)
 wasm_embedded: true
+extra_variants: ${VARIANTS:-none}
 EOF
 
 echo "=== Build complete ==="
-ls -lh "${OUTPUT_DIR}/xlearn.js"
+ls -lh "${OUTPUT_DIR}/xlearn.js" "${OUTPUT_DIR}/xlearn-mt.js"
+for v in $VARIANTS; do
+  ls -lh "${OUTPUT_DIR}/xlearn-${v}.js" "${OUTPUT_DIR}/xlearn-${v}.wasm"
+done
 cat "${OUTPUT_DIR}/BUILD_INFO"
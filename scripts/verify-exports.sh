@@ -3,35 +3,102 @@ set -euo pipefail
 
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
-WASM_FILE="${PROJECT_DIR}/wasm/xlearn.js"
+WASM_FILES=(
+  "${PROJECT_DIR}/wasm/xlearn.js"
+  "${PROJECT_DIR}/wasm/xlearn-mt.js"
+)
 
-if [ ! -f "$WASM_FILE" ]; then
-  echo "ERROR: ${WASM_FILE} not found. Run build-wasm.sh first."
-  exit 1
-fi
+for WASM_FILE in "${WASM_FILES[@]}"; do
+  if [ ! -f "$WASM_FILE" ]; then
+    echo "ERROR: ${WASM_FILE} not found. Run build-wasm.sh first."
+    exit 1
+  fi
+done
+
+# Variants built with VARIANTS=... (build-wasm.sh), when present
+for WASM_FILE in "${PROJECT_DIR}"/wasm/xlearn-*.js; do
+  case "$(basename "$WASM_FILE")" in
+    xlearn-mt.js|xlearn-\*.js) ;;
+    *) WASM_FILES+=("$WASM_FILE") ;;
+  esac
+done
 
 EXPECTED_EXPORTS=(
   wl_xl_get_last_error
+  wl_xl_set_verbose
+  wl_xl_max_threads
   wl_xl_create
   wl_xl_free_handle
   wl_xl_set_str
   wl_xl_set_int
   wl_xl_set_float
   wl_xl_set_bool
+  wl_xl_set_neg_sampling
   wl_xl_create_dmatrix_dense
   wl_xl_create_dmatrix_csr
+  wl_xl_create_dmatrix_hashed
   wl_xl_free_dmatrix
+  wl_xl_dmatrix_retain
+  wl_xl_dmatrix_set_weights
+  wl_xl_dmatrix_bytes
+  wl_xl_dmatrix_begin
+  wl_xl_dmatrix_append_rows
+  wl_xl_dmatrix_append_csr
+  wl_xl_dmatrix_finish
+  wl_xl_dmatrix_abort
+  wl_xl_batch_create
+  wl_xl_batch_fill_dense
+  wl_xl_batch_fill_csr
+  wl_xl_batch_capacity
+  wl_xl_save_dmatrix
+  wl_xl_load_dmatrix
   wl_xl_fit
+  wl_xl_fit_model
+  wl_xl_fit_file
+  wl_xl_fit_begin
+  wl_xl_fit_epoch
+  wl_xl_snapshot_model
+  wl_xl_restore_snapshot
+  wl_xl_model_shape
+  wl_xl_partial_fit
   wl_xl_predict
+  wl_xl_load_model
+  wl_xl_model_size
+  wl_xl_save_model
+  wl_xl_set_layout
+  wl_xl_set_parallel_nnz
+  wl_xl_save_quantized
+  wl_xl_load_quantized
+  wl_xl_save_paged
+  wl_xl_load_paged
+  wl_xl_paged_missing
+  wl_xl_paged_page_info
+  wl_xl_paged_page_in
+  wl_xl_paged_drop
+  wl_xl_paged_stats
+  wl_xl_enable_stats
+  wl_xl_reset_stats
+  wl_xl_get_stats
+  wl_xl_handle_bytes
+  wl_xl_heap_top
+  wl_xl_predict_loaded
+  wl_xl_predict_many
+  wl_xl_predict_into
+  wl_xl_predict_proba
+  wl_xl_evaluate
   wl_xl_free_buffer
+  wl_xl_scratch_alloc
+  wl_xl_scratch_reset
 )
 
 MISSING=0
-for fn in "${EXPECTED_EXPORTS[@]}"; do
-  if ! grep -q "\"_${fn}\"" "$WASM_FILE"; then
-    echo "MISSING: _${fn}"
-    MISSING=$((MISSING + 1))
-  fi
+for WASM_FILE in "${WASM_FILES[@]}"; do
+  for fn in "${EXPECTED_EXPORTS[@]}"; do
+    if ! grep -q "\"_${fn}\"" "$WASM_FILE"; then
+      echo "MISSING: _${fn} in $(basename "$WASM_FILE")"
+      MISSING=$((MISSING + 1))
+    fi
+  done
 done
 
 if [ "$MISSING" -gt 0 ]; then
@@ -39,4 +106,4 @@ if [ "$MISSING" -gt 0 ]; then
   exit 1
 fi
 
-echo "All ${#EXPECTED_EXPORTS[@]} exports verified OK"
+echo "All ${#EXPECTED_EXPORTS[@]} exports verified OK in ${#WASM_FILES[@]} builds"
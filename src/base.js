@@ -1,4 +1,5 @@
 const { getWasm, loadXLearn } = require('./wasm.js')
+const { XLearnEngine } = require('./engine.js')
 const {
   normalizeX, normalizeY,
   encodeBundle, decodeBundle,
@@ -8,9 +9,9 @@ const {
 
 // FinalizationRegistry safety net
 const leakRegistry = typeof FinalizationRegistry !== 'undefined'
-  ? new FinalizationRegistry(({ ref, freeFn }) => {
+  ? new FinalizationRegistry(({ ref, what = 'Model', freeFn }) => {
     if (ref[0]) {
-      console.warn('@wlearn/xlearn: Model was not disposed -- calling free() automatically. This is a bug in your code.')
+      console.warn(`@wlearn/xlearn: ${what} was not disposed -- calling free() automatically. This is a bug in your code.`)
       freeFn(ref[0])
     }
   })
@@ -19,22 +20,108 @@ const leakRegistry = typeof FinalizationRegistry !== 'undefined'
 // Internal sentinel for load path
 const LOAD_SENTINEL = Symbol('load')
 
-// Helper: C string allocation
-function withCString(wasm, str, fn) {
-  const bytes = new TextEncoder().encode(str + '\0')
-  const ptr = wasm._malloc(bytes.length)
-  wasm.HEAPU8.set(bytes, ptr)
+// Keys that identify models to an XLearnEngine
+let nextEngineKey = 0
+
+// Keys of models in the heap accounting (XLearnBase.memoryUsage)
+let nextMemKey = 0
+
+// The LRU list must not keep undisposed models alive (see leakRegistry)
+function weakRef(obj) {
+  return typeof WeakRef !== 'undefined' ? new WeakRef(obj) : { deref: () => obj }
+}
+
+// save({ quantize }) formats -> bits per latent weight
+const QUANT_BITS = { fp16: 16, int8: 8 }
+
+// wl_xl_get_stats layout (csrc/wl_stats.h): ms and calls per C-side
+// phase in this order, then bytes copied, allocations, heap top, peak
+const STATS_PHASES = ['fit', 'load', 'score', 'save']
+const STATS_LEN = 2 * STATS_PHASES.length + 4
+
+function newJsStats() {
+  return { convert: { ms: 0, calls: 0 }, copyOut: { ms: 0, calls: 0 }, bytes: 0 }
+}
+
+function addPhase(phase, t0, bytes, stats) {
+  phase.ms += performance.now() - t0
+  phase.calls++
+  stats.bytes += bytes
+}
+
+// Per-call scratch memory: temporaries (out-pointers, C strings, staged
+// inputs) are bump-allocated from the C side's arena and released
+// together when the outermost withScratch() scope exits.
+let scratchDepth = 0
+
+function withScratch(wasm, fn) {
+  scratchDepth++
   try {
-    return fn(ptr)
+    return fn()
   } finally {
-    wasm._free(ptr)
+    if (--scratchDepth === 0) wasm._wl_xl_scratch_reset()
   }
 }
 
+function scratch(wasm, bytes) {
+  const ptr = wasm._wl_xl_scratch_alloc(bytes)
+  if (!ptr) throw new Error(`scratch allocation of ${bytes} bytes failed`)
+  return ptr
+}
+
+// Helper: C string allocation (scratch, released with the enclosing scope)
+function withCString(wasm, str, fn) {
+  const bytes = new TextEncoder().encode(str + '\0')
+  const ptr = scratch(wasm, bytes.length)
+  wasm.HEAPU8.set(bytes, ptr)
+  return fn(ptr)
+}
+
 function getLastError() {
   return getWasm().ccall('wl_xl_get_last_error', 'string', [], [])
 }
 
+// Detect hashed input: (field, token hash) entries per row
+function isHashed(X) {
+  return X != null && X.hashes != null && X.fields != null && X.indptr != null
+}
+
+// 32-bit FNV-1a of a string token (UTF-16 code units), for hashed input
+function hashToken(token) {
+  const str = String(token)
+  let h = 0x811c9dc5
+  for (let i = 0; i < str.length; i++) {
+    h ^= str.charCodeAt(i)
+    h = Math.imul(h, 0x01000193)
+  }
+  return h >>> 0
+}
+
+// Hashed input from rows of [field, token] or [field, token, value]
+// entries (token: string, or a number used as its hash)
+function hashRows(rowsIn) {
+  let nnz = 0
+  for (const row of rowsIn) nnz += row.length
+  const fields = new Int32Array(nnz)
+  const hashes = new Uint32Array(nnz)
+  const indptr = new Int32Array(rowsIn.length + 1)
+  let values = null
+  let k = 0
+  rowsIn.forEach((row, i) => {
+    for (const entry of row) {
+      fields[k] = entry[0]
+      hashes[k] = typeof entry[1] === 'number' ? entry[1] >>> 0 : hashToken(entry[1])
+      if (entry.length > 2) {
+        if (!values) values = new Float32Array(nnz).fill(1)
+        values[k] = entry[2]
+      }
+      k++
+    }
+    indptr[i + 1] = k
+  })
+  return { rows: rowsIn.length, indptr, fields, hashes, values }
+}
+
 // Detect CSR matrix: has indices + indptr arrays
 function isCSR(X) {
   return X && typeof X === 'object' && !Array.isArray(X)
@@ -42,14 +129,656 @@ function isCSR(X) {
     && X.indptr instanceof Int32Array
 }
 
-// Sigmoid function
-function sigmoid(x) {
-  if (x >= 0) {
-    const e = Math.exp(-x)
-    return 1 / (1 + e)
+// Dense X as { data, rows, cols }. Typed input ({ data: Float32Array or
+// Float64Array, rows, cols }) is used as it is, so Float32Array data
+// reaches the heap in one same-type HEAPF32.set with no intermediate
+// copy; nested arrays and other forms go through normalizeX.
+function denseInput(X) {
+  if (X && (X.data instanceof Float32Array || X.data instanceof Float64Array) &&
+      Number.isInteger(X.rows) && Number.isInteger(X.cols)) {
+    if (X.data.length !== X.rows * X.cols) {
+      throw new Error(`X.data length (${X.data.length}) does not match rows * cols (${X.rows * X.cols})`)
+    }
+    return X
+  }
+  return normalizeX(X)
+}
+
+// Labels as a typed array. Float32Array, Float64Array and Int32Array
+// are kept as they are; writeLabels() reads any of them in one pass.
+function labelArray(y) {
+  if (y instanceof Float32Array || y instanceof Float64Array || y instanceof Int32Array) {
+    return y
+  }
+  const yNorm = normalizeY(y)
+  return yNorm instanceof Float64Array ? yNorm : new Float64Array(yNorm)
+}
+
+// evaluate() metrics (wl_eval::Metric) and the tasks they apply to
+const METRICS = {
+  accuracy: { id: 0, binary: true },
+  logloss: { id: 1, binary: true },
+  auc: { id: 2, binary: true },
+  rmse: { id: 3, binary: false },
+  r2: { id: 4, binary: false }
+}
+
+// Make a training source visible to the WASM filesystem. Strings are
+// host paths (Node: the containing directory is mounted via NODEFS);
+// File/Blob objects are mounted via WORKERFS, which needs a worker.
+let mountCounter = 0
+function mountSource(wasm, source) {
+  const FS = wasm.FS
+  if (!FS) throw new Error('fitFile: this xLearn build has no filesystem (inference-only)')
+  const mnt = `/wl_xl_src_${mountCounter++}`
+  let name
+  FS.mkdir(mnt)
+  try {
+    if (typeof source === 'string') {
+      const path = require('path')
+      const abs = path.resolve(source)
+      name = path.basename(abs)
+      FS.mount(FS.filesystems.NODEFS, { root: path.dirname(abs) }, mnt)
+    } else if (typeof Blob !== 'undefined' && source instanceof Blob) {
+      name = source.name || 'data.txt'
+      FS.mount(FS.filesystems.WORKERFS, { blobs: [{ name, data: source }] }, mnt)
+    } else {
+      throw new Error('fitFile: source must be a path or a File/Blob')
+    }
+  } catch (e) {
+    FS.rmdir(mnt)
+    throw e
+  }
+  return {
+    path: `${mnt}/${name}`,
+    unmount: () => { FS.unmount(mnt); FS.rmdir(mnt) },
+  }
+}
+
+// Paged model files (savePaged / loadPaged):
+//   'WLPG', u32 manifest bytes, u32 field map bytes,
+//   manifest JSON, field map (Int32), paged blob (see wl_api.cpp)
+const PAGED_MAGIC = 0x47504c57 // 'WLPG'
+const PAGED_PREFIX = 12
+
+// XLearnDataset.save() files: magic, manifest bytes, training and
+// validation DMatrix blob bytes, then the three sections
+const DATASET_MAGIC = 0x53444c57 // 'WLDS'
+const DATASET_PREFIX = 16
+
+// Random-access reader over a paged model file. Paths and fds (Node)
+// and in-memory bytes are read synchronously, straight into the heap;
+// Blob/File slices are read asynchronously.
+function openPageSource(source) {
+  if (typeof source === 'string' || typeof source === 'number') {
+    const fs = require('fs')
+    const owned = typeof source === 'string'
+    const fd = owned ? fs.openSync(source, 'r') : source
+    return {
+      sync: true,
+      readInto(dst, pos) {
+        let done = 0
+        while (done < dst.length) {
+          const n = fs.readSync(fd, dst, done, dst.length - done, pos + done)
+          if (n === 0) throw new Error('paged model file is truncated')
+          done += n
+        }
+      },
+      close() { if (owned) fs.closeSync(fd) }
+    }
+  }
+  if (source instanceof Uint8Array) {
+    return {
+      sync: true,
+      readInto(dst, pos) {
+        if (pos + dst.length > source.length) throw new Error('paged model file is truncated')
+        dst.set(source.subarray(pos, pos + dst.length))
+      },
+      close() {}
+    }
+  }
+  if (typeof Blob !== 'undefined' && source instanceof Blob) {
+    return {
+      sync: false,
+      async read(pos, length) {
+        const bytes = new Uint8Array(await source.slice(pos, pos + length).arrayBuffer())
+        if (bytes.length !== length) throw new Error('paged model file is truncated')
+        return bytes
+      },
+      close() {}
+    }
+  }
+  throw new Error('loadPaged: source must be a path, fd, Uint8Array or Blob')
+}
+
+async function readAt(src, pos, length) {
+  if (!src.sync) return src.read(pos, length)
+  const bytes = new Uint8Array(length)
+  src.readInto(bytes, pos)
+  return bytes
+}
+
+// Dense, CSR or hashed input (y: labels or null, featureFields: FFM map
+// or null, hashBits: table size of hashed models, 0 otherwise) as a new
+// DMatrix; all inputs are staged in one scratch heap block
+function buildDMatrix(wasm, X, y, featureFields, binary, hashBits = 0) {
+  if (isHashed(X)) {
+    if (!hashBits) throw new Error('hashed input needs the hashBits parameter')
+    return buildHashedDMatrix(wasm, X, y, hashBits, binary)
+  }
+  if (hashBits) {
+    throw new Error('hashBits is set: input must be hashed ({ rows, indptr, fields, hashes })')
+  }
+  return isCSR(X)
+    ? buildCSRDMatrix(wasm, X, y, featureFields, binary)
+    : buildDenseDMatrix(wasm, X, y, featureFields, binary)
+}
+
+function buildHashedDMatrix(wasm, X, y, hashBits, binary) {
+  const { rows, indptr, fields, hashes, values } = X
+  const nnz = hashes.length
+  if (fields.length !== nnz || (values && values.length !== nnz)) {
+    throw new Error('hashed input: fields, hashes and values must have the same length')
+  }
+
+  // Stage fields, hashes, values, indptr and labels in one heap block
+  const nValue = values ? nnz : 0
+  const nLabel = y ? y.length : 0
+  const block = scratch(wasm, (nnz * 2 + nValue + indptr.length + nLabel) * 4)
+  const fieldPtr = block
+  const hashPtr = fieldPtr + nnz * 4
+  const valPtr = nValue ? hashPtr + nnz * 4 : 0
+  const indptrPtr = hashPtr + (nnz + nValue) * 4
+  const yPtr = nLabel ? indptrPtr + indptr.length * 4 : 0
+
+  wasm.HEAP32.set(fields, fieldPtr >> 2)
+  // Unsigned hashes wrap to the same 32 bits
+  wasm.HEAP32.set(hashes, hashPtr >> 2)
+  if (valPtr) wasm.HEAPF32.set(values, valPtr >> 2)
+  wasm.HEAP32.set(indptr, indptrPtr >> 2)
+  if (yPtr) writeLabels(wasm, y, yPtr, binary)
+
+  const outPtr = scratch(wasm, 4)
+  const ret = wasm._wl_xl_create_dmatrix_hashed(
+    fieldPtr, hashPtr, valPtr, nnz,
+    indptrPtr, rows, hashBits,
+    yPtr, outPtr
+  )
+
+  if (ret !== 0) {
+    throw new Error(`Hashed DMatrix creation failed: ${getLastError()}`)
+  }
+
+  const dmatrix = wasm.getValue(outPtr, 'i32')
+
+  return { dmatrix, rows, cols: 2 ** hashBits }
+}
+
+function buildDenseDMatrix(wasm, X, y, featureFields, binary) {
+  const { data: xData, rows, cols } = denseInput(X)
+
+  // Stage data, labels and field map in one heap block
+  const nLabel = y ? y.length : 0
+  const nField = featureFields ? featureFields.length : 0
+  const block = scratch(wasm, (xData.length + nLabel + nField) * 4)
+  const xPtr = block
+  const yPtr = nLabel ? xPtr + xData.length * 4 : 0
+  const fieldPtr = nField ? xPtr + (xData.length + nLabel) * 4 : 0
+
+  // xLearn uses float32 internally; set() converts in one pass
+  wasm.HEAPF32.set(xData, xPtr >> 2)
+  if (yPtr) writeLabels(wasm, y, yPtr, binary)
+  if (fieldPtr) wasm.HEAP32.set(featureFields, fieldPtr >> 2)
+
+  const outPtr = scratch(wasm, 4)
+  const ret = wasm._wl_xl_create_dmatrix_dense(
+    xPtr, rows, cols, yPtr, fieldPtr, outPtr
+  )
+
+  if (ret !== 0) {
+    throw new Error(`DMatrix creation failed: ${getLastError()}`)
+  }
+
+  const dmatrix = wasm.getValue(outPtr, 'i32')
+
+  return { dmatrix, rows, cols }
+}
+
+function buildCSRDMatrix(wasm, X, y, featureFields, binary) {
+  const { rows, cols, data, indices, indptr } = X
+
+  // Stage values, indices, indptr, labels and field map in one heap block
+  const nnz = data.length
+  const nLabel = y ? y.length : 0
+  const nField = featureFields ? featureFields.length : 0
+  const block = scratch(wasm, (nnz * 2 + indptr.length + nLabel + nField) * 4)
+  const valPtr = block
+  const idxPtr = valPtr + nnz * 4
+  const indptrPtr = idxPtr + nnz * 4
+  const yPtr = nLabel ? indptrPtr + indptr.length * 4 : 0
+  const fieldPtr = nField ? indptrPtr + (indptr.length + nLabel) * 4 : 0
+
+  wasm.HEAPF32.set(data, valPtr >> 2)
+  wasm.HEAP32.set(indices, idxPtr >> 2)
+  wasm.HEAP32.set(indptr, indptrPtr >> 2)
+  if (yPtr) writeLabels(wasm, y, yPtr, binary)
+  if (fieldPtr) wasm.HEAP32.set(featureFields, fieldPtr >> 2)
+
+  const outPtr = scratch(wasm, 4)
+  const ret = wasm._wl_xl_create_dmatrix_csr(
+    valPtr, nnz,
+    idxPtr, indptrPtr, rows, cols,
+    yPtr, fieldPtr, outPtr
+  )
+
+  if (ret !== 0) {
+    throw new Error(`CSR DMatrix creation failed: ${getLastError()}`)
+  }
+
+  const dmatrix = wasm.getValue(outPtr, 'i32')
+
+  return { dmatrix, rows, cols }
+}
+
+// Labels: remap {0,1} -> {-1,+1} for binary classification
+function writeLabels(wasm, y, ptr, binary) {
+  const view = wasm.HEAPF32.subarray(ptr >> 2, (ptr >> 2) + y.length)
+  if (binary) {
+    for (let i = 0; i < y.length; i++) view[i] = y[i] > 0 ? 1 : -1
+  } else {
+    view.set(y)
+  }
+}
+
+// Attach per-row sample weights to a labeled DMatrix (throws on error;
+// the caller frees dmatrix)
+function setSampleWeights(wasm, dmatrix, sampleWeight, rows) {
+  if (sampleWeight == null) return
+  if (sampleWeight.length !== rows) {
+    throw new Error(`sampleWeight length (${sampleWeight.length}) does not match X rows (${rows})`)
+  }
+  withScratch(wasm, () => {
+    const ptr = scratch(wasm, rows * 4)
+    wasm.HEAPF32.set(sampleWeight, ptr >> 2)
+    if (wasm._wl_xl_dmatrix_set_weights(dmatrix, ptr, rows) !== 0) {
+      throw new Error(`sampleWeight: ${getLastError()}`)
+    }
+  })
+}
+
+// Serialized copy of a built DMatrix (wl_xl_save_dmatrix)
+function dumpDMatrix(wasm, dmatrix) {
+  return withScratch(wasm, () => {
+    const outPtr = scratch(wasm, 8)
+    const ret = wasm._wl_xl_save_dmatrix(dmatrix, outPtr, outPtr + 4)
+    if (ret !== 0) throw new Error(`XLearnDataset save failed: ${getLastError()}`)
+    const bufPtr = wasm.getValue(outPtr, 'i32')
+    const len = wasm.getValue(outPtr + 4, 'i32')
+    const bytes = wasm.HEAPU8.slice(bufPtr, bufPtr + len)
+    wasm._wl_xl_free_buffer(bufPtr)
+    return bytes
+  })
+}
+
+// DMatrix rebuilt from a dumpDMatrix() blob with one copy into the heap
+function restoreDMatrix(wasm, blob) {
+  return withScratch(wasm, () => {
+    const ptr = scratch(wasm, blob.length)
+    wasm.HEAPU8.set(blob, ptr)
+    const outPtr = scratch(wasm, 4)
+    const ret = wasm._wl_xl_load_dmatrix(ptr, blob.length, outPtr)
+    if (ret !== 0) throw new Error(`XLearnDataset load failed: ${getLastError()}`)
+    return wasm.getValue(outPtr, 'i32')
+  })
+}
+
+// --- XLearnDataset ---
+
+// Training data converted to a DMatrix once and shared by every model
+// trained on it with fitDataset(). The DMatrix is reference counted on
+// the C side: the dataset holds one reference and each training run
+// takes another, so dispose() may be called while models still train.
+// task is 'binary' (labels 0/1, stored as -1/+1) or 'reg'; by default
+// it is 'binary' when every label is 0 or 1.
+class XLearnDataset {
+  #dmatrix = 0
+  #valid = 0
+  #ref = null
+  #task = ''
+  #rows = 0
+  #cols = 0
+  #classes = null
+  #featureFields = null
+  #hashBits = 0
+
+  constructor(sentinel) {
+    if (sentinel !== LOAD_SENTINEL) {
+      throw new Error('use XLearnDataset.create()')
+    }
+  }
+
+  // opts: { task, featureFields, hashBits, sampleWeight, validation: [Xv, yv] }
+  static async create(X, y, opts = {}) {
+    await loadXLearn()
+    const wasm = getWasm()
+    const ds = new XLearnDataset(LOAD_SENTINEL)
+    const yArr = labelArray(y)
+
+    let task = opts.task
+    if (task === undefined) {
+      task = yArr.every(v => v === 0 || v === 1) ? 'binary' : 'reg'
+    } else if (task !== 'binary' && task !== 'reg') {
+      throw new Error(`XLearnDataset: unknown task '${task}' (expected 'binary' or 'reg')`)
+    }
+    const binary = task === 'binary'
+    const featureFields = opts.featureFields || null
+    const hashBits = opts.hashBits || 0
+
+    withScratch(wasm, () => {
+      const { dmatrix, rows, cols } = buildDMatrix(wasm, X, yArr, featureFields, binary, hashBits)
+      ds.#dmatrix = dmatrix
+      ds.#ref = [dmatrix, 0]
+      if (yArr.length !== rows) {
+        ds.dispose()
+        throw new Error(`y length (${yArr.length}) does not match X rows (${rows})`)
+      }
+      try {
+        setSampleWeights(wasm, dmatrix, opts.sampleWeight, rows)
+      } catch (e) {
+        ds.dispose()
+        throw e
+      }
+      ds.#rows = rows
+      ds.#cols = cols
+
+      if (opts.validation) {
+        const [Xv, yv] = opts.validation
+        const yvArr = labelArray(yv)
+        let valid
+        try {
+          valid = buildDMatrix(wasm, Xv, yvArr, featureFields, binary, hashBits)
+        } catch (e) {
+          ds.dispose()
+          throw e
+        }
+        ds.#valid = valid.dmatrix
+        ds.#ref[1] = valid.dmatrix
+        if (yvArr.length !== valid.rows || valid.rows === 0) {
+          ds.dispose()
+          throw new Error(`validation y length (${yvArr.length}) does not match X rows (${valid.rows})`)
+        }
+      }
+    })
+
+    ds.#task = task
+    ds.#hashBits = hashBits
+    ds.#featureFields = featureFields ? Int32Array.from(featureFields) : null
+    if (binary) {
+      ds.#classes = new Int32Array([...new Set(yArr)].sort((a, b) => a - b))
+    }
+    ds.#track()
+    return ds
+  }
+
+  // Reload a save() file: each DMatrix is copied into the heap in one
+  // piece and its rows assigned from it, with no per-element rebuild
+  static async load(bytes) {
+    await loadXLearn()
+    const wasm = getWasm()
+    const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength)
+    if (bytes.length < DATASET_PREFIX || view.getUint32(0, true) !== DATASET_MAGIC) {
+      throw new Error('XLearnDataset.load: not a saved dataset')
+    }
+    const manifestLen = view.getUint32(4, true)
+    const trainLen = view.getUint32(8, true)
+    const validLen = view.getUint32(12, true)
+    if (DATASET_PREFIX + manifestLen + trainLen + validLen !== bytes.length) {
+      throw new Error('XLearnDataset.load: truncated dataset')
+    }
+    let off = DATASET_PREFIX
+    const manifest = JSON.parse(new TextDecoder().decode(bytes.subarray(off, off + manifestLen)))
+    off += manifestLen
+
+    const ds = new XLearnDataset(LOAD_SENTINEL)
+    ds.#dmatrix = restoreDMatrix(wasm, bytes.subarray(off, off + trainLen))
+    ds.#ref = [ds.#dmatrix, 0]
+    off += trainLen
+    if (validLen) {
+      try {
+        ds.#valid = restoreDMatrix(wasm, bytes.subarray(off, off + validLen))
+      } catch (e) {
+        ds.dispose()
+        throw e
+      }
+      ds.#ref[1] = ds.#valid
+    }
+
+    ds.#task = manifest.task
+    ds.#rows = manifest.rows
+    ds.#cols = manifest.cols
+    ds.#hashBits = manifest.hashBits || 0
+    ds.#classes = manifest.classes ? new Int32Array(manifest.classes) : null
+    ds.#featureFields = manifest.featureFields ? new Int32Array(manifest.featureFields) : null
+    ds.#track()
+    return ds
+  }
+
+  // Binary cache of the built dataset for XLearnDataset.load(): the
+  // training and validation DMatrix as they sit in the heap (nodes,
+  // labels, norms, field ids) plus task, shape and field map
+  save() {
+    if (!this.#dmatrix) throw new DisposedError('XLearnDataset has been disposed.')
+    const wasm = getWasm()
+    const train = dumpDMatrix(wasm, this.#dmatrix)
+    const valid = this.#valid ? dumpDMatrix(wasm, this.#valid) : new Uint8Array(0)
+    const manifest = new TextEncoder().encode(JSON.stringify({
+      task: this.#task,
+      rows: this.#rows,
+      cols: this.#cols,
+      hashBits: this.#hashBits,
+      classes: this.#classes ? Array.from(this.#classes) : null,
+      featureFields: this.#featureFields ? Array.from(this.#featureFields) : null
+    }))
+
+    const out = new Uint8Array(DATASET_PREFIX + manifest.length + train.length + valid.length)
+    const view = new DataView(out.buffer)
+    view.setUint32(0, DATASET_MAGIC, true)
+    view.setUint32(4, manifest.length, true)
+    view.setUint32(8, train.length, true)
+    view.setUint32(12, valid.length, true)
+    out.set(manifest, DATASET_PREFIX)
+    out.set(train, DATASET_PREFIX + manifest.length)
+    out.set(valid, DATASET_PREFIX + manifest.length + train.length)
+    return out
+  }
+
+  // FinalizationRegistry safety net for the held DMatrix references
+  #track() {
+    if (!leakRegistry) return
+    const ref = this.#ref
+    leakRegistry.register(this, {
+      ref,
+      what: 'Dataset',
+      freeFn: (dm) => {
+        try {
+          const w = getWasm()
+          w._wl_xl_free_dmatrix(dm)
+          if (ref[1]) w._wl_xl_free_dmatrix(ref[1])
+        } catch {}
+      }
+    }, this)
+  }
+
+  get task() { return this.#task }
+  get rows() { return this.#rows }
+  get cols() { return this.#cols }
+  get classes() { return this.#classes }
+  get featureFields() { return this.#featureFields }
+  get hashBits() { return this.#hashBits }
+  get hasValidation() { return this.#valid !== 0 }
+  get disposed() { return this.#dmatrix === 0 }
+
+  // Bytes the dataset holds in the WASM heap ({ heapBytes }, with its
+  // validation DMatrix)
+  memoryUsage() {
+    if (!this.#dmatrix) throw new DisposedError('XLearnDataset has been disposed.')
+    const wasm = getWasm()
+    return { heapBytes: wasm._wl_xl_dmatrix_bytes(this.#dmatrix) + wasm._wl_xl_dmatrix_bytes(this.#valid) }
+  }
+
+  // New reference to the training DMatrix, released by its consumer
+  _retain() {
+    if (!this.#dmatrix) throw new DisposedError('XLearnDataset has been disposed.')
+    getWasm()._wl_xl_dmatrix_retain(this.#dmatrix)
+    return this.#dmatrix
+  }
+
+  // Same for the validation DMatrix (0 if the dataset has none)
+  _retainValidation() {
+    if (!this.#valid) return 0
+    getWasm()._wl_xl_dmatrix_retain(this.#valid)
+    return this.#valid
+  }
+
+  dispose() {
+    if (!this.#dmatrix) return
+    const wasm = getWasm()
+    wasm._wl_xl_free_dmatrix(this.#dmatrix)
+    if (this.#valid) wasm._wl_xl_free_dmatrix(this.#valid)
+    this.#dmatrix = 0
+    this.#valid = 0
+    this.#ref[0] = 0
+    this.#ref[1] = 0
+    if (leakRegistry) leakRegistry.unregister(this)
+  }
+}
+
+// --- XLearnBatch ---
+
+// Reusable unlabeled DMatrix for the serving path: set() refills it in
+// place, keeping its row and node capacity, and predict(), predictInto(),
+// predictView() and predictMany() accept it wherever they accept X. With
+// a prepared model, steady-state prediction on a batch allocates nothing
+// in the WASM heap.
+class XLearnBatch {
+  #dmatrix = 0
+  #ref = null
+  #rows = 0
+  #cols = 0
+  #featureFields = null
+
+  constructor(sentinel) {
+    if (sentinel !== LOAD_SENTINEL) {
+      throw new Error('use XLearnBatch.create()')
+    }
+  }
+
+  // X: optional first contents; opts: { featureFields } (FFM field map)
+  static async create(X = null, opts = {}) {
+    await loadXLearn()
+    const wasm = getWasm()
+    const batch = new XLearnBatch(LOAD_SENTINEL)
+    const dmatrix = withScratch(wasm, () => {
+      const outPtr = scratch(wasm, 4)
+      if (wasm._wl_xl_batch_create(outPtr) !== 0) {
+        throw new Error(`Batch creation failed: ${getLastError()}`)
+      }
+      return wasm.getValue(outPtr, 'i32')
+    })
+
+    batch.#dmatrix = dmatrix
+    batch.#ref = [dmatrix]
+    batch.#featureFields = opts.featureFields ? Int32Array.from(opts.featureFields) : null
+    if (leakRegistry) {
+      leakRegistry.register(batch, {
+        ref: batch.#ref,
+        what: 'Batch',
+        freeFn: (dm) => { try { getWasm()._wl_xl_free_dmatrix(dm) } catch {} }
+      }, batch)
+    }
+    if (X) batch.set(X)
+    return batch
+  }
+
+  // Replace the batch's rows with X (dense or CSR)
+  set(X) {
+    if (!this.#dmatrix) throw new DisposedError('XLearnBatch has been disposed.')
+    if (isHashed(X)) throw new Error('XLearnBatch: hashed input is not supported')
+    const wasm = getWasm()
+    withScratch(wasm, () => {
+      const featureFields = this.#featureFields
+      const nField = featureFields ? featureFields.length : 0
+      let ret, rows, cols
+      if (isCSR(X)) {
+        const { data, indices, indptr } = X
+        rows = X.rows
+        cols = X.cols
+        const nnz = data.length
+        const block = scratch(wasm, (nnz * 2 + indptr.length + nField) * 4)
+        const idxPtr = block + nnz * 4
+        const indptrPtr = idxPtr + nnz * 4
+        const fieldPtr = nField ? indptrPtr + indptr.length * 4 : 0
+        wasm.HEAPF32.set(data, block >> 2)
+        wasm.HEAP32.set(indices, idxPtr >> 2)
+        wasm.HEAP32.set(indptr, indptrPtr >> 2)
+        if (fieldPtr) wasm.HEAP32.set(featureFields, fieldPtr >> 2)
+        ret = wasm._wl_xl_batch_fill_csr(
+          this.#dmatrix, block, nnz, idxPtr, indptrPtr, rows, cols, fieldPtr
+        )
+      } else {
+        const { data: xData, rows: r, cols: c } = denseInput(X)
+        rows = r
+        cols = c
+        const block = scratch(wasm, (xData.length + nField) * 4)
+        const fieldPtr = nField ? block + xData.length * 4 : 0
+        wasm.HEAPF32.set(xData, block >> 2)
+        if (fieldPtr) wasm.HEAP32.set(featureFields, fieldPtr >> 2)
+        ret = wasm._wl_xl_batch_fill_dense(this.#dmatrix, block, rows, cols, fieldPtr)
+      }
+      if (ret !== 0) throw new Error(`Batch fill failed: ${getLastError()}`)
+      this.#rows = rows
+      this.#cols = cols
+    })
+    return this
+  }
+
+  get rows() { return this.#rows }
+  get cols() { return this.#cols }
+  get featureFields() { return this.#featureFields }
+  get disposed() { return this.#dmatrix === 0 }
+
+  // Rows and nodes the batch holds without allocating
+  get capacity() {
+    if (!this.#dmatrix) return { rows: 0, nodes: 0 }
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      const ptr = scratch(wasm, 8)
+      wasm._wl_xl_batch_capacity(this.#dmatrix, ptr, ptr + 4)
+      return { rows: wasm.getValue(ptr, 'i32'), nodes: wasm.getValue(ptr + 4, 'i32') }
+    })
+  }
+
+  // Bytes the batch holds in the WASM heap ({ heapBytes })
+  memoryUsage() {
+    if (!this.#dmatrix) throw new DisposedError('XLearnBatch has been disposed.')
+    return { heapBytes: getWasm()._wl_xl_dmatrix_bytes(this.#dmatrix) }
+  }
+
+  // Reference for one scoring call, released by its consumer
+  _retain() {
+    if (!this.#dmatrix) throw new DisposedError('XLearnBatch has been disposed.')
+    if (!this.#rows) throw new Error('XLearnBatch is empty: call set(X) first')
+    getWasm()._wl_xl_dmatrix_retain(this.#dmatrix)
+    return this.#dmatrix
+  }
+
+  dispose() {
+    if (!this.#dmatrix) return
+    getWasm()._wl_xl_free_dmatrix(this.#dmatrix)
+    this.#dmatrix = 0
+    this.#ref[0] = 0
+    if (leakRegistry) leakRegistry.unregister(this)
   }
-  const e = Math.exp(x)
-  return e / (1 + e)
 }
 
 // --- XLearnBase ---
@@ -67,6 +796,25 @@ class XLearnBase {
   #featureFields = null
   #fitted = false
   #freed = false
+  #outPtr = 0
+  #outCap = 0
+  #quantized = null
+  #pager = null
+  #bestEpoch = null
+  #jsStats = null
+  #generation = 0
+  #engine = null
+  #engineKey = 0
+  #memKey = 0
+
+  // Heap accounting shared by every model of the module: prepared
+  // models by memKey, least recently used first, with their bytes
+  static #budget = 0
+  static #lru = new Map() // memKey -> { ref, bytes }
+  static #residentBytes = 0
+  static #hold = 0
+  static #evictions = 0
+  static #restores = 0
 
   constructor(sentinel, algo, task, params) {
     if (sentinel === LOAD_SENTINEL) {
@@ -91,490 +839,1466 @@ class XLearnBase {
 
   // --- Estimator interface ---
 
-  fit(X, y) {
+  // opts.validation: [Xv, yv] scored after every epoch. With it, params
+  // earlyStop (default true) and stopWindow (default 2) stop training once
+  // validation loss has not improved for stopWindow epochs and keep the
+  // best epoch's weights. opts.onEpoch({ epoch, trainLoss, validLoss,
+  // validMetric }) is called after each epoch and may return false to
+  // stop. Either option trains epoch by epoch in the adapter's loop (the
+  // partialFit step) instead of upstream's trainer, as do
+  // opts.sampleWeight (one weight per row, scaling its gradient) and
+  // the negSampleRate param. That loop visits rows in order, without
+  // shuffling, on one thread even in the multi-threaded build, so it
+  // trains a different model than upstream's trainer. Weights that are
+  // all 1 keep upstream's trainer.
+  fit(X, y, opts = {}) {
+    this.#ensureNotDisposed()
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      this.#resetModel(wasm)
+
+      // Normalize labels
+      const yArr = labelArray(y)
+
+      // Build DMatrix (CSR or dense)
+      const { dmatrix, rows, cols } = this.#buildDMatrix(wasm, X, yArr)
+
+      try {
+        if (yArr.length !== rows) {
+          throw new Error(`y length (${yArr.length}) does not match X rows (${rows})`)
+        }
+        setSampleWeights(wasm, dmatrix, opts.sampleWeight, rows)
+      } catch (e) {
+        wasm._wl_xl_free_dmatrix(dmatrix)
+        throw e
+      }
+
+      const classSet = new Set()
+      if (this.#task === 'binary') {
+        for (let i = 0; i < yArr.length; i++) classSet.add(yArr[i])
+      }
+
+      if (opts.validation || opts.onEpoch) {
+        let dvalid = 0
+        try {
+          if (opts.validation) dvalid = this.#buildValidation(wasm, opts.validation)
+        } catch (e) {
+          wasm._wl_xl_free_dmatrix(dmatrix)
+          throw e
+        }
+        return this.#trainEpochs(wasm, dmatrix, dvalid, cols, classSet, opts)
+      }
+      return this.#trainOn(wasm, dmatrix, cols, classSet)
+    })
+  }
+
+  // Train on an XLearnDataset (same options as fit(), except that sample
+  // weights belong to the dataset: XLearnDataset.create({ sampleWeight });
+  // a dataset built with validation uses it unless opts.validation is
+  // given). The
+  // dataset's DMatrix is shared, not copied: each fitDataset() call only
+  // takes a reference for the duration of training, so one dataset can
+  // feed any number of models, e.g. a hyperparameter search.
+  fitDataset(dataset, opts = {}) {
+    this.#ensureNotDisposed()
+    this.#checkDataset('fitDataset', dataset, opts)
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      this.#resetModel(wasm)
+      if (dataset.featureFields) this.#featureFields = dataset.featureFields
+      const classSet = new Set(dataset.classes || [])
+
+      const dmatrix = dataset._retain()
+      let dvalid = 0
+      try {
+        dvalid = opts.validation
+          ? this.#buildValidation(wasm, opts.validation)
+          : dataset._retainValidation()
+      } catch (e) {
+        wasm._wl_xl_free_dmatrix(dmatrix)
+        throw e
+      }
+      if (dvalid || opts.onEpoch) {
+        return this.#trainEpochs(wasm, dmatrix, dvalid, dataset.cols, classSet, opts)
+      }
+      return this.#trainOn(wasm, dmatrix, dataset.cols, classSet)
+    })
+  }
+
+  // fitDataset() on an XLearnEngine worker, with opts as for fitAsync().
+  // The dataset's save() bytes are shipped once to each worker it is used
+  // on, which keeps the loaded copy for later trials until
+  // engine.releaseDataset(dataset). A search spread over an engine's
+  // workers thus converts X once and copies it once per worker.
+  async fitDatasetAsync(dataset, opts = {}) {
+    this.#ensureNotDisposed()
+    this.#checkDataset('fitDatasetAsync', dataset, opts)
+    const { engine = XLearnEngine.default(), ...fitOpts } = opts
+    if (fitOpts.onEpoch) {
+      throw new Error('fitDatasetAsync: onEpoch runs on the calling thread; use fitDataset()')
+    }
+    const key = this.#bindEngine(engine)
+    const result = await engine._fitDataset(
+      key, this._typeId, this.getParams(), dataset, fitOpts)
+    if (dataset.featureFields) this.#featureFields = dataset.featureFields
+    return this.#adoptRemote(engine, key, result)
+  }
+
+  // Whether dataset can train this model through fn
+  #checkDataset(fn, dataset, opts) {
+    if (!(dataset instanceof XLearnDataset)) {
+      throw new Error(`${fn}: expected an XLearnDataset`)
+    }
+    if (opts.sampleWeight != null) {
+      throw new Error(`${fn}: sampleWeight is set on the dataset, with XLearnDataset.create(X, y, { sampleWeight })`)
+    }
+    if (dataset.task !== this.#task) {
+      throw new Error(`${fn}: dataset task '${dataset.task}' does not match model task '${this.#task}'`)
+    }
+    if (dataset.hashBits !== (this.#params.hashBits || 0)) {
+      throw new Error(`${fn}: dataset hashBits (${dataset.hashBits}) does not match model hashBits (${this.#params.hashBits || 0})`)
+    }
+  }
+
+  // Train from an (async) iterable of { X, y } row chunks, dense or CSR,
+  // all with the same column count. Each chunk is copied into the
+  // DMatrix and released before the next one is pulled, so the full
+  // dataset never has to exist in JS memory or be staged in one block.
+  async fitStream(chunks) {
+    this.#ensureNotDisposed()
+    const wasm = getWasm()
+    this.#resetModel(wasm)
+
+    const classSet = new Set()
+    let builder = 0
+    let cols = 0
+    let dmatrix
+    try {
+      for await (const chunk of chunks) {
+        const { X, y } = chunk
+        if (isHashed(X) || this.#params.hashBits) {
+          throw new Error('fitStream: hashed input is not supported, use fit()')
+        }
+        if (chunk.sampleWeight != null) {
+          throw new Error('fitStream: sampleWeight is not supported, use fit()')
+        }
+        const yArr = labelArray(y)
+
+        // Scratch scopes must not span an await
+        const rows = withScratch(wasm, () => {
+          if (!builder) {
+            cols = isCSR(X) ? X.cols : denseInput(X).cols
+            builder = this.#beginDMatrix(wasm, cols)
+          }
+          return isCSR(X)
+            ? this.#appendCSRChunk(wasm, builder, X, yArr, cols)
+            : this.#appendDenseChunk(wasm, builder, X, yArr, cols)
+        })
+
+        if (this.#task === 'binary') {
+          for (let i = 0; i < yArr.length; i++) classSet.add(yArr[i])
+        }
+        if (yArr.length !== rows) {
+          throw new Error(`y length (${yArr.length}) does not match X rows (${rows})`)
+        }
+      }
+      if (!builder) throw new Error('fitStream: no chunks')
+
+      withScratch(wasm, () => {
+        const outPtr = scratch(wasm, 4)
+        const ret = wasm._wl_xl_dmatrix_finish(builder, outPtr)
+        dmatrix = wasm.getValue(outPtr, 'i32')
+        if (ret !== 0) throw new Error(`DMatrix finish failed: ${getLastError()}`)
+      })
+      builder = 0
+    } catch (e) {
+      if (builder) wasm._wl_xl_dmatrix_abort(builder)
+      throw e
+    }
+
+    return withScratch(wasm, () => this.#trainOn(wasm, dmatrix, cols, classSet))
+  }
+
+  // Out-of-core training from a libsvm/libffm/csv file (or an upstream
+  // .bin cache with onDisk: false). With onDisk (default) upstream's
+  // Reader streams the file in blockSize MB blocks every epoch, so the
+  // dataset is never resident in the heap. Binary labels are 0/1.
+  fitFile(source, opts = {}) {
     this.#ensureNotDisposed()
     const wasm = getWasm()
+    return withScratch(wasm, () => {
+      this.#resetModel(wasm)
+      const { validation, onDisk = true, blockSize = 0 } = opts
+
+      const train = mountSource(wasm, source)
+      let valid = null
+      try {
+        if (validation !== undefined) valid = mountSource(wasm, validation)
+        const handle = this.#createHandle(wasm)
+        const ret = withCString(wasm, train.path, (tPtr) => {
+          const run = (vPtr) => wasm._wl_xl_fit_file(handle, tPtr, vPtr, onDisk ? 1 : 0, blockSize)
+          return valid ? withCString(wasm, valid.path, run) : run(0)
+        })
+        if (ret !== 0) {
+          wasm._wl_xl_free_handle(handle)
+          throw new Error(`fitFile failed: ${getLastError()}`)
+        }
+
+        this.#adoptHandle(handle)
+      } finally {
+        train.unmount()
+        if (valid) valid.unmount()
+      }
+
+      // Width and classes come from the model, not from JS-side data
+      const shapePtr = scratch(wasm, 4)
+      wasm._wl_xl_model_shape(this.#handle, shapePtr, 0, 0)
+      this.#nFeatures = wasm.getValue(shapePtr, 'i32')
+      if (this.#task === 'binary') {
+        this.#nClasses = 2
+        this.#classes = new Int32Array([0, 1])
+      }
+      return this
+    })
+  }
+
+  // Continue training the resident model on a new batch. Weights and
+  // optimizer state (adagrad sums, ftrl n/z) carry over; only X is
+  // visited, for opts.epoch passes (default 1). Features beyond the
+  // width of the first fit are ignored. opts.sampleWeight as for fit().
+  // Unfitted models do a full fit().
+  partialFit(X, y, opts = {}) {
+    this.#ensureNotDisposed()
+    if (!this.#fitted) return this.fit(X, y, { sampleWeight: opts.sampleWeight })
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      this.#prepare()
+      const yArr = labelArray(y)
+
+      const { dmatrix, rows } = this.#buildDMatrix(wasm, X, yArr)
+
+      try {
+        if (yArr.length !== rows) {
+          throw new Error(`y length (${yArr.length}) does not match X rows (${rows})`)
+        }
+        setSampleWeights(wasm, dmatrix, opts.sampleWeight, rows)
+        this.#applySampling(wasm, this.#handle, false)
+      } catch (e) {
+        wasm._wl_xl_free_dmatrix(dmatrix)
+        throw e
+      }
+
+      this.#applyParams(wasm, this.#handle)
+      const epochs = opts.epoch !== undefined ? opts.epoch : 1
+      const ret = wasm._wl_xl_partial_fit(this.#handle, dmatrix, epochs)
+
+      wasm._wl_xl_free_dmatrix(dmatrix)
+
+      if (ret !== 0) {
+        throw new Error(`partialFit failed: ${getLastError()}`)
+      }
+
+      // Resident weights changed; save() must re-serialize
+      this.#modelBytes = null
+      this.#generation++
+      return this
+    })
+  }
+
+  // fit() on an XLearnEngine worker (opts.engine, default
+  // XLearnEngine.default()), off the calling thread. X, y and
+  // opts.validation are packed into typed arrays that are transferred,
+  // not cloned; opts.transfer: true hands over X and y's own typed
+  // arrays where possible (they are detached afterwards). The trained
+  // model is then installed here from its bytes, and the worker keeps
+  // its copy for predictAsync(). onEpoch cannot cross to the worker.
+  async fitAsync(X, y, opts = {}) {
+    this.#ensureNotDisposed()
+    const { engine = XLearnEngine.default(), ...fitOpts } = opts
+    if (fitOpts.onEpoch) {
+      throw new Error('fitAsync: onEpoch runs on the calling thread; use fit()')
+    }
+    const key = this.#bindEngine(engine)
+    const result = await engine._fit(
+      key, this._typeId, this.getParams(), X, y, fitOpts)
+    return this.#adoptRemote(engine, key, result)
+  }
+
+  // Install the model a worker trained for key from its bytes
+  #adoptRemote(engine, key, { bytes, bestEpoch }) {
+    this.#ensureNotDisposed()
+    const { manifest, toc, blobs } = decodeBundle(bytes)
+    this.#resetModel(getWasm())
+    this.#installBundle(toc, blobs, manifest.metadata || {})
+    this.#bestEpoch = bestEpoch
+    engine._sync(key, this.#generation)
+    return this
+  }
+
+  // predict() on the engine worker holding this model. The model's
+  // bytes are sent to it once per change (fit, partialFit, load);
+  // concurrent calls queue and are scored as one batch in the worker.
+  // opts.engine and opts.transfer as for fitAsync().
+  async predictAsync(X, opts = {}) {
+    this.#ensureFitted()
+    const { engine = XLearnEngine.default(), transfer = false } = opts
+    const key = this.#bindEngine(engine)
+    return engine._predict(key, this.#generation, () => this.save(), X, { transfer })
+  }
+
+  predict(X) {
+    this.#ensureFitted()
+    return this.#rawPredict(X)
+  }
+
+  // Raw scores written into out (Float32Array or Float64Array with at
+  // least one slot per row) with a single bulk copy. Returns out.
+  predictInto(X, out) {
+    this.#ensureFitted()
+    const { ptr, rows } = this.#predictToHeap(X)
+    if (!out || out.length < rows) {
+      throw new Error(`predictInto: output needs ${rows} elements`)
+    }
+    const t0 = this.#jsStats ? performance.now() : 0
+    out.set(getWasm().HEAPF32.subarray(ptr >> 2, (ptr >> 2) + rows))
+    if (this.#jsStats) addPhase(this.#jsStats.copyOut, t0, rows * 4, this.#jsStats)
+    return out
+  }
+
+  // Raw scores as a Float32Array view of the model's heap output region:
+  // no copy, but only valid until the next predict call on this model
+  // (or any heap growth, or the model's eviction under a heap budget).
+  predictView(X) {
+    this.#ensureFitted()
+    const { ptr, rows } = this.#predictToHeap(X)
+    return getWasm().HEAPF32.subarray(ptr >> 2, (ptr >> 2) + rows)
+  }
+
+  // Read the weight pages X touches into the heap ahead of predict().
+  // Needed for Blob sources, whose reads are asynchronous; path, fd and
+  // in-memory sources are also paged synchronously inside predict().
+  // No-op for models that are not paged.
+  async prefetch(X) {
+    this.#ensureFitted()
+    if (!this.#pager) return this
+    const wasm = getWasm()
+    const pages = withScratch(wasm, () => {
+      const { dmatrix } = this.#buildDMatrix(wasm, X, null)
+      try {
+        return this.#missingPages(wasm, dmatrix)
+      } finally {
+        wasm._wl_xl_free_dmatrix(dmatrix)
+      }
+    })
+
+    const { src, base } = this.#pager
+    for (const { page, offset, length } of pages) {
+      const bytes = await readAt(src, base + offset, length)
+      this.#ensureFitted()
+      const ptr = wasm._wl_xl_paged_page_in(this.#handle, page)
+      if (!ptr) throw new Error(`Page-in failed: ${getLastError()}`)
+      wasm.HEAPU8.set(bytes, ptr)
+    }
+    return this
+  }
+
+  predictProba(X) {
+    this.#ensureFitted()
+    if (this.#task !== 'binary') {
+      throw new Error('predictProba is only available for classifiers')
+    }
+
+    // The sigmoid runs in WASM on the scores just written; only the
+    // interleaved [1 - p, p] pairs are copied out
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      let probaPtr = 0
+      const { rows } = this.#predictToHeap(X, (dmatrix, n, outPtr, outCap) => {
+        probaPtr = scratch(wasm, n * 16)
+        return wasm._wl_xl_predict_proba(this.#handle, dmatrix, outPtr, outCap, probaPtr)
+      })
+      const t0 = this.#jsStats ? performance.now() : 0
+      const proba = wasm.HEAPF64.slice(probaPtr >> 3, (probaPtr >> 3) + rows * 2)
+      if (this.#jsStats) addPhase(this.#jsStats.copyOut, t0, rows * 16, this.#jsStats)
+      return proba
+    })
+  }
+
+  decisionFunction(X) {
+    this.#ensureFitted()
+    return this.#rawPredict(X)
+  }
+
+  // Accuracy for classifiers (margin > 0), R-squared for regressors
+  score(X, y) {
+    return this.evaluate(X, y)
+  }
+
+  // Metric of the model's scores on X against y, computed in WASM in
+  // the same call that scores X (only the number comes back):
+  // 'accuracy', 'logloss' or 'auc' for classifiers, 'rmse' or 'r2' for
+  // regressors
+  evaluate(X, y, metric = this.#task === 'binary' ? 'accuracy' : 'r2') {
+    this.#ensureFitted()
+    const m = Object.prototype.hasOwnProperty.call(METRICS, metric) ? METRICS[metric] : null
+    if (!m) {
+      throw new Error(`evaluate: unknown metric '${metric}' (${Object.keys(METRICS).join(', ')})`)
+    }
+    if (m.binary !== (this.#task === 'binary')) {
+      throw new Error(`evaluate: '${metric}' is a ${m.binary ? 'classification' : 'regression'} metric`)
+    }
+    const yArr = labelArray(y)
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      const valuePtr = scratch(wasm, 8)
+      this.#predictToHeap(X, (dmatrix, n, outPtr, outCap) => {
+        if (yArr.length !== n) {
+          throw new Error(`evaluate: ${yArr.length} labels for ${n} rows`)
+        }
+        const labelsPtr = scratch(wasm, n * 4)
+        this.#writeLabels(wasm, yArr, labelsPtr)
+        return wasm._wl_xl_evaluate(
+          this.#handle, dmatrix, labelsPtr, m.id, outPtr, outCap, valuePtr
+        )
+      })
+      return wasm.HEAPF64[valuePtr >> 3]
+    })
+  }
+
+  // Score X with several fitted models in one pass. X is converted to a
+  // DMatrix once (with the first model's FFM field map) and every row
+  // is scored by all models before moving on. Returns one Float64Array
+  // of raw scores per model, in order.
+  static predictMany(models, X) {
+    if (!Array.isArray(models) || models.length === 0) {
+      throw new Error('predictMany: models must be a non-empty array')
+    }
+    for (const m of models) {
+      if (!(m instanceof XLearnBase)) {
+        throw new TypeError('predictMany: expected xLearn model instances')
+      }
+      m.#ensureFitted()
+    }
+    const wasm = getWasm()
+    // All models stay prepared until the pass is done
+    XLearnBase.#hold++
+    try {
+      return withScratch(wasm, () => {
+        for (const m of models) m.#prepare()
+
+        const first = models[0]
+
+        const { dmatrix } = first.#buildDMatrix(wasm, X, null)
+
+        try {
+          for (const m of models) if (m.#pager) m.#pageIn(wasm, dmatrix)
+        } catch (e) {
+          wasm._wl_xl_free_dmatrix(dmatrix)
+          throw e
+        }
+
+        const nModels = models.length
+        const handlesPtr = scratch(wasm, nModels * 4 + 8)
+        const outPredsPtr = handlesPtr + nModels * 4
+        const outRowsPtr = outPredsPtr + 4
+        wasm.HEAP32.set(models.map(m => m.#handle), handlesPtr >> 2)
+
+        const ret = wasm._wl_xl_predict_many(
+          handlesPtr, nModels, dmatrix, outPredsPtr, outRowsPtr
+        )
+        wasm._wl_xl_free_dmatrix(dmatrix)
+
+        if (ret !== 0) {
+          throw new Error(`predictMany failed: ${getLastError()}`)
+        }
+
+        const predsPtr = wasm.getValue(outPredsPtr, 'i32')
+        const rows = wasm.getValue(outRowsPtr, 'i32')
+
+        const results = []
+        for (let m = 0; m < nModels; m++) {
+          const start = (predsPtr >> 2) + m * rows
+          results.push(new Float64Array(wasm.HEAPF32.subarray(start, start + rows)))
+        }
+        wasm._wl_xl_free_buffer(predsPtr)
+        return results
+      })
+    } finally {
+      XLearnBase.#hold--
+      XLearnBase.#enforceBudget(null)
+    }
+  }
+
+  // --- Model I/O ---
+
+  // opts.quantize: 'fp16' or 'int8' stores an inference-only copy of
+  // the weights (no optimizer state, per-block int8 scales) instead of
+  // the full model. Loaded quantized models re-save as they are.
+  save(opts = {}) {
+    this.#ensureFitted()
+    if (this.#pager) {
+      throw new Error('save: paged models are inference-only; keep the paged file')
+    }
+
+    const quantize = opts.quantize || this.#quantized
+    if (quantize && !QUANT_BITS[quantize]) {
+      throw new Error(`save: unknown quantize "${quantize}" (fp16, int8)`)
+    }
+    const artifacts = [
+      quantize
+        ? { id: 'model_quantized', data: this.#getQuantizedBytes(quantize) }
+        : { id: 'model', data: this.#getModelBytes() }
+    ]
+
+    // FFM field map
+    if (this.#algo === 'ffm' && this.#featureFields) {
+      const fieldBytes = new Uint8Array(this.#featureFields.buffer,
+        this.#featureFields.byteOffset, this.#featureFields.byteLength)
+      artifacts.push({ id: 'field_map', data: fieldBytes })
+    }
+
+    const metadata = this.#metadata()
+    if (quantize) metadata.quantized = quantize
+
+    return encodeBundle(
+      { typeId: this._typeId, params: this.getParams(), metadata },
+      artifacts
+    )
+  }
+
+  // Inference-only paged file for loadPaged(): a small header (manifest,
+  // field map, page table) followed by fp32 weight pages of
+  // opts.blockFeatures features each (default 4096), so a loader only
+  // reads the pages that the rows it scores touch.
+  savePaged(opts = {}) {
+    this.#ensureFitted()
+    if (this.#pager || this.#quantized) {
+      throw new Error('savePaged: needs a full-precision model')
+    }
+    const { blockFeatures = 4096 } = opts
+    const wasm = getWasm()
+    const blob = withScratch(wasm, () => {
+      this.#prepare()
+      const outPtr = scratch(wasm, 8)
+      const ret = wasm._wl_xl_save_paged(this.#handle, blockFeatures, outPtr, outPtr + 4)
+      if (ret !== 0) throw new Error(`savePaged failed: ${getLastError()}`)
+      const bufPtr = wasm.getValue(outPtr, 'i32')
+      const len = wasm.getValue(outPtr + 4, 'i32')
+      const bytes = wasm.HEAPU8.slice(bufPtr, bufPtr + len)
+      wasm._wl_xl_free_buffer(bufPtr)
+      return bytes
+    })
+
+    const { featureFields, ...params } = this.getParams()
+    const manifest = new TextEncoder().encode(JSON.stringify({
+      typeId: this._typeId, params, metadata: this.#metadata()
+    }))
+    const fields = this.#algo === 'ffm' && this.#featureFields
+      ? new Uint8Array(Int32Array.from(this.#featureFields).buffer)
+      : new Uint8Array(0)
+
+    const out = new Uint8Array(PAGED_PREFIX + manifest.length + fields.length + blob.length)
+    const view = new DataView(out.buffer)
+    view.setUint32(0, PAGED_MAGIC, true)
+    view.setUint32(4, manifest.length, true)
+    view.setUint32(8, fields.length, true)
+    out.set(manifest, PAGED_PREFIX)
+    out.set(fields, PAGED_PREFIX + manifest.length)
+    out.set(blob, PAGED_PREFIX + manifest.length + fields.length)
+    return out
+  }
+
+  static async _load(bytes, TypeClass) {
+    const { manifest, toc, blobs } = decodeBundle(bytes)
+    return TypeClass._fromBundle(manifest, toc, blobs)
+  }
+
+  static async _fromBundle(manifest, toc, blobs, TypeClass) {
+    await loadXLearn()
+    const meta = manifest.metadata || {}
+    const instance = new TypeClass(LOAD_SENTINEL, meta.algo, meta.task, manifest.params || {})
+    instance.#installBundle(toc, blobs, meta)
+    return instance
+  }
+
+  // Open a savePaged() file reading only its header; weight pages are
+  // read on demand and at most opts.maxResidentPages (default 64, 0 for
+  // no limit) stay in the heap. The source (path, fd, Uint8Array, Blob)
+  // is read until dispose().
+  static async _loadPaged(source, opts, TypeClass) {
+    await loadXLearn()
+    const { maxResidentPages = 64 } = opts || {}
+    const src = openPageSource(source)
+    try {
+      const prefix = await readAt(src, 0, PAGED_PREFIX)
+      const pv = new DataView(prefix.buffer)
+      if (pv.getUint32(0, true) !== PAGED_MAGIC) {
+        throw new Error('loadPaged: not a paged xLearn model')
+      }
+      const manifestLen = pv.getUint32(4, true)
+      const fieldLen = pv.getUint32(8, true)
+      const base = PAGED_PREFIX + manifestLen + fieldLen
+
+      // Manifest, field map and the blob's magic + header length, then
+      // the page table; no weights are read here
+      const head = await readAt(src, PAGED_PREFIX, manifestLen + fieldLen + 8)
+      const headerLen = new DataView(head.buffer).getUint32(manifestLen + fieldLen + 4, true)
+      const header = await readAt(src, base, headerLen)
+
+      const manifest = JSON.parse(new TextDecoder().decode(head.subarray(0, manifestLen)))
+      const meta = manifest.metadata || {}
+      const params = manifest.params || {}
+      const instance = new TypeClass(LOAD_SENTINEL, meta.algo, meta.task, params)
+      if (manifest.typeId !== instance._typeId) {
+        throw new Error(`loadPaged: file holds ${manifest.typeId}, not ${instance._typeId}`)
+      }
+      instance.#setMetadata(meta)
+      if (fieldLen) {
+        instance.#featureFields = new Int32Array(head.buffer.slice(manifestLen, manifestLen + fieldLen))
+        params.featureFields = instance.#featureFields
+      }
+
+      const wasm = getWasm()
+      const handle = withScratch(wasm, () => {
+        const headerPtr = scratch(wasm, header.length)
+        wasm.HEAPU8.set(header, headerPtr)
+        return instance.#loadHandle(wasm, meta, (h) =>
+          wasm._wl_xl_load_paged(h, headerPtr, header.length, maxResidentPages))
+      })
+
+      instance.#pager = { src, base }
+      instance.#adoptHandle(handle)
+      return instance
+    } catch (e) {
+      src.close()
+      throw e
+    }
+  }
+
+  dispose() {
+    if (this.#freed) return
+    this.#freed = true
 
-    // Dispose previous handle if refitting
     if (this.#handle) {
+      const wasm = getWasm()
       wasm._wl_xl_free_handle(this.#handle)
-      this.#handle = null
-      if (this.#handleRef) this.#handleRef[0] = null
-      if (leakRegistry) leakRegistry.unregister(this)
     }
+    this.#dropResident()
+    if (this.#outPtr) {
+      getWasm()._free(this.#outPtr)
+      this.#outPtr = 0
+      this.#outCap = 0
+    }
+
+    if (this.#handleRef) this.#handleRef[0] = null
+    if (leakRegistry) leakRegistry.unregister(this)
+
+    this.#closePager()
+    if (this.#engine) this.#engine._release(this.#engineKey)
+    this.#engine = null
+    this.#handle = null
     this.#modelBytes = null
+    this.#quantized = null
     this.#fitted = false
+  }
 
-    // Normalize labels
-    const yNorm = normalizeY(y)
-    const yF64 = yNorm instanceof Float64Array ? yNorm : new Float64Array(yNorm)
+  // --- Params ---
 
-    // Build DMatrix (CSR or dense)
-    let dmatrix, rows, cols
-    if (isCSR(X)) {
-      ({ dmatrix, rows, cols } = this.#buildCSRDMatrix(wasm, X, yF64))
-    } else {
-      ({ dmatrix, rows, cols } = this.#buildDenseDMatrix(wasm, X, yF64))
+  getParams() {
+    return { ...this.#params }
+  }
+
+  setParams(p) {
+    Object.assign(this.#params, p)
+    if (p.featureFields !== undefined) {
+      this.#featureFields = p.featureFields
+    }
+    if (p.layout !== undefined && this.#handle) {
+      const layout = p.layout === 'blocked' ? 1 : p.layout === 'interleaved' ? 0 : -1
+      if (getWasm()._wl_xl_set_layout(this.#handle, layout) !== 0) {
+        throw new Error(`Layout failed: ${getLastError()}`)
+      }
+    }
+    if (p.parallelNnz !== undefined && this.#handle) {
+      if (getWasm()._wl_xl_set_parallel_nnz(this.#handle, p.parallelNnz) !== 0) {
+        throw new Error(`parallelNnz failed: ${getLastError()}`)
+      }
     }
+    return this
+  }
 
-    if (yF64.length !== rows) {
-      wasm._wl_xl_free_dmatrix(dmatrix)
-      throw new Error(`y length (${yF64.length}) does not match X rows (${rows})`)
+  // --- Inspection ---
+
+  get isFitted() {
+    return this.#fitted && !this.#freed
+  }
+
+  get nFeatures() {
+    return this.#nFeatures
+  }
+
+  get nClasses() {
+    return this.#nClasses
+  }
+
+  get classes() {
+    return this.#classes ? new Int32Array(this.#classes) : null
+  }
+
+  // Epoch whose weights early stopping kept (null without early stopping)
+  get bestEpoch() {
+    return this.#bestEpoch
+  }
+
+  // Where time went since the last fit/load (or resetStats()), with
+  // params.stats: true; null otherwise. phases: convert (JS input ->
+  // DMatrix), fit, load (model parse), score, save (serialize), copyOut
+  // (results and model bytes out of the heap), each { ms, calls }.
+  // bytesCopied counts bytes moved across the JS/WASM boundary and by
+  // the bridge; allocs the bridge's heap allocations for this model;
+  // heapBytes / peakHeapBytes the malloc heap top (current / highest
+  // seen at the end of a phase).
+  stats() {
+    this.#ensureNotDisposed()
+    if (!this.#jsStats) return null
+    const js = this.#jsStats
+    const c = new Float64Array(STATS_LEN)
+    if (this.#handle) {
+      const wasm = getWasm()
+      withScratch(wasm, () => {
+        const ptr = scratch(wasm, STATS_LEN * 8)
+        const n = wasm._wl_xl_get_stats(this.#handle, ptr, STATS_LEN)
+        if (n < 0) throw new Error(`Stats failed: ${getLastError()}`)
+        c.set(wasm.HEAPF64.subarray(ptr >> 3, (ptr >> 3) + n))
+      })
+    }
+    const phases = { convert: { ...js.convert } }
+    STATS_PHASES.forEach((name, i) => {
+      phases[name] = { ms: c[2 * i], calls: c[2 * i + 1] }
+    })
+    phases.copyOut = { ...js.copyOut }
+    const k = 2 * STATS_PHASES.length
+    return {
+      phases,
+      bytesCopied: c[k] + js.bytes,
+      allocs: c[k + 1],
+      heapBytes: c[k + 2],
+      peakHeapBytes: c[k + 3]
+    }
+  }
+
+  resetStats() {
+    this.#ensureNotDisposed()
+    if (!this.#jsStats) return this
+    this.#jsStats = newJsStats()
+    if (this.#handle) getWasm()._wl_xl_reset_stats(this.#handle)
+    return this
+  }
+
+  // Paging counters of a loadPaged() model ({ resident, pages, pageIns }),
+  // or null for models held fully in the heap
+  get pageStats() {
+    if (!this.#pager || !this.#handle) return null
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      const ptr = scratch(wasm, 12)
+      wasm._wl_xl_paged_stats(this.#handle, ptr, ptr + 4, ptr + 8)
+      return {
+        resident: wasm.getValue(ptr, 'i32'),
+        pages: wasm.getValue(ptr + 4, 'i32'),
+        pageIns: wasm.getValue(ptr + 8, 'i32')
+      }
+    })
+  }
+
+  // Bytes this model holds: heapBytes in the WASM heap (prepared model
+  // and output region; 0 while evicted), blobBytes on the JS side (its
+  // cached model bytes), and whether it is resident (prepared)
+  memoryUsage() {
+    this.#ensureNotDisposed()
+    const heapBytes = this.#handle
+      ? getWasm()._wl_xl_handle_bytes(this.#handle) + this.#outCap * 4
+      : 0
+    return {
+      heapBytes,
+      blobBytes: this.#modelBytes ? this.#modelBytes.length : 0,
+      resident: this.#handle !== null
+    }
+  }
+
+  // Heap use of the module all models share: heapSize (WASM memory,
+  // which only grows), heapTop (top of the malloc heap), models and
+  // residentBytes (prepared models and their bytes), and the budget
+  // with its evictions and restores so far
+  static memoryUsage() {
+    const wasm = getWasm()
+    return {
+      heapSize: wasm.HEAPU8.length,
+      heapTop: wasm._wl_xl_heap_top(),
+      models: XLearnBase.#lru.size,
+      residentBytes: XLearnBase.#residentBytes,
+      budget: XLearnBase.#budget,
+      evictions: XLearnBase.#evictions,
+      restores: XLearnBase.#restores
+    }
+  }
+
+  // Cap the bytes prepared models hold (0 or null: no cap). Over it,
+  // least recently used models are evicted: their handle is freed and
+  // the model bytes are kept on the JS side, to be parsed again by
+  // their next call that needs the model. Paged models are counted but
+  // never evicted; datasets and batches are outside the budget.
+  static setHeapBudget(bytes) {
+    if (bytes != null && !(bytes >= 0)) {
+      throw new Error('setHeapBudget: bytes must be a non-negative number')
+    }
+    XLearnBase.#budget = bytes || 0
+    XLearnBase.#enforceBudget(null)
+  }
+
+  get _typeId() {
+    throw new Error('Subclass must implement _typeId')
+  }
+
+  // --- Private helpers ---
+
+  // Serialize the resident model once and cache the bytes
+  #getModelBytes() {
+    if (this.#modelBytes) return this.#modelBytes
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      const size = wasm._wl_xl_model_size(this.#handle)
+      if (size < 0) throw new Error(`Save failed: ${getLastError()}`)
+
+      const bufPtr = scratch(wasm, size)
+      const ret = wasm._wl_xl_save_model(this.#handle, bufPtr, size)
+      if (ret !== 0) {
+        throw new Error(`Save failed: ${getLastError()}`)
+      }
+
+      const t0 = this.#jsStats ? performance.now() : 0
+      this.#modelBytes = wasm.HEAPU8.slice(bufPtr, bufPtr + size)
+      if (this.#jsStats) addPhase(this.#jsStats.copyOut, t0, size, this.#jsStats)
+      return this.#modelBytes
+    })
+  }
+
+  // Inference-only quantized bytes (cached when the model was loaded so)
+  #getQuantizedBytes(kind) {
+    if (this.#quantized) {
+      if (kind !== this.#quantized) {
+        throw new Error(`save: model is already quantized as ${this.#quantized}`)
+      }
+      return this.#modelBytes
+    }
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      this.#prepare()
+      const outPtr = scratch(wasm, 8)
+      const ret = wasm._wl_xl_save_quantized(this.#handle, QUANT_BITS[kind], outPtr, outPtr + 4)
+      if (ret !== 0) throw new Error(`Save failed: ${getLastError()}`)
+      const bufPtr = wasm.getValue(outPtr, 'i32')
+      const len = wasm.getValue(outPtr + 4, 'i32')
+      const bytes = wasm.HEAPU8.slice(bufPtr, bufPtr + len)
+      wasm._wl_xl_free_buffer(bufPtr)
+      return bytes
+    })
+  }
+
+  #rawPredict(X) {
+    const { ptr, rows } = this.#predictToHeap(X)
+    const t0 = this.#jsStats ? performance.now() : 0
+    const out = new Float64Array(getWasm().HEAPF32.subarray(ptr >> 2, (ptr >> 2) + rows))
+    if (this.#jsStats) addPhase(this.#jsStats.copyOut, t0, rows * 4, this.#jsStats)
+    return out
+  }
+
+  // Pages dmatrix touches that are not resident, with their byte ranges;
+  // starts a batch, so resident ones are kept until the next one
+  #missingPages(wasm, dmatrix) {
+    const infoPtr = scratch(wasm, 8)
+    wasm._wl_xl_paged_stats(this.#handle, 0, infoPtr, 0)
+    const nPages = wasm.getValue(infoPtr, 'i32')
+    const idsPtr = scratch(wasm, Math.max(nPages, 1) * 4)
+    const n = wasm._wl_xl_paged_missing(this.#handle, dmatrix, idsPtr, nPages)
+    if (n < 0) throw new Error(`Paging failed: ${getLastError()}`)
+
+    const pages = []
+    for (let i = 0; i < n; i++) {
+      const page = wasm.HEAP32[(idsPtr >> 2) + i]
+      wasm._wl_xl_paged_page_info(this.#handle, page, infoPtr, infoPtr + 4)
+      pages.push({
+        page,
+        offset: wasm.getValue(infoPtr, 'i32'),
+        length: wasm.getValue(infoPtr + 4, 'i32')
+      })
+    }
+    return pages
+  }
+
+  // Read the pages dmatrix needs straight into the heap (sync sources)
+  #pageIn(wasm, dmatrix) {
+    const pages = this.#missingPages(wasm, dmatrix)
+    if (pages.length === 0) return
+    const { src, base } = this.#pager
+    if (!src.sync) {
+      throw new Error(`predict: ${pages.length} weight pages are not resident; await prefetch(X) first`)
+    }
+    for (const { page, offset, length } of pages) {
+      const ptr = wasm._wl_xl_paged_page_in(this.#handle, page)
+      if (!ptr) throw new Error(`Page-in failed: ${getLastError()}`)
+      try {
+        src.readInto(wasm.HEAPU8.subarray(ptr, ptr + length), base + offset)
+      } catch (e) {
+        wasm._wl_xl_paged_drop(this.#handle, page)
+        throw e
+      }
+    }
+  }
+
+  #closePager() {
+    if (this.#pager) this.#pager.src.close()
+    this.#pager = null
+  }
+
+  // Score X into the model's reusable heap output region. score(dmatrix,
+  // rows, outPtr, outCap), when given, replaces wl_xl_predict_into with
+  // a C entry point that scores the same way and post-processes
+  #predictToHeap(X, score = null) {
+    const wasm = getWasm()
+    return withScratch(wasm, () => {
+      this.#prepare()
+
+      // Build DMatrix for query
+      const { dmatrix, rows } = this.#buildDMatrix(wasm, X, null)
+
+      if (this.#pager) {
+        try {
+          this.#pageIn(wasm, dmatrix)
+        } catch (e) {
+          wasm._wl_xl_free_dmatrix(dmatrix)
+          throw e
+        }
+      }
+
+      // Grow (never shrink) the output region; it lives until dispose()
+      if (rows > this.#outCap) {
+        if (this.#outPtr) wasm._free(this.#outPtr)
+        this.#outCap = Math.max(rows, this.#outCap * 2)
+        this.#outPtr = wasm._malloc(this.#outCap * 4)
+        this.#markResident()
+      }
+
+      // Score against the model prepared in fit() / load()
+      let n
+      try {
+        n = score
+          ? score(dmatrix, rows, this.#outPtr, this.#outCap)
+          : wasm._wl_xl_predict_into(this.#handle, dmatrix, this.#outPtr, this.#outCap)
+      } finally {
+        wasm._wl_xl_free_dmatrix(dmatrix)
+      }
+
+      if (n < 0) throw new Error(`Predict failed: ${getLastError()}`)
+      return { ptr: this.#outPtr, rows: n }
+    })
+  }
+
+  // Dispose previous handle if refitting
+  #resetModel(wasm) {
+    if (this.#handle) {
+      wasm._wl_xl_free_handle(this.#handle)
+      this.#handle = null
+      if (this.#handleRef) this.#handleRef[0] = null
+      if (leakRegistry) leakRegistry.unregister(this)
     }
+    this.#dropResident()
+    this.#closePager()
+    this.#modelBytes = null
+    this.#fitted = false
+    this.#generation++
+    this.#jsStats = this.#params.stats ? newJsStats() : null
+  }
 
+  #setShape(cols, classSet) {
     this.#nFeatures = cols
+    this.#bestEpoch = null
 
     // Detect classes for classifier
     if (this.#task === 'binary') {
-      const classSet = new Set()
-      for (let i = 0; i < yF64.length; i++) classSet.add(yF64[i])
       const sorted = [...classSet].sort((a, b) => a - b)
       this.#nClasses = sorted.length
       this.#classes = new Int32Array(sorted)
     }
+  }
 
-    // Create xLearn handle
-    const handlePtr = wasm._malloc(4)
-    const algo = this.#algo
-    const ret = withCString(wasm, algo, (algoCStr) => {
-      return wasm._wl_xl_create(algoCStr, handlePtr)
-    })
+  // Create a handle and train it on dmatrix (consumed)
+  #trainOn(wasm, dmatrix, cols, classSet) {
+    this.#setShape(cols, classSet)
 
-    if (ret !== 0) {
-      wasm._free(handlePtr)
+    let handle
+    try {
+      handle = this.#createHandle(wasm)
+    } catch (e) {
       wasm._wl_xl_free_dmatrix(dmatrix)
-      throw new Error(`Create failed: ${getLastError()}`)
+      throw e
     }
 
-    const handle = wasm.getValue(handlePtr, 'i32')
-    wasm._free(handlePtr)
-
-    // Set task
-    const taskStr = this.#task === 'binary' ? 'binary' : 'reg'
-    withCString(wasm, 'task', (kPtr) => {
-      withCString(wasm, taskStr, (vPtr) => {
-        wasm._wl_xl_set_str(handle, kPtr, vPtr)
-      })
-    })
-
-    // Set parameters
-    this.#applyParams(wasm, handle)
-
-    // Train
-    const modelBufPtr = wasm._malloc(4)
-    const modelLenPtr = wasm._malloc(4)
-
-    const fitRet = wasm._wl_xl_fit(handle, dmatrix, 0, modelBufPtr, modelLenPtr)
+    // Train; the model stays resident on the handle (bytes are produced
+    // lazily by save())
+    const fitRet = wasm._wl_xl_fit_model(handle, dmatrix, 0)
 
     wasm._wl_xl_free_dmatrix(dmatrix)
 
     if (fitRet !== 0) {
-      wasm._free(modelBufPtr)
-      wasm._free(modelLenPtr)
       wasm._wl_xl_free_handle(handle)
       throw new Error(`Fit failed: ${getLastError()}`)
     }
 
-    const modelBuf = wasm.getValue(modelBufPtr, 'i32')
-    const modelLen = wasm.getValue(modelLenPtr, 'i32')
-    wasm._free(modelBufPtr)
-    wasm._free(modelLenPtr)
-
-    // Copy model bytes to JS
-    this.#modelBytes = new Uint8Array(modelLen)
-    this.#modelBytes.set(wasm.HEAPU8.subarray(modelBuf, modelBuf + modelLen))
-    wasm._wl_xl_free_buffer(modelBuf)
-
-    // Keep handle for prediction
-    this.#handle = handle
-    this.#fitted = true
-
-    this.#handleRef = [this.#handle]
-    if (leakRegistry) {
-      leakRegistry.register(this, {
-        ref: this.#handleRef,
-        freeFn: (h) => { try { getWasm()._wl_xl_free_handle(h) } catch {} }
-      }, this)
-    }
-
+    this.#adoptHandle(handle)
     return this
   }
 
-  predict(X) {
-    this.#ensureFitted()
-    return this.#rawPredict(X)
-  }
-
-  predictProba(X) {
-    this.#ensureFitted()
-    if (this.#task !== 'binary') {
-      throw new Error('predictProba is only available for classifiers')
-    }
-
-    const margins = this.#rawPredict(X)
-    const n = margins.length
-    const proba = new Float64Array(n * 2)
-    for (let i = 0; i < n; i++) {
-      const p1 = sigmoid(margins[i])
-      proba[i * 2] = 1 - p1
-      proba[i * 2 + 1] = p1
+  // Labeled validation DMatrix from [Xv, yv]
+  #buildValidation(wasm, [Xv, yv]) {
+    const yvArr = labelArray(yv)
+    const { dmatrix: dvalid, rows } = this.#buildDMatrix(wasm, Xv, yvArr)
+    if (yvArr.length !== rows || rows === 0) {
+      wasm._wl_xl_free_dmatrix(dvalid)
+      throw new Error(`validation y length (${yvArr.length}) does not match X rows (${rows})`)
     }
-    return proba
+    return dvalid
   }
 
-  decisionFunction(X) {
-    this.#ensureFitted()
-    return this.#rawPredict(X)
-  }
+  // Train on dmatrix and dvalid (both consumed; dvalid may be 0) one
+  // epoch per wl_xl_fit_epoch call, reporting metrics and stopping early
+  // (see fit())
+  #trainEpochs(wasm, dmatrix, dvalid, cols, classSet, opts) {
+    this.#setShape(cols, classSet)
+    const p = this.#params
+    const epochs = p.epoch !== undefined ? p.epoch : 10 // upstream default
+    const stopWindow = p.stopWindow !== undefined ? p.stopWindow : 2
 
-  score(X, y) {
-    const preds = this.predict(X)
-    const yArr = normalizeY(y)
+    let handle = 0
+    try {
+      const earlyStop = dvalid !== 0 && p.earlyStop !== false
 
-    if (this.#task === 'binary') {
-      // Accuracy (apply threshold to raw margins for classifier)
-      let correct = 0
-      for (let i = 0; i < preds.length; i++) {
-        const predClass = preds[i] > 0 ? 1 : 0
-        const trueClass = yArr[i] > 0 ? 1 : 0
-        if (predClass === trueClass) correct++
-      }
-      return correct / preds.length
-    } else {
-      // R-squared
-      let ssRes = 0, ssTot = 0, yMean = 0
-      for (let i = 0; i < yArr.length; i++) yMean += yArr[i]
-      yMean /= yArr.length
-      for (let i = 0; i < yArr.length; i++) {
-        ssRes += (yArr[i] - preds[i]) ** 2
-        ssTot += (yArr[i] - yMean) ** 2
+      handle = this.#createHandle(wasm)
+      if (wasm._wl_xl_fit_begin(handle, dmatrix) !== 0) {
+        throw new Error(`Fit failed: ${getLastError()}`)
       }
-      return ssTot === 0 ? 0 : 1 - ssRes / ssTot
-    }
-  }
-
-  // --- Model I/O ---
-
-  save() {
-    this.#ensureFitted()
-
-    const artifacts = [
-      { id: 'model', data: this.#modelBytes }
-    ]
 
-    // FFM field map
-    if (this.#algo === 'ffm' && this.#featureFields) {
-      const fieldBytes = new Uint8Array(this.#featureFields.buffer,
-        this.#featureFields.byteOffset, this.#featureFields.byteLength)
-      artifacts.push({ id: 'field_map', data: fieldBytes })
-    }
+      const metricsPtr = scratch(wasm, 12)
+      let best = Infinity
+      let bestEpoch = 0
+      let epoch = 0
+      while (epoch < epochs) {
+        epoch++
+        if (wasm._wl_xl_fit_epoch(handle, dmatrix, dvalid, metricsPtr) !== 0) {
+          throw new Error(`Fit failed: ${getLastError()}`)
+        }
+        const m = wasm.HEAPF32.subarray(metricsPtr >> 2, (metricsPtr >> 2) + 3)
+        const info = {
+          epoch,
+          trainLoss: m[0],
+          validLoss: dvalid ? m[1] : null,
+          validMetric: dvalid ? m[2] : null
+        }
+        if (earlyStop && info.validLoss < best) {
+          best = info.validLoss
+          bestEpoch = epoch
+          wasm._wl_xl_snapshot_model(handle)
+        }
+        if (opts.onEpoch && opts.onEpoch(info) === false) break
+        if (earlyStop && epoch - bestEpoch >= stopWindow) break
+      }
 
-    const metadata = {
-      algo: this.#algo,
-      task: this.#task,
-      nFeatures: this.#nFeatures,
-      nClasses: this.#nClasses,
-      classes: this.#classes ? Array.from(this.#classes) : null
+      // Roll back to the best epoch's weights
+      if (earlyStop && bestEpoch && bestEpoch !== epoch) {
+        wasm._wl_xl_restore_snapshot(handle)
+      }
+      if (earlyStop) this.#bestEpoch = bestEpoch
+    } catch (e) {
+      if (handle) wasm._wl_xl_free_handle(handle)
+      throw e
+    } finally {
+      wasm._wl_xl_free_dmatrix(dmatrix)
+      if (dvalid) wasm._wl_xl_free_dmatrix(dvalid)
     }
 
-    return encodeBundle(
-      { typeId: this._typeId, params: this.getParams(), metadata },
-      artifacts
-    )
-  }
-
-  static async _load(bytes, TypeClass) {
-    const { manifest, toc, blobs } = decodeBundle(bytes)
-    return TypeClass._fromBundle(manifest, toc, blobs)
+    this.#adoptHandle(handle)
+    return this
   }
 
-  static async _fromBundle(manifest, toc, blobs, TypeClass) {
-    await loadXLearn()
+  // New xLearn handle with task and params applied
+  #createHandle(wasm) {
+    const handlePtr = scratch(wasm, 4)
+    const algo = this.#algo
+    const ret = withCString(wasm, algo, (algoCStr) => {
+      return wasm._wl_xl_create(algoCStr, handlePtr)
+    })
 
-    const entry = toc.find(e => e.id === 'model')
-    if (!entry) throw new Error('Bundle missing "model" artifact')
-    const modelData = new Uint8Array(entry.length)
-    modelData.set(blobs.subarray(entry.offset, entry.offset + entry.length))
+    if (ret !== 0) {
+      throw new Error(`Create failed: ${getLastError()}`)
+    }
 
-    const meta = manifest.metadata || {}
-    const params = manifest.params || {}
+    const handle = wasm.getValue(handlePtr, 'i32')
 
-    const instance = new TypeClass(LOAD_SENTINEL, meta.algo, meta.task, params)
-    instance.#modelBytes = modelData
-    instance.#nFeatures = meta.nFeatures || 0
-    instance.#nClasses = meta.nClasses || 0
-    instance.#classes = meta.classes ? new Int32Array(meta.classes) : null
+    // Set task
+    const taskStr = this.#task === 'binary' ? 'binary' : 'reg'
+    withCString(wasm, 'task', (kPtr) => {
+      withCString(wasm, taskStr, (vPtr) => {
+        wasm._wl_xl_set_str(handle, kPtr, vPtr)
+      })
+    })
 
-    // Load field_map if present
-    const fieldEntry = toc.find(e => e.id === 'field_map')
-    if (fieldEntry) {
-      const raw = blobs.subarray(fieldEntry.offset, fieldEntry.offset + fieldEntry.length)
-      instance.#featureFields = new Int32Array(raw.buffer.slice(
-        raw.byteOffset, raw.byteOffset + raw.byteLength
-      ))
-      if (params.featureFields === undefined) {
-        params.featureFields = instance.#featureFields
-      }
-    }
+    // Set parameters
+    this.#applyParams(wasm, handle)
+    this.#enableStats(wasm, handle)
+    this.#applyLayout(wasm, handle)
+    this.#applyParallel(wasm, handle)
+    this.#applySampling(wasm, handle)
+    return handle
+  }
 
-    // Create handle for prediction
-    const wasm = getWasm()
-    const handlePtr = wasm._malloc(4)
+  // Handle for a loaded model: task from meta, weights installed by load()
+  #loadHandle(wasm, meta, load) {
+    const handlePtr = scratch(wasm, 4)
     const ret = withCString(wasm, meta.algo || 'fm', (algoCStr) => {
       return wasm._wl_xl_create(algoCStr, handlePtr)
     })
 
     if (ret !== 0) {
-      wasm._free(handlePtr)
       throw new Error(`Create failed: ${getLastError()}`)
     }
 
-    instance.#handle = wasm.getValue(handlePtr, 'i32')
-    wasm._free(handlePtr)
+    const handle = wasm.getValue(handlePtr, 'i32')
 
     // Set task
     const taskStr = meta.task === 'binary' ? 'binary' : 'reg'
     withCString(wasm, 'task', (kPtr) => {
       withCString(wasm, taskStr, (vPtr) => {
-        wasm._wl_xl_set_str(instance.#handle, kPtr, vPtr)
+        wasm._wl_xl_set_str(handle, kPtr, vPtr)
       })
     })
 
-    instance.#fitted = true
-
-    instance.#handleRef = [instance.#handle]
-    if (leakRegistry) {
-      leakRegistry.register(instance, {
-        ref: instance.#handleRef,
-        freeFn: (h) => { try { getWasm()._wl_xl_free_handle(h) } catch {} }
-      }, instance)
+    this.#enableStats(wasm, handle)
+    this.#applyLayout(wasm, handle)
+    this.#applyParallel(wasm, handle)
+    if (load(handle) !== 0) {
+      wasm._wl_xl_free_handle(handle)
+      throw new Error(`Model load failed: ${getLastError()}`)
     }
-
-    return instance
+    return handle
   }
 
-  dispose() {
-    if (this.#freed) return
-    this.#freed = true
-
-    if (this.#handle) {
-      const wasm = getWasm()
-      wasm._wl_xl_free_handle(this.#handle)
+  // params.stats: per-phase timers on the handle (see stats())
+  #enableStats(wasm, handle) {
+    if (!this.#params.stats) return
+    if (wasm._wl_xl_enable_stats(handle, 1) !== 0) {
+      wasm._wl_xl_free_handle(handle)
+      throw new Error(`Stats failed: ${getLastError()}`)
     }
-
-    if (this.#handleRef) this.#handleRef[0] = null
-    if (leakRegistry) leakRegistry.unregister(this)
-
-    this.#handle = null
-    this.#modelBytes = null
-    this.#fitted = false
+    if (!this.#jsStats) this.#jsStats = newJsStats()
   }
 
-  // --- Params ---
-
-  getParams() {
-    return { ...this.#params }
+  // params.negSampleRate: fraction of negatives each epoch trains on
+  // (classifiers, 0 < rate <= 1), chosen by params.negSampleSeed; the
+  // bias is corrected so scores stay calibrated. free: release handle
+  // on error (a fresh handle)
+  #applySampling(wasm, handle, free = true) {
+    const p = this.#params
+    if (p.negSampleRate === undefined && p.negSampleSeed === undefined) return
+    const rate = p.negSampleRate !== undefined ? p.negSampleRate : 1
+    let err = null
+    if (rate !== 1 && this.#task !== 'binary') {
+      err = 'negSampleRate needs a classifier'
+    } else if (wasm._wl_xl_set_neg_sampling(handle, rate, p.negSampleSeed || 0) !== 0) {
+      err = `negSampleRate failed: ${getLastError()}`
+    }
+    if (err) {
+      if (free) wasm._wl_xl_free_handle(handle)
+      throw new Error(err)
+    }
   }
 
-  setParams(p) {
-    Object.assign(this.#params, p)
-    if (p.featureFields !== undefined) {
-      this.#featureFields = p.featureFields
+  // params.layout: 'blocked' keeps FFM weights in the blocked layout
+  // (csrc/ffm_blocked.h); a resident model is converted in place
+  #applyLayout(wasm, handle) {
+    const layout = this.#params.layout
+    if (layout === undefined) return
+    if (layout !== 'interleaved' && layout !== 'blocked') {
+      wasm._wl_xl_free_handle(handle)
+      throw new Error(`unknown layout '${layout}' (expected 'interleaved' or 'blocked')`)
+    }
+    if (wasm._wl_xl_set_layout(handle, layout === 'blocked' ? 1 : 0) !== 0) {
+      wasm._wl_xl_free_handle(handle)
+      throw new Error(`Layout failed: ${getLastError()}`)
     }
-    return this
   }
 
-  // --- Inspection ---
-
-  get isFitted() {
-    return this.#fitted && !this.#freed
+  // params.parallelNnz: FFM rows with at least this many entries are
+  // scored in parallel bands (csrc/ffm_parallel.h); 0 turns it off
+  #applyParallel(wasm, handle) {
+    const n = this.#params.parallelNnz
+    if (n === undefined) return
+    if (wasm._wl_xl_set_parallel_nnz(handle, n) !== 0) {
+      wasm._wl_xl_free_handle(handle)
+      throw new Error(`parallelNnz failed: ${getLastError()}`)
+    }
   }
 
-  get nFeatures() {
-    return this.#nFeatures
+  #metadata() {
+    return {
+      algo: this.#algo,
+      task: this.#task,
+      nFeatures: this.#nFeatures,
+      nClasses: this.#nClasses,
+      classes: this.#classes ? Array.from(this.#classes) : null
+    }
   }
 
-  get nClasses() {
-    return this.#nClasses
+  #setMetadata(meta) {
+    this.#nFeatures = meta.nFeatures || 0
+    this.#nClasses = meta.nClasses || 0
+    this.#classes = meta.classes ? new Int32Array(meta.classes) : null
   }
 
-  get classes() {
-    return this.#classes ? new Int32Array(this.#classes) : null
+  // Keep a trained handle for prediction
+  #adoptHandle(handle) {
+    this.#fitted = true
+    this.#generation++
+    this.#attachHandle(handle)
   }
 
-  get _typeId() {
-    throw new Error('Subclass must implement _typeId')
+  #attachHandle(handle) {
+    this.#handle = handle
+
+    this.#handleRef = [this.#handle]
+    if (leakRegistry) {
+      leakRegistry.register(this, {
+        ref: this.#handleRef,
+        freeFn: (h) => { try { getWasm()._wl_xl_free_handle(h) } catch {} }
+      }, this)
+    }
+    this.#markResident()
   }
 
-  // --- Private helpers ---
+  // Handle with this.#modelBytes parsed into it (full or quantized)
+  #parseModelBytes(wasm) {
+    const modelData = this.#modelBytes
+    const quantized = this.#quantized !== null
+    return withScratch(wasm, () => {
+      const modelPtr = scratch(wasm, modelData.length)
+      wasm.HEAPU8.set(modelData, modelPtr)
+      return this.#loadHandle(wasm, this.#metadata(), (h) => quantized
+        ? wasm._wl_xl_load_quantized(h, modelPtr, modelData.length)
+        : wasm._wl_xl_load_model(h, modelPtr, modelData.length))
+    })
+  }
 
-  #rawPredict(X) {
-    const wasm = getWasm()
+  // --- Heap budget ---
 
-    // Build DMatrix for query
-    let dmatrix, rows
-    if (isCSR(X)) {
-      ({ dmatrix, rows } = this.#buildCSRDMatrix(wasm, X, null))
+  // Fitted model ready to score: an evicted one is parsed again from
+  // its bytes (its generation is unchanged) and marked most recently used
+  #prepare() {
+    if (!this.#handle) {
+      const wasm = getWasm()
+      const handle = this.#parseModelBytes(wasm)
+      this.#applyParams(wasm, handle)
+      XLearnBase.#restores++
+      this.#attachHandle(handle)
     } else {
-      ({ dmatrix, rows } = this.#buildDenseDMatrix(wasm, X, null))
+      this.#markResident()
     }
+  }
 
-    // Write model bytes to WASM heap
-    const modelPtr = wasm._malloc(this.#modelBytes.length)
-    wasm.HEAPU8.set(this.#modelBytes, modelPtr)
-
-    const outPredsPtr = wasm._malloc(4)
-    const outLenPtr = wasm._malloc(4)
-
-    const ret = wasm._wl_xl_predict(
-      this.#handle, modelPtr, this.#modelBytes.length,
-      dmatrix, outPredsPtr, outLenPtr
-    )
-
-    wasm._free(modelPtr)
-    wasm._wl_xl_free_dmatrix(dmatrix)
-
-    if (ret !== 0) {
-      wasm._free(outPredsPtr)
-      wasm._free(outLenPtr)
-      throw new Error(`Predict failed: ${getLastError()}`)
+  // (Re)measure the prepared model and move it to the most recently
+  // used end; over budget, least recently used models are evicted
+  #markResident() {
+    const lru = XLearnBase.#lru
+    if (!this.#memKey) this.#memKey = ++nextMemKey
+    const prev = lru.get(this.#memKey)
+    if (prev) {
+      lru.delete(this.#memKey)
+      XLearnBase.#residentBytes -= prev.bytes
     }
+    const bytes = getWasm()._wl_xl_handle_bytes(this.#handle) + this.#outCap * 4
+    lru.set(this.#memKey, { ref: prev ? prev.ref : weakRef(this), bytes })
+    XLearnBase.#residentBytes += bytes
+    XLearnBase.#enforceBudget(this)
+  }
 
-    const predsPtr = wasm.getValue(outPredsPtr, 'i32')
-    const predsLen = wasm.getValue(outLenPtr, 'i32')
-    wasm._free(outPredsPtr)
-    wasm._free(outLenPtr)
+  #dropResident() {
+    const entry = XLearnBase.#lru.get(this.#memKey)
+    if (!entry) return
+    XLearnBase.#lru.delete(this.#memKey)
+    XLearnBase.#residentBytes -= entry.bytes
+  }
 
-    // Copy float predictions to Float64Array
-    const result = new Float64Array(predsLen)
-    for (let i = 0; i < predsLen; i++) {
-      result[i] = wasm.HEAPF32[predsPtr / 4 + i]
+  // Free the prepared model and its output region, keeping the bytes
+  // #prepare() re-parses it from
+  #evict() {
+    if (!this.#modelBytes) this.#getModelBytes()
+    const wasm = getWasm()
+    wasm._wl_xl_free_handle(this.#handle)
+    this.#handle = null
+    if (this.#handleRef) this.#handleRef[0] = null
+    if (leakRegistry) leakRegistry.unregister(this)
+    if (this.#outPtr) {
+      wasm._free(this.#outPtr)
+      this.#outPtr = 0
+      this.#outCap = 0
     }
-    wasm._wl_xl_free_buffer(predsPtr)
-
-    return result
+    this.#dropResident()
+    XLearnBase.#evictions++
   }
 
-  #buildDenseDMatrix(wasm, X, y) {
-    const { data: xData, rows, cols } = normalizeX(X)
-
-    // xLearn uses float32 internally
-    const xF32 = new Float32Array(xData.length)
-    for (let i = 0; i < xData.length; i++) xF32[i] = xData[i]
-
-    const xPtr = wasm._malloc(xF32.length * 4)
-    wasm.HEAPF32.set(xF32, xPtr / 4)
-
-    // Labels: remap {0,1} -> {-1,+1} for binary classification
-    let yPtr = 0
-    if (y) {
-      const yF32 = new Float32Array(y.length)
-      if (this.#task === 'binary') {
-        for (let i = 0; i < y.length; i++) yF32[i] = y[i] > 0 ? 1 : -1
-      } else {
-        for (let i = 0; i < y.length; i++) yF32[i] = y[i]
+  // Evict least recently used models (never keep, nor paged models,
+  // which bound their own pages) until the budget holds
+  static #enforceBudget(keep) {
+    if (!XLearnBase.#budget || XLearnBase.#hold) return
+    for (const [key, entry] of XLearnBase.#lru) {
+      if (XLearnBase.#residentBytes <= XLearnBase.#budget) break
+      const m = entry.ref.deref()
+      if (!m) {
+        // Collected without dispose(); leakRegistry frees its handle
+        XLearnBase.#lru.delete(key)
+        XLearnBase.#residentBytes -= entry.bytes
+      } else if (m !== keep && !m.#pager) {
+        m.#evict()
       }
-      yPtr = wasm._malloc(yF32.length * 4)
-      wasm.HEAPF32.set(yF32, yPtr / 4)
     }
+  }
 
-    // Field map for FFM
-    let fieldPtr = 0
-    const featureFields = this.#params.featureFields || this.#featureFields
-    if (featureFields) {
-      this.#featureFields = featureFields
-      fieldPtr = wasm._malloc(featureFields.length * 4)
-      for (let i = 0; i < featureFields.length; i++) {
-        wasm.setValue(fieldPtr + i * 4, featureFields[i], 'i32')
+  // Parse a bundle's model (and field map) into this instance; params
+  // are this.#params, meta the bundle's metadata
+  #installBundle(toc, blobs, meta) {
+    const entry = toc.find(e => e.id === 'model') ||
+      toc.find(e => e.id === 'model_quantized')
+    if (!entry) throw new Error('Bundle missing "model" artifact')
+    const quantized = entry.id === 'model_quantized'
+    const modelData = new Uint8Array(entry.length)
+    modelData.set(blobs.subarray(entry.offset, entry.offset + entry.length))
+
+    this.#modelBytes = modelData
+    this.#quantized = quantized ? meta.quantized || 'fp16' : null
+    this.#setMetadata(meta)
+
+    // Load field_map if present
+    const fieldEntry = toc.find(e => e.id === 'field_map')
+    if (fieldEntry) {
+      const raw = blobs.subarray(fieldEntry.offset, fieldEntry.offset + fieldEntry.length)
+      this.#featureFields = new Int32Array(raw.buffer.slice(
+        raw.byteOffset, raw.byteOffset + raw.byteLength
+      ))
+      if (this.#params.featureFields === undefined) {
+        this.#params.featureFields = this.#featureFields
       }
     }
 
-    const outPtr = wasm._malloc(4)
-    const ret = wasm._wl_xl_create_dmatrix_dense(
-      xPtr, rows, cols, yPtr, fieldPtr, outPtr
-    )
-
-    wasm._free(xPtr)
-    if (yPtr) wasm._free(yPtr)
-    if (fieldPtr) wasm._free(fieldPtr)
+    // Parse model bytes once; predictions reuse the resident model
+    this.#adoptHandle(this.#parseModelBytes(getWasm()))
+  }
 
-    if (ret !== 0) {
-      wasm._free(outPtr)
-      throw new Error(`DMatrix creation failed: ${getLastError()}`)
+  // Key of this model on engine, moving it off a previous engine
+  #bindEngine(engine) {
+    if (this.#engine !== engine) {
+      if (this.#engine) this.#engine._release(this.#engineKey)
+      this.#engine = engine
     }
+    if (!this.#engineKey) this.#engineKey = ++nextEngineKey
+    return this.#engineKey
+  }
 
-    const dmatrix = wasm.getValue(outPtr, 'i32')
-    wasm._free(outPtr)
+  #beginDMatrix(wasm, cols) {
+    const featureFields = this.#resolveFeatureFields()
+    const fieldPtr = featureFields ? scratch(wasm, featureFields.length * 4) : 0
+    if (fieldPtr) wasm.HEAP32.set(featureFields, fieldPtr >> 2)
 
-    return { dmatrix, rows, cols }
+    const outPtr = scratch(wasm, 4)
+    const ret = wasm._wl_xl_dmatrix_begin(cols, 1, fieldPtr, outPtr)
+    const builder = wasm.getValue(outPtr, 'i32')
+
+    if (ret !== 0) throw new Error(`DMatrix creation failed: ${getLastError()}`)
+    return builder
   }
 
-  #buildCSRDMatrix(wasm, X, y) {
-    const { rows, cols, data, indices, indptr } = X
+  #appendDenseChunk(wasm, builder, X, y, cols) {
+    const { data: xData, rows, cols: chunkCols } = denseInput(X)
+    if (chunkCols !== cols) {
+      throw new Error(`chunk has ${chunkCols} columns, expected ${cols}`)
+    }
+    if (y.length !== rows) return rows
 
-    // Convert data to Float32
-    const valF32 = new Float32Array(data.length)
-    for (let i = 0; i < data.length; i++) valF32[i] = data[i]
+    const block = scratch(wasm, (xData.length + rows) * 4)
+    const yPtr = block + xData.length * 4
+    wasm.HEAPF32.set(xData, block >> 2)
+    this.#writeLabels(wasm, y, yPtr)
 
-    const valPtr = wasm._malloc(valF32.length * 4)
-    wasm.HEAPF32.set(valF32, valPtr / 4)
+    const ret = wasm._wl_xl_dmatrix_append_rows(builder, block, rows, yPtr)
 
-    const idxPtr = wasm._malloc(indices.length * 4)
-    for (let i = 0; i < indices.length; i++) {
-      wasm.setValue(idxPtr + i * 4, indices[i], 'i32')
-    }
+    if (ret !== 0) throw new Error(`DMatrix append failed: ${getLastError()}`)
+    return rows
+  }
 
-    const indptrPtr = wasm._malloc(indptr.length * 4)
-    for (let i = 0; i < indptr.length; i++) {
-      wasm.setValue(indptrPtr + i * 4, indptr[i], 'i32')
+  #appendCSRChunk(wasm, builder, X, y, cols) {
+    const { rows, data, indices, indptr } = X
+    if (X.cols !== cols) {
+      throw new Error(`chunk has ${X.cols} columns, expected ${cols}`)
     }
+    if (y.length !== rows) return rows
+
+    const nnz = data.length
+    const block = scratch(wasm, (nnz * 2 + indptr.length + rows) * 4)
+    const valPtr = block
+    const idxPtr = valPtr + nnz * 4
+    const indptrPtr = idxPtr + nnz * 4
+    const yPtr = indptrPtr + indptr.length * 4
+
+    wasm.HEAPF32.set(data, valPtr >> 2)
+    wasm.HEAP32.set(indices, idxPtr >> 2)
+    wasm.HEAP32.set(indptr, indptrPtr >> 2)
+    this.#writeLabels(wasm, y, yPtr)
+
+    const ret = wasm._wl_xl_dmatrix_append_csr(
+      builder, valPtr, nnz, idxPtr, indptrPtr, rows, yPtr
+    )
 
-    // Labels
-    let yPtr = 0
-    if (y) {
-      const yF32 = new Float32Array(y.length)
-      if (this.#task === 'binary') {
-        for (let i = 0; i < y.length; i++) yF32[i] = y[i] > 0 ? 1 : -1
-      } else {
-        for (let i = 0; i < y.length; i++) yF32[i] = y[i]
-      }
-      yPtr = wasm._malloc(yF32.length * 4)
-      wasm.HEAPF32.set(yF32, yPtr / 4)
-    }
+    if (ret !== 0) throw new Error(`CSR DMatrix append failed: ${getLastError()}`)
+    return rows
+  }
 
-    // Field map
-    let fieldPtr = 0
-    const featureFields = this.#params.featureFields || this.#featureFields
-    if (featureFields) {
-      this.#featureFields = featureFields
-      fieldPtr = wasm._malloc(featureFields.length * 4)
-      for (let i = 0; i < featureFields.length; i++) {
-        wasm.setValue(fieldPtr + i * 4, featureFields[i], 'i32')
+  #buildDMatrix(wasm, X, y) {
+    if (X instanceof XLearnBatch) {
+      if (y) throw new Error('XLearnBatch holds unlabeled rows: pass it to predict, not fit')
+      if (this.#algo === 'ffm' && this.#resolveFeatureFields() && !X.featureFields) {
+        throw new Error('XLearnBatch: FFM models need a batch created with featureFields')
       }
+      return { dmatrix: X._retain(), rows: X.rows, cols: X.cols }
     }
-
-    const outPtr = wasm._malloc(4)
-    const ret = wasm._wl_xl_create_dmatrix_csr(
-      valPtr, valF32.length,
-      idxPtr, indptrPtr, rows, cols,
-      yPtr, fieldPtr, outPtr
+    const t0 = this.#jsStats ? performance.now() : 0
+    const out = buildDMatrix(
+      wasm, X, y, this.#resolveFeatureFields(), this.#task === 'binary',
+      this.#params.hashBits || 0
     )
-
-    wasm._free(valPtr)
-    wasm._free(idxPtr)
-    wasm._free(indptrPtr)
-    if (yPtr) wasm._free(yPtr)
-    if (fieldPtr) wasm._free(fieldPtr)
-
-    if (ret !== 0) {
-      wasm._free(outPtr)
-      throw new Error(`CSR DMatrix creation failed: ${getLastError()}`)
+    if (this.#jsStats) {
+      const nnz = isHashed(X) ? X.hashes.length * 3 : isCSR(X) ? X.data.length * 2 : out.rows * out.cols
+      const n = nnz + (X.indptr ? X.indptr.length : 0) + (y ? y.length : 0)
+      addPhase(this.#jsStats.convert, t0, n * 4, this.#jsStats)
     }
+    return out
+  }
 
-    const dmatrix = wasm.getValue(outPtr, 'i32')
-    wasm._free(outPtr)
+  #writeLabels(wasm, y, ptr) {
+    writeLabels(wasm, y, ptr, this.#task === 'binary')
+  }
 
-    return { dmatrix, rows, cols }
+  // Field map for FFM (params take precedence over a loaded map)
+  #resolveFeatureFields() {
+    const featureFields = this.#params.featureFields || this.#featureFields
+    if (featureFields) this.#featureFields = featureFields
+    return featureFields || null
   }
 
   #applyParams(wasm, handle) {
@@ -616,6 +2340,8 @@ class XLearnBase {
     if (p.lambda_1 !== undefined) setFloat('lambda_1', p.lambda_1)
     if (p.lambda_2 !== undefined) setFloat('lambda_2', p.lambda_2)
     if (p.normalize !== undefined) setBool('norm', p.normalize)
+    if (p.nthread !== undefined) setInt('nthread', p.nthread)
+    if (p.lockFree !== undefined) setBool('lock_free', p.lockFree)
   }
 
   #ensureNotDisposed() {
@@ -628,4 +2354,4 @@ class XLearnBase {
   }
 }
 
-module.exports = { XLearnBase, LOAD_SENTINEL }
+module.exports = { XLearnBase, XLearnDataset, XLearnBatch, LOAD_SENTINEL, hashToken, hashRows }
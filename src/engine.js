@@ -0,0 +1,368 @@
+// Worker-backed execution engine for fitAsync() / predictAsync()
+//
+// An XLearnEngine runs a small pool of workers (src/worker.js), each
+// with its own WASM module. A model is pinned to one worker, which keeps
+// a parsed copy of it; the model's bytes are shipped again only after
+// the model changed on the calling side. Inputs are packed into typed
+// arrays whose buffers are transferred to the worker, not cloned.
+//
+// An XLearnDataset used through fitDatasetAsync() is shipped to each
+// worker once, as its save() bytes; the worker loads it and trains every
+// later trial routed to it on that copy until releaseDataset().
+//
+// Requests queue per worker and at most one message is in flight per
+// worker: what queues up while a message runs goes out as the next one,
+// and the worker scores consecutive predicts against the same model in
+// it as one batch, splitting the outputs back per caller.
+
+const { normalizeX, normalizeY } = require('@wlearn/core')
+
+let defaultEngine = null
+
+function isNode() {
+  return typeof process !== 'undefined' && process.versions && process.versions.node
+}
+
+// a as a Type array; own: reuse a when its whole buffer can be transferred
+function typed(a, Type, own) {
+  if (own && a instanceof Type && a.byteOffset === 0 && a.byteLength === a.buffer.byteLength) {
+    return a
+  }
+  return new Type(a)
+}
+
+// Pack X (dense, CSR or hashed) into typed arrays and collect their
+// buffers; own: transfer X's own arrays where possible (they detach)
+function packInput(X, own, buffers) {
+  let p
+  if (X && X.hashes != null && X.fields != null && X.indptr != null) {
+    p = {
+      rows: X.rows !== undefined ? X.rows : X.indptr.length - 1,
+      indptr: typed(X.indptr, Int32Array, own),
+      fields: typed(X.fields, Int32Array, own),
+      hashes: typed(X.hashes, Uint32Array, own),
+      values: X.values ? typed(X.values, Float32Array, own) : null
+    }
+  } else if (X && X.indices instanceof Int32Array && X.indptr instanceof Int32Array) {
+    p = {
+      rows: X.rows,
+      cols: X.cols,
+      data: typed(X.data, Float32Array, own),
+      indices: typed(X.indices, Int32Array, own),
+      indptr: typed(X.indptr, Int32Array, own)
+    }
+  } else {
+    // xLearn scores float32 input, so packing to float32 loses nothing
+    const { data, rows, cols } = normalizeX(X)
+    p = { data: typed(data, Float32Array, own), rows, cols }
+  }
+  for (const k of Object.keys(p)) {
+    if (ArrayBuffer.isView(p[k])) buffers.add(p[k].buffer)
+  }
+  return p
+}
+
+// Pack labels into a typed array and collect its buffer
+function packLabels(y, own, buffers) {
+  const typedY = y instanceof Float32Array || y instanceof Float64Array || y instanceof Int32Array
+  const yArr = typedY ? typed(y, y.constructor, own) : new Float64Array(normalizeY(y))
+  buffers.add(yArr.buffer)
+  return yArr
+}
+
+function spawn(workerUrl) {
+  if (isNode()) {
+    const { Worker } = require('worker_threads')
+    const path = require('path')
+    const w = new Worker(workerUrl || path.join(__dirname, 'worker.js'))
+    return {
+      post: (msg, transfer) => w.postMessage(msg, transfer),
+      onMessage: (fn) => w.on('message', fn),
+      onError: (fn) => w.on('error', fn),
+      ref: () => w.ref(),
+      unref: () => w.unref(),
+      terminate: () => w.terminate()
+    }
+  }
+  if (!workerUrl) {
+    throw new Error('XLearnEngine: pass workerUrl (the xlearn-worker.js bundle) in browsers')
+  }
+  const w = new Worker(workerUrl)
+  return {
+    post: (msg, transfer) => w.postMessage(msg, transfer),
+    onMessage: (fn) => { w.onmessage = (e) => fn(e.data) },
+    onError: (fn) => { w.onerror = (e) => fn(new Error(e.message || 'worker error')) },
+    ref: () => {},
+    unref: () => {},
+    terminate: () => w.terminate()
+  }
+}
+
+class XLearnEngine {
+  #workers = []
+  #opts
+  #next = 0
+  #jobId = 0
+  #models = new Map() // key -> { worker, generation }
+  #datasets = new WeakMap() // XLearnDataset -> id
+  #datasetId = 0
+  #closed = false
+  #stats = { messages: 0, fits: 0, predicts: 0, batches: 0, datasets: 0 }
+
+  // opts.workers: pool size (default 1). opts.coalesceMs: hold the first
+  // request of an idle worker's next message this long so concurrent
+  // calls land in one batch (default 0). opts.workerUrl: worker script
+  // (browsers: the dist/xlearn-worker.js bundle). opts.loadOptions:
+  // passed to loadXLearn() in each worker.
+  constructor(opts = {}) {
+    const { workers = 1, coalesceMs = 0, workerUrl = null, loadOptions = {} } = opts
+    if (!(workers >= 1)) throw new Error('XLearnEngine: workers must be >= 1')
+    this.#opts = { workers, coalesceMs, workerUrl, loadOptions }
+  }
+
+  static create(opts = {}) {
+    return new XLearnEngine(opts)
+  }
+
+  // Shared engine used when fitAsync/predictAsync get no opts.engine
+  static default() {
+    if (!defaultEngine || defaultEngine.closed) defaultEngine = new XLearnEngine()
+    return defaultEngine
+  }
+
+  get closed() { return this.#closed }
+  get size() { return this.#opts.workers }
+
+  // { messages, fits, predicts, batches, datasets }: predicts - batches
+  // calls were scored together with another one; datasets counts
+  // datasets shipped to a worker
+  get stats() { return { ...this.#stats } }
+
+  // Workers spawn lazily; a key stays on the worker it was first sent to
+  #workerFor(key) {
+    if (this.#closed) throw new Error('XLearnEngine: engine was terminated')
+    const pinned = this.#models.get(key)
+    if (pinned) return pinned.worker
+    if (this.#workers.length < this.#opts.workers) {
+      this.#workers.push(this.#spawn())
+    }
+    const worker = this.#workers[this.#next++ % this.#workers.length]
+    this.#models.set(key, { worker, generation: -1 })
+    return worker
+  }
+
+  #spawn() {
+    const port = spawn(this.#opts.workerUrl)
+    const worker = {
+      port, queue: [], transfer: new Set(), pending: new Map(), busy: false, timer: null,
+      datasets: new Set() // ids of the datasets it has loaded
+    }
+    port.onMessage((msg) => this.#receive(worker, msg))
+    port.onError((err) => this.#drop(worker, err))
+    port.post({ op: 'init', options: this.#opts.loadOptions })
+    port.unref()
+    return worker
+  }
+
+  // A worker that raised 'error' has exited: fail its jobs and forget it
+  // and its keys, so the next call for a key spawns a replacement and
+  // ships the model bytes again
+  #drop(worker, err) {
+    const i = this.#workers.indexOf(worker)
+    if (i >= 0) this.#workers.splice(i, 1)
+    for (const [key, pinned] of this.#models) {
+      if (pinned.worker === worker) this.#models.delete(key)
+    }
+    if (worker.timer && worker.timer !== true) clearTimeout(worker.timer)
+    worker.timer = null
+    for (const job of worker.pending.values()) job.reject(err)
+    worker.pending.clear()
+    for (const job of worker.queue) job.reject(err)
+    worker.queue = []
+    worker.busy = false
+    worker.port.terminate()
+  }
+
+  #enqueue(worker, job, buffers) {
+    if (this.#closed) throw new Error('XLearnEngine: engine was terminated')
+    job.id = ++this.#jobId
+    const done = new Promise((resolve, reject) => {
+      job.resolve = resolve
+      job.reject = reject
+    })
+    worker.queue.push(job)
+    for (const b of buffers) worker.transfer.add(b)
+    this.#schedule(worker)
+    return done
+  }
+
+  #schedule(worker) {
+    if (worker.busy || worker.timer || worker.queue.length === 0) return
+    const go = () => { worker.timer = null; this.#flush(worker) }
+    if (this.#opts.coalesceMs > 0) {
+      worker.timer = setTimeout(go, this.#opts.coalesceMs)
+    } else {
+      worker.timer = true
+      queueMicrotask(go)
+    }
+  }
+
+  // Send everything queued for a worker as one message
+  #flush(worker) {
+    if (worker.busy || worker.queue.length === 0) return
+    const queue = worker.queue
+    const transfer = [...worker.transfer]
+    worker.queue = []
+    worker.transfer = new Set()
+    worker.busy = true
+
+    const jobs = []
+    for (const job of queue) {
+      const { resolve, reject, ...msg } = job
+      if (!job.dispose) worker.pending.set(job.id, job)
+      jobs.push(msg)
+    }
+    this.#stats.messages++
+    worker.port.ref()
+    worker.port.post({ op: 'run', jobs }, transfer)
+  }
+
+  #receive(worker, msg) {
+    for (const r of msg.results) {
+      const job = worker.pending.get(r.id)
+      if (!job) continue
+      worker.pending.delete(r.id)
+      if (r.error) job.reject(new Error(`${job.op} failed: ${r.error}`))
+      else job.resolve(r.value)
+    }
+    this.#stats.batches += msg.batches || 0
+    worker.busy = false
+    if (worker.queue.length) this.#schedule(worker)
+    else worker.port.unref()
+  }
+
+  // --- Used by XLearnBase ---
+
+  // Fit a fresh typeId model on the key's worker, which keeps it;
+  // resolves to { bytes, bestEpoch } with bytes its save() bundle
+  _fit(key, typeId, params, X, y, opts = {}) {
+    const { transfer = false, validation = null, ...fitOpts } = opts
+    const buffers = new Set()
+    const job = {
+      op: 'fit', key, typeId, params,
+      X: packInput(X, transfer, buffers),
+      y: packLabels(y, transfer, buffers),
+      opts: fitOpts
+    }
+    if (validation) {
+      job.validation = [
+        packInput(validation[0], transfer, buffers),
+        packLabels(validation[1], transfer, buffers)
+      ]
+    }
+    if (fitOpts.sampleWeight != null) {
+      fitOpts.sampleWeight = typed(fitOpts.sampleWeight, Float32Array, transfer)
+      buffers.add(fitOpts.sampleWeight.buffer)
+    }
+    const worker = this.#workerFor(key)
+    this.#models.get(key).generation = -1
+    this.#stats.fits++
+    return this.#enqueue(worker, job, buffers)
+  }
+
+  // Fit a fresh typeId model on dataset (an XLearnDataset) on the key's
+  // worker; resolves as _fit(). The dataset's bytes go along only when
+  // that worker has not loaded it yet
+  _fitDataset(key, typeId, params, dataset, opts = {}) {
+    const { transfer = false, validation = null, ...fitOpts } = opts
+    const buffers = new Set()
+    let id = this.#datasets.get(dataset)
+    if (!id) {
+      id = ++this.#datasetId
+      this.#datasets.set(dataset, id)
+    }
+    const job = { op: 'fitDataset', key, typeId, params, dataset: id, opts: fitOpts }
+    if (validation) {
+      job.validation = [
+        packInput(validation[0], transfer, buffers),
+        packLabels(validation[1], transfer, buffers)
+      ]
+    }
+    const worker = this.#workerFor(key)
+    if (!worker.datasets.has(id)) {
+      job.datasetBytes = dataset.save()
+      buffers.add(job.datasetBytes.buffer)
+      worker.datasets.add(id)
+      this.#stats.datasets++
+    }
+    this.#models.get(key).generation = -1
+    this.#stats.fits++
+    const done = this.#enqueue(worker, job, buffers)
+    if (job.datasetBytes) done.catch(() => worker.datasets.delete(id))
+    return done
+  }
+
+  // Free the workers' copies of dataset; a later fitDatasetAsync() on it
+  // ships it again
+  releaseDataset(dataset) {
+    const id = this.#datasets.get(dataset)
+    if (!id || this.#closed) return
+    this.#datasets.delete(dataset)
+    for (const worker of this.#workers) {
+      if (!worker.datasets.delete(id)) continue
+      this.#enqueue(worker, { op: 'releaseDataset', dataset: id, dispose: true }, []).catch(() => {})
+    }
+  }
+
+  // The key's worker holds the model as of generation
+  _sync(key, generation) {
+    const pinned = this.#models.get(key)
+    if (pinned) pinned.generation = generation
+  }
+
+  // Score X against the key's model; getBytes() supplies the model's
+  // bundle when the worker does not hold this generation yet
+  _predict(key, generation, getBytes, X, opts = {}) {
+    const buffers = new Set()
+    const worker = this.#workerFor(key)
+    const pinned = this.#models.get(key)
+    const job = { op: 'predict', key, X: packInput(X, opts.transfer, buffers) }
+    if (pinned.generation !== generation) {
+      job.bytes = getBytes()
+      pinned.generation = generation
+    }
+    this.#stats.predicts++
+    const done = this.#enqueue(worker, job, buffers)
+    if (job.bytes) {
+      done.catch(() => { if (pinned.generation === generation) pinned.generation = -1 })
+    }
+    return done
+  }
+
+  // Drop the key's model from its worker
+  _release(key) {
+    const pinned = this.#models.get(key)
+    if (!pinned || this.#closed) return
+    this.#models.delete(key)
+    this.#enqueue(pinned.worker, { op: 'dispose', key, dispose: true }, []).catch(() => {})
+  }
+
+  // Stop all workers; queued and running requests reject
+  async terminate() {
+    if (this.#closed) return
+    this.#closed = true
+    const err = new Error('XLearnEngine: engine was terminated')
+    for (const worker of this.#workers) {
+      if (worker.timer && worker.timer !== true) clearTimeout(worker.timer)
+      for (const job of worker.queue) job.reject(err)
+      for (const job of worker.pending.values()) job.reject(err)
+      worker.queue = []
+      worker.pending.clear()
+    }
+    await Promise.all(this.#workers.map(w => w.port.terminate()))
+    this.#workers = []
+    this.#models.clear()
+  }
+}
+
+module.exports = { XLearnEngine }
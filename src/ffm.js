@@ -10,6 +10,10 @@ class XLearnFFMClassifier extends XLearnBase {
     return XLearnBase._load(bytes, XLearnFFMClassifier)
   }
 
+  static async loadPaged(source, opts = {}) {
+    return XLearnBase._loadPaged(source, opts, XLearnFFMClassifier)
+  }
+
   static async _fromBundle(manifest, toc, blobs) {
     return XLearnBase._fromBundle(manifest, toc, blobs, XLearnFFMClassifier)
   }
@@ -19,8 +23,8 @@ class XLearnFFMClassifier extends XLearnBase {
   get capabilities() {
     return {
       classifier: true, regressor: false, predictProba: true,
-      decisionFunction: true, sampleWeight: false, csr: true,
-      earlyStopping: false
+      decisionFunction: true, sampleWeight: true, csr: true,
+      earlyStopping: true
     }
   }
 
@@ -44,6 +48,10 @@ class XLearnFFMRegressor extends XLearnBase {
     return XLearnBase._load(bytes, XLearnFFMRegressor)
   }
 
+  static async loadPaged(source, opts = {}) {
+    return XLearnBase._loadPaged(source, opts, XLearnFFMRegressor)
+  }
+
   static async _fromBundle(manifest, toc, blobs) {
     return XLearnBase._fromBundle(manifest, toc, blobs, XLearnFFMRegressor)
   }
@@ -53,8 +61,8 @@ class XLearnFFMRegressor extends XLearnBase {
   get capabilities() {
     return {
       classifier: false, regressor: true, predictProba: false,
-      decisionFunction: true, sampleWeight: false, csr: true,
-      earlyStopping: false
+      decisionFunction: true, sampleWeight: true, csr: true,
+      earlyStopping: true
     }
   }
 
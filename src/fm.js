@@ -10,6 +10,10 @@ class XLearnFMClassifier extends XLearnBase {
     return XLearnBase._load(bytes, XLearnFMClassifier)
   }
 
+  static async loadPaged(source, opts = {}) {
+    return XLearnBase._loadPaged(source, opts, XLearnFMClassifier)
+  }
+
   static async _fromBundle(manifest, toc, blobs) {
     return XLearnBase._fromBundle(manifest, toc, blobs, XLearnFMClassifier)
   }
@@ -19,8 +23,8 @@ class XLearnFMClassifier extends XLearnBase {
   get capabilities() {
     return {
       classifier: true, regressor: false, predictProba: true,
-      decisionFunction: true, sampleWeight: false, csr: true,
-      earlyStopping: false
+      decisionFunction: true, sampleWeight: true, csr: true,
+      earlyStopping: true
     }
   }
 
@@ -44,6 +48,10 @@ class XLearnFMRegressor extends XLearnBase {
     return XLearnBase._load(bytes, XLearnFMRegressor)
   }
 
+  static async loadPaged(source, opts = {}) {
+    return XLearnBase._loadPaged(source, opts, XLearnFMRegressor)
+  }
+
   static async _fromBundle(manifest, toc, blobs) {
     return XLearnBase._fromBundle(manifest, toc, blobs, XLearnFMRegressor)
   }
@@ -53,8 +61,8 @@ class XLearnFMRegressor extends XLearnBase {
   get capabilities() {
     return {
       classifier: false, regressor: true, predictProba: false,
-      decisionFunction: true, sampleWeight: false, csr: true,
-      earlyStopping: false
+      decisionFunction: true, sampleWeight: true, csr: true,
+      earlyStopping: true
     }
   }
 
@@ -1,15 +1,27 @@
-const { loadXLearn, getWasm } = require('./wasm.js')
+const { loadXLearn, getWasm, isThreaded } = require('./wasm.js')
 const { XLearnLRClassifier, XLearnLRRegressor } = require('./lr.js')
 const { XLearnFMClassifier, XLearnFMRegressor } = require('./fm.js')
 const { XLearnFFMClassifier, XLearnFFMRegressor } = require('./ffm.js')
+const { XLearnBase, XLearnDataset, XLearnBatch, hashToken, hashRows } = require('./base.js')
+const { XLearnEngine } = require('./engine.js')
 const { createModelClass } = require('@wlearn/core')
 
 const XLearnLR = createModelClass(XLearnLRClassifier, XLearnLRRegressor, { name: 'XLearnLR', load: loadXLearn })
 const XLearnFM = createModelClass(XLearnFMClassifier, XLearnFMRegressor, { name: 'XLearnFM', load: loadXLearn })
 const XLearnFFM = createModelClass(XLearnFFMClassifier, XLearnFFMRegressor, { name: 'XLearnFFM', load: loadXLearn })
 
+// Score one input against several fitted models
+const predictMany = (models, X) => XLearnBase.predictMany(models, X)
+
+// Module-wide heap accounting and the prepared-model budget
+const memoryUsage = () => XLearnBase.memoryUsage()
+const setHeapBudget = (bytes) => XLearnBase.setHeapBudget(bytes)
+
 module.exports = {
-  loadXLearn, getWasm,
+  loadXLearn, getWasm, isThreaded, predictMany, XLearnDataset, XLearnBatch,
+  memoryUsage, setHeapBudget,
+  XLearnEngine,
+  hashToken, hashRows,
   // Unified classes (recommended)
   XLearnLR, XLearnFM, XLearnFFM,
   // Original split classes (backward compat)
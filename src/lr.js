@@ -10,6 +10,10 @@ class XLearnLRClassifier extends XLearnBase {
     return XLearnBase._load(bytes, XLearnLRClassifier)
   }
 
+  static async loadPaged(source, opts = {}) {
+    return XLearnBase._loadPaged(source, opts, XLearnLRClassifier)
+  }
+
   static async _fromBundle(manifest, toc, blobs) {
     return XLearnBase._fromBundle(manifest, toc, blobs, XLearnLRClassifier)
   }
@@ -19,8 +23,8 @@ class XLearnLRClassifier extends XLearnBase {
   get capabilities() {
     return {
       classifier: true, regressor: false, predictProba: true,
-      decisionFunction: true, sampleWeight: false, csr: true,
-      earlyStopping: false
+      decisionFunction: true, sampleWeight: true, csr: true,
+      earlyStopping: true
     }
   }
 
@@ -43,6 +47,10 @@ class XLearnLRRegressor extends XLearnBase {
     return XLearnBase._load(bytes, XLearnLRRegressor)
   }
 
+  static async loadPaged(source, opts = {}) {
+    return XLearnBase._loadPaged(source, opts, XLearnLRRegressor)
+  }
+
   static async _fromBundle(manifest, toc, blobs) {
     return XLearnBase._fromBundle(manifest, toc, blobs, XLearnLRRegressor)
   }
@@ -52,8 +60,8 @@ class XLearnLRRegressor extends XLearnBase {
   get capabilities() {
     return {
       classifier: false, regressor: true, predictProba: false,
-      decisionFunction: true, sampleWeight: false, csr: true,
-      earlyStopping: false
+      decisionFunction: true, sampleWeight: true, csr: true,
+      earlyStopping: true
     }
   }
 
@@ -1,15 +1,98 @@
 // WASM loader -- loads the xLearn WASM module (singleton, lazy init)
+//
+// Two builds ship in wasm/: xlearn.js (single-threaded) and xlearn-mt.js
+// (Emscripten pthreads). The threaded build needs SharedArrayBuffer,
+// which browsers only expose on cross-origin isolated pages.
+//
+// Optional variants (VARIANTS=... npm run build) are separate
+// single-threaded wasm/xlearn-<name>.js + .wasm pairs, whose binary is
+// fetched and compiled with WebAssembly.instantiateStreaming in browsers.
 
 let wasmModule = null
 let loading = null
+let threaded = false
 
+// speed: -O3 -flto; infer: inference only; lr/fm/ffm: one model type
+const VARIANTS = ['speed', 'infer', 'lr', 'fm', 'ffm']
+
+function requireVariant(variant) {
+  if (!VARIANTS.includes(variant)) {
+    throw new Error(`unknown xLearn build variant '${variant}' (${VARIANTS.join(', ')})`)
+  }
+  // Not a literal: bundlers must not inline the variant's glue
+  const file = '../wasm/xlearn-' + variant + '.js'
+  try {
+    return require(file)
+  } catch (err) {
+    throw new Error(`xLearn variant '${variant}' unavailable (VARIANTS=${variant} npm run build, or pass factory): ${err.message}`)
+  }
+}
+
+// wasm/ is not tracked: it is produced by npm run build (and prepack).
+// A build from before the current exports would fail on first use, so
+// check for the newest ones up front.
+const REQUIRED_EXPORTS = ['_wl_xl_load_model', '_wl_xl_scratch_alloc', '_wl_xl_evaluate', '_wl_xl_set_neg_sampling']
+
+function checkExports(mod) {
+  const missing = REQUIRED_EXPORTS.filter(name => typeof mod[name] !== 'function')
+  if (missing.length) {
+    throw new Error(`xLearn WASM build is out of date (missing ${missing.join(', ')}); run npm run build`)
+  }
+}
+
+function requireBuild(file) {
+  try {
+    return require(file)
+  } catch (err) {
+    throw new Error(`xLearn WASM build not found (${err.message}); run npm run build`)
+  }
+}
+
+function threadsAvailable() {
+  if (typeof SharedArrayBuffer === 'undefined') return false
+  if (typeof crossOriginIsolated !== 'undefined') return crossOriginIsolated === true
+  return true // Node.js
+}
+
+// options.threads: 'auto' (default) picks xlearn-mt.js when threads are
+// available, true requires it, false forces the single-threaded build.
+// options.verbose: let upstream's progress output through (muted by
+// default). options.variant: load one of VARIANTS instead (single-threaded).
+// options.factory: an already loaded Emscripten factory (createXLearn from
+// a variant's script tag in browsers). Remaining options are passed to the
+// Emscripten module factory.
 async function loadXLearn(options = {}) {
   if (wasmModule) return wasmModule
   if (loading) return loading
 
   loading = (async () => {
-    const createXLearn = require('../wasm/xlearn.js')
-    wasmModule = await createXLearn(options)
+    const { threads = 'auto', verbose = false, variant = null, factory = null, ...moduleOptions } = options
+    if (factory || variant) {
+      if (variant && threads === true) throw new Error('xLearn build variants are single-threaded')
+      const mod = await (factory || requireVariant(variant))(moduleOptions)
+      // A pthreads factory runs on shared memory
+      threaded = typeof SharedArrayBuffer !== 'undefined' && mod.HEAPU8.buffer instanceof SharedArrayBuffer
+      checkExports(mod)
+      if (verbose) mod._wl_xl_set_verbose(1)
+      wasmModule = mod
+      return wasmModule
+    }
+    let createXLearn = null
+    if (threads === true || (threads === 'auto' && threadsAvailable())) {
+      try {
+        createXLearn = require('../wasm/xlearn-mt.js')
+      } catch (err) {
+        if (threads === true) {
+          throw new Error(`Threaded xLearn build unavailable: ${err.message}`)
+        }
+      }
+    }
+    threaded = createXLearn !== null
+    if (!createXLearn) createXLearn = requireBuild('../wasm/xlearn.js')
+    const mod = await createXLearn(moduleOptions)
+    checkExports(mod)
+    if (verbose) mod._wl_xl_set_verbose(1)
+    wasmModule = mod
     return wasmModule
   })()
 
@@ -21,4 +104,10 @@ function getWasm() {
   return wasmModule
 }
 
-module.exports = { loadXLearn, getWasm }
+// Whether the loaded module is the pthreads build
+function isThreaded() {
+  getWasm()
+  return threaded
+}
+
+module.exports = { loadXLearn, getWasm, isThreaded }
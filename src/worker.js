@@ -0,0 +1,194 @@
+// Worker side of XLearnEngine (src/engine.js)
+//
+// Holds one WASM module and the models pinned to this worker by key.
+// Each 'run' message carries a list of jobs; consecutive predicts
+// against one model are concatenated and scored as one batch, and the
+// outputs go back (transferred) as views of one buffer per batch.
+
+const { decodeBundle } = require('@wlearn/core')
+const lib = require('./index.js')
+
+const port = (() => {
+  try {
+    const { parentPort } = require('worker_threads')
+    if (parentPort) {
+      return { post: (m, t) => parentPort.postMessage(m, t), on: (fn) => parentPort.on('message', fn) }
+    }
+  } catch {}
+  return { post: (m, t) => self.postMessage(m, t), on: (fn) => { self.onmessage = (e) => fn(e.data) } }
+})()
+
+// typeId -> split class
+const CLASSES = new Map()
+for (const name of ['LR', 'FM', 'FFM']) {
+  for (const task of ['Classifier', 'Regressor']) {
+    const Cls = lib[`XLearn${name}${task}`]
+    const typeId = Object.getOwnPropertyDescriptor(Cls.prototype, '_typeId').get.call(null)
+    CLASSES.set(typeId, Cls)
+  }
+}
+
+const models = new Map()
+const datasets = new Map() // engine's dataset id -> XLearnDataset
+let ready = null
+let chain = Promise.resolve()
+
+function setModel(key, model) {
+  const old = models.get(key)
+  if (old && old !== model) old.dispose()
+  models.set(key, model)
+}
+
+function inputKind(X) {
+  if (X.hashes) return 'hashed'
+  if (X.indices) return 'csr'
+  return 'dense'
+}
+
+// Concatenate same-kind packed inputs row-wise
+function concatInputs(inputs) {
+  if (inputs.length === 1) return inputs[0]
+  const kind = inputKind(inputs[0])
+  const rows = inputs.reduce((n, X) => n + X.rows, 0)
+  if (kind === 'dense') {
+    const data = new Float32Array(inputs.reduce((n, X) => n + X.data.length, 0))
+    let off = 0
+    for (const X of inputs) { data.set(X.data, off); off += X.data.length }
+    return { data, rows, cols: inputs[0].cols }
+  }
+  const arrays = kind === 'csr' ? ['data', 'indices'] : ['fields', 'hashes', 'values']
+  const nnz = inputs.reduce((n, X) => n + X.indptr[X.rows], 0)
+  const out = { rows, indptr: new Int32Array(rows + 1) }
+  if (kind === 'csr') out.cols = Math.max(...inputs.map(X => X.cols))
+  for (const name of arrays) {
+    const Type = inputs[0][name] ? inputs[0][name].constructor : Float32Array
+    out[name] = new Type(nnz)
+    if (name === 'values') out[name].fill(1)
+  }
+  let r = 0
+  let k = 0
+  for (const X of inputs) {
+    const n = X.indptr[X.rows]
+    for (let i = 1; i <= X.rows; i++) out.indptr[r + i] = k + X.indptr[i]
+    for (const name of arrays) {
+      if (X[name]) out[name].set(X[name].subarray(0, n), k)
+    }
+    r += X.rows
+    k += n
+  }
+  if (kind === 'hashed' && !inputs.some(X => X.values)) out.values = null
+  return out
+}
+
+// Inputs that can be scored together: same model and input kind, and
+// same width for dense
+function sameBatch(a, b) {
+  if (a.key !== b.key || b.bytes) return false
+  const ka = inputKind(a.X)
+  if (ka !== inputKind(b.X)) return false
+  return ka !== 'dense' || a.X.cols === b.X.cols
+}
+
+function loadModel(bytes) {
+  const { manifest, toc, blobs } = decodeBundle(bytes)
+  const Cls = CLASSES.get(manifest.typeId)
+  if (!Cls) throw new Error(`unknown model type ${manifest.typeId}`)
+  return Cls._fromBundle(manifest, toc, blobs)
+}
+
+// Bytes as a Uint8Array that owns its whole buffer (transferable)
+function owned(bytes) {
+  return bytes.byteOffset === 0 && bytes.byteLength === bytes.buffer.byteLength
+    ? bytes : bytes.slice()
+}
+
+// Train a fresh job.typeId model with train(model, opts) and keep it
+async function fit(job, train) {
+  const Cls = CLASSES.get(job.typeId)
+  if (!Cls) throw new Error(`unknown model type ${job.typeId}`)
+  const model = await Cls.create(job.params)
+  try {
+    const opts = job.validation ? { ...job.opts, validation: job.validation } : job.opts
+    train(model, opts)
+  } catch (e) {
+    model.dispose()
+    throw e
+  }
+  setModel(job.key, model)
+  return { bytes: owned(model.save()), bestEpoch: model.bestEpoch }
+}
+
+// The job's dataset, loaded from the bytes the first job for it carries
+async function dataset(job) {
+  if (job.datasetBytes) {
+    const old = datasets.get(job.dataset)
+    if (old) old.dispose()
+    datasets.delete(job.dataset)
+    datasets.set(job.dataset, await lib.XLearnDataset.load(job.datasetBytes))
+  }
+  const ds = datasets.get(job.dataset)
+  if (!ds) throw new Error('dataset is not loaded in this worker')
+  return ds
+}
+
+async function run(jobs) {
+  const results = []
+  const transfer = []
+  let batches = 0
+  for (let i = 0; i < jobs.length; i++) {
+    const job = jobs[i]
+    if (job.op === 'predict') {
+      let end = i + 1
+      while (end < jobs.length && jobs[end].op === 'predict' && sameBatch(job, jobs[end])) end++
+      const group = jobs.slice(i, end)
+      i = end - 1
+      batches++
+      try {
+        if (job.bytes) setModel(job.key, await loadModel(job.bytes))
+        const model = models.get(job.key)
+        if (!model) throw new Error('model is not loaded in this worker')
+        const out = model.predict(concatInputs(group.map(g => g.X)))
+        transfer.push(out.buffer)
+        let off = 0
+        for (const g of group) {
+          results.push({ id: g.id, value: out.subarray(off, off + g.X.rows) })
+          off += g.X.rows
+        }
+      } catch (e) {
+        for (const g of group) results.push({ id: g.id, error: e.message })
+      }
+      continue
+    }
+    try {
+      if (job.op === 'fit' || job.op === 'fitDataset') {
+        const ds = job.op === 'fitDataset' ? await dataset(job) : null
+        const value = await fit(job, ds
+          ? (model, opts) => model.fitDataset(ds, opts)
+          : (model, opts) => model.fit(job.X, job.y, opts))
+        transfer.push(value.bytes.buffer)
+        results.push({ id: job.id, value })
+      } else if (job.op === 'releaseDataset') {
+        const ds = datasets.get(job.dataset)
+        if (ds) ds.dispose()
+        datasets.delete(job.dataset)
+      } else if (job.op === 'dispose') {
+        const model = models.get(job.key)
+        if (model) model.dispose()
+        models.delete(job.key)
+      }
+    } catch (e) {
+      results.push({ id: job.id, error: e.message })
+    }
+  }
+  port.post({ results, batches }, transfer)
+}
+
+port.on((msg) => {
+  if (msg.op === 'init') {
+    ready = lib.loadXLearn(msg.options || {})
+    return
+  }
+  chain = chain.then(() => ready).then(() => run(msg.jobs), (e) => {
+    port.post({ results: msg.jobs.map(j => ({ id: j.id, error: e.message })), batches: 0 })
+  })
+})
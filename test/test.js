@@ -79,13 +79,89 @@ function toCSR(X) {
   }
 }
 
+// Parse an xLearn model blob (upstream binary layout, wasm32 size_t)
+function parseModelBlob(bytes) {
+  const dv = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength)
+  let pos = 0
+  const u32 = () => { const v = dv.getUint32(pos, true); pos += 4; return v }
+  const str = () => {
+    const len = u32()
+    const s = new TextDecoder().decode(bytes.subarray(pos, pos + len))
+    pos += len
+    return s
+  }
+  const f32s = (n) => {
+    const out = new Float64Array(n)
+    for (let i = 0; i < n; i++) { out[i] = dv.getFloat32(pos, true); pos += 4 }
+    return out
+  }
+  const score = str()
+  const loss = str()
+  const numFeat = u32(), numField = u32(), k = u32(), aux = u32()
+  const w = f32s(u32())
+  const v = f32s(u32())
+  const b = f32s(aux)
+  return { score, loss, numFeat, numField, k, aux, w, v, b }
+}
+
+// Scalar float64 reference for linear / FM / FFM scores (upstream layout:
+// 4-float latent chunks, each followed by its optimizer state)
+function refScore(m, x, fields) {
+  let sq = 0
+  const nodes = []
+  for (let j = 0; j < x.length; j++) {
+    if (x[j] === 0) continue
+    nodes.push({ j, f: fields ? fields[j] : 0, x: x[j] })
+    sq += x[j] * x[j]
+  }
+  const norm = sq > 0 ? 1 / sq : 1
+
+  let score = m.b[0]
+  for (const n of nodes) score += m.w[n.j * m.aux] * n.x
+  if (m.score === 'linear') return score
+
+  const alignedK = Math.ceil(m.k / 4) * 4
+  const align0 = alignedK * m.aux
+  const idx = (d) => Math.floor(d / 4) * 4 * m.aux + (d % 4)
+
+  if (m.score === 'fm') {
+    let pair = 0
+    for (let d = 0; d < alignedK; d++) {
+      let s = 0, s2 = 0
+      for (const n of nodes) {
+        const vx = m.v[n.j * align0 + idx(d)] * n.x
+        s += vx
+        s2 += vx * vx
+      }
+      pair += s * s - s2
+    }
+    return score + 0.5 * norm * pair
+  }
+
+  const align1 = m.numField * align0
+  for (let a = 0; a < nodes.length; a++) {
+    for (let c = a + 1; c < nodes.length; c++) {
+      const n1 = nodes[a], n2 = nodes[c]
+      let dot = 0
+      for (let d = 0; d < alignedK; d++) {
+        dot += m.v[n1.j * align1 + n2.f * align0 + idx(d)] *
+          m.v[n2.j * align1 + n1.f * align0 + idx(d)]
+      }
+      score += norm * n1.x * n2.x * dot
+    }
+  }
+  return score
+}
+
 async function main() {
 
 const {
   loadXLearn,
   XLearnLRClassifier, XLearnLRRegressor,
   XLearnFMClassifier, XLearnFMRegressor,
-  XLearnFFMClassifier, XLearnFFMRegressor
+  XLearnFFMClassifier, XLearnFFMRegressor,
+  predictMany, XLearnDataset, XLearnBatch, XLearnEngine, hashToken, hashRows,
+  memoryUsage, setHeapBudget
 } = require('../src/index.js')
 
 // ============================================================
@@ -106,6 +182,27 @@ await test('get_last_error returns string', async () => {
   assert(typeof err === 'string', `expected string, got ${typeof err}`)
 })
 
+await test('isThreaded reports the loaded build', async () => {
+  const { isThreaded } = require('../src/index.js')
+  const wasm = await loadXLearn()
+  const t = isThreaded()
+  assert(typeof t === 'boolean', `expected boolean, got ${typeof t}`)
+  const max = wasm._wl_xl_max_threads()
+  assert(t ? max >= 1 : max === 1, `max_threads=${max} threaded=${t}`)
+})
+
+await test('nthread / lockFree params are accepted', async () => {
+  const m = await XLearnFMClassifier.create({ epoch: 10, k: 4, nthread: 4, lockFree: true })
+  const { X, y } = makeLinearData(200)
+  m.fit(X, y)
+  const preds = m.predict(X)
+  for (let i = 0; i < preds.length; i++) {
+    assert(!isNaN(preds[i]), `prediction ${i} is NaN`)
+  }
+  assert(m.score(X, y) > 0.6, 'accuracy too low')
+  m.dispose()
+})
+
 // ============================================================
 // LR Classifier
 // ============================================================
@@ -521,6 +618,26 @@ await test('CSR input: FFM with featureFields', async () => {
   m.dispose()
 })
 
+await test('CSR input: empty rows and all-zero dense rows agree', async () => {
+  const { X, y } = makeLinearData(40)
+  X[3] = [0, 0]
+  X[17] = [0, 0]
+  const csr = toCSR(X)
+  assert(csr.indptr[3] === csr.indptr[4], 'row 3 should be empty')
+
+  const m = await XLearnFMClassifier.create({ epoch: 5, k: 4 })
+  m.fit(csr, y)
+
+  const pDense = m.predict(X)
+  const pCSR = m.predict(csr)
+  for (let i = 0; i < pDense.length; i++) {
+    assert(!isNaN(pCSR[i]), `prediction ${i} is NaN`)
+    assert(pDense[i] === pCSR[i], `pred ${i}: ${pDense[i]} !== ${pCSR[i]}`)
+  }
+
+  m.dispose()
+})
+
 // ============================================================
 // Registry dispatch
 // ============================================================
@@ -802,6 +919,1717 @@ await test('separate training runs produce similar predictions', async () => {
   assert(s1 === s2, `scores should match: ${s1} !== ${s2}`)
 })
 
+// ============================================================
+// Score kernels
+// ============================================================
+console.log('\n=== Score Kernels ===')
+
+function makeWideData(n, cols) {
+  const X = []
+  const y = []
+  for (let i = 0; i < n; i++) {
+    const row = []
+    for (let j = 0; j < cols; j++) {
+      const t = ((i * (7 + j) + 3 * j) % 11) / 11
+      row.push(t > 0.6 ? 0 : t * 2 - 0.5)
+    }
+    X.push(row)
+    y.push(row[0] + row[1] - row[2] > 0 ? 1 : 0)
+  }
+  return { X, y }
+}
+
+// The upstream model blob inside m's save() bundle, as bytes / parsed
+function rawModelBlob(m) {
+  const { toc, blobs } = decodeBundle(m.save())
+  const e = toc.find(t => t.id === 'model')
+  return blobs.subarray(e.offset, e.offset + e.length)
+}
+
+function modelBlob(m) {
+  return parseModelBlob(rawModelBlob(m))
+}
+
+for (const [name, Cls, params] of [
+  ['LR', XLearnLRClassifier, { epoch: 5 }],
+  ['FM k=3', XLearnFMClassifier, { epoch: 5, k: 3 }],
+  ['FM k=8 ftrl', XLearnFMClassifier, { epoch: 5, k: 8, opt: 'ftrl' }],
+  ['FFM k=4', XLearnFFMClassifier, { epoch: 5, k: 4, featureFields: new Int32Array([0, 0, 1, 1, 2, 2]) }],
+  ['FFM k=6 sgd', XLearnFFMClassifier, { epoch: 5, k: 6, opt: 'sgd', featureFields: new Int32Array([0, 1, 2, 0, 1, 2]) }]
+]) {
+  await test(`${name}: kernel scores match scalar reference`, async () => {
+    const m = await Cls.create(params)
+    const { X, y } = makeWideData(50, 6)
+    m.fit(X, y)
+
+    const preds = m.predict(X)
+    const blob = modelBlob(m)
+    for (let i = 0; i < X.length; i++) {
+      const ref = refScore(blob, X[i], params.featureFields)
+      assertClose(preds[i], ref, 1e-4 * (1 + Math.abs(ref)), `row ${i}: ${preds[i]} vs ${ref}`)
+    }
+
+    m.dispose()
+  })
+}
+
+// ============================================================
+// Error state
+// ============================================================
+console.log('\n=== Error State ===')
+
+await test('a failed call does not leave its error on later calls', async () => {
+  const { getWasm } = require('../src/wasm.js')
+  const wasm = getWasm()
+  const m = await XLearnLRClassifier.create({ epoch: 2 })
+  let threw = false
+  try { m.fit([[1, 2]], [0, 1]) } catch (e) { threw = /does not match/.test(e.message) }
+  assert(threw, 'mismatched fit should throw')
+  assert(wasm._wl_xl_dmatrix_retain(0) === -1, 'null retain fails')
+  const lastError = () => wasm.ccall('wl_xl_get_last_error', 'string', [], [])
+  assert(lastError().includes('null argument'), 'error is set')
+  const { X, y } = makeLinearData(40)
+  m.fit(X, y)
+  m.predict(X)
+  assert(lastError() === '', 'success clears the error')
+  assert(typeof wasm._wl_xl_set_verbose === 'function', 'set_verbose exported')
+  m.dispose()
+})
+
+// ============================================================
+// Prepared model
+// ============================================================
+console.log('\n=== Prepared Model ===')
+
+await test('prepared model matches MEMFS predict path', async () => {
+  const { getWasm } = require('../src/wasm.js')
+  const wasm = getWasm()
+
+  const m = await XLearnFFMClassifier.create({
+    epoch: 10, k: 4, featureFields: new Int32Array([0, 1])
+  })
+  const { X, y } = makeLinearData(60)
+  m.fit(X, y)
+  const p1 = m.predict(X)
+
+  // Legacy path: model bytes are written to MEMFS and re-parsed per call
+  const modelBytes = rawModelBlob(m)
+
+  const xF32 = new Float32Array(X.flat())
+  const xPtr = wasm._malloc(xF32.length * 4)
+  wasm.HEAPF32.set(xF32, xPtr / 4)
+  const fPtr = wasm._malloc(8)
+  wasm.setValue(fPtr, 0, 'i32')
+  wasm.setValue(fPtr + 4, 1, 'i32')
+  const outPtr = wasm._malloc(4)
+  assert(wasm._wl_xl_create_dmatrix_dense(xPtr, 60, 2, 0, fPtr, outPtr) === 0, 'dmatrix')
+  const dm = wasm.getValue(outPtr, 'i32')
+
+  const algoPtr = wasm._malloc(4)
+  wasm.HEAPU8.set(new TextEncoder().encode('ffm\0'), algoPtr)
+  assert(wasm._wl_xl_create(algoPtr, outPtr) === 0, 'create')
+  const h = wasm.getValue(outPtr, 'i32')
+
+  const modelPtr = wasm._malloc(modelBytes.length)
+  wasm.HEAPU8.set(modelBytes, modelPtr)
+  const predsPtrPtr = wasm._malloc(4)
+  const lenPtr = wasm._malloc(4)
+  assert(wasm._wl_xl_predict(h, modelPtr, modelBytes.length, dm, predsPtrPtr, lenPtr) === 0, 'predict')
+  const predsPtr = wasm.getValue(predsPtrPtr, 'i32')
+  const p2 = wasm.HEAPF32.slice(predsPtr / 4, predsPtr / 4 + 60)
+
+  wasm._wl_xl_free_buffer(predsPtr)
+  for (const ptr of [xPtr, fPtr, outPtr, algoPtr, modelPtr, predsPtrPtr, lenPtr]) wasm._free(ptr)
+  wasm._wl_xl_free_dmatrix(dm)
+  wasm._wl_xl_free_handle(h)
+
+  for (let i = 0; i < p1.length; i++) {
+    assert(p1[i] === p2[i], `pred ${i}: ${p1[i]} !== ${p2[i]}`)
+  }
+
+  m.dispose()
+})
+
+// Score X through the legacy MEMFS + upstream Solver pipeline
+function memfsPredict(wasm, m, X, algo, fields) {
+  const blob = rawModelBlob(m)
+  const rows = X.length
+  const cols = X[0].length
+  const xPtr = wasm._malloc(rows * cols * 4)
+  wasm.HEAPF32.set(new Float32Array(X.flat()), xPtr / 4)
+  const fPtr = fields ? wasm._malloc(fields.length * 4) : 0
+  if (fPtr) wasm.HEAP32.set(fields, fPtr / 4)
+  const outPtr = wasm._malloc(4)
+  assert(wasm._wl_xl_create_dmatrix_dense(xPtr, rows, cols, 0, fPtr, outPtr) === 0, 'dmatrix')
+  const dm = wasm.getValue(outPtr, 'i32')
+  const algoPtr = wasm._malloc(8)
+  wasm.HEAPU8.set(new TextEncoder().encode(algo + '\0'), algoPtr)
+  assert(wasm._wl_xl_create(algoPtr, outPtr) === 0, 'create')
+  const h = wasm.getValue(outPtr, 'i32')
+  const modelPtr = wasm._malloc(blob.length)
+  wasm.HEAPU8.set(blob, modelPtr)
+  const predsPtrPtr = wasm._malloc(4)
+  const lenPtr = wasm._malloc(4)
+  assert(wasm._wl_xl_predict(h, modelPtr, blob.length, dm, predsPtrPtr, lenPtr) === 0, 'predict')
+  const predsPtr = wasm.getValue(predsPtrPtr, 'i32')
+  const preds = wasm.HEAPF32.slice(predsPtr / 4, predsPtr / 4 + rows)
+  wasm._wl_xl_free_buffer(predsPtr)
+  for (const ptr of [xPtr, fPtr, outPtr, algoPtr, modelPtr, predsPtrPtr, lenPtr]) if (ptr) wasm._free(ptr)
+  wasm._wl_xl_free_dmatrix(dm)
+  wasm._wl_xl_free_handle(h)
+  return preds
+}
+
+await test('specialized scorers match the Solver pipeline bit for bit', async () => {
+  const { getWasm } = require('../src/wasm.js')
+  const wasm = getWasm()
+  const { X, y } = makeWideData(50, 6)
+  const fields = new Int32Array([0, 0, 1, 1, 2, 2])
+  const configs = [
+    ['lr', XLearnLRClassifier, { opt: 'sgd' }],
+    ['fm', XLearnFMClassifier, { k: 3, opt: 'adagrad' }],
+    ['fm', XLearnFMRegressor, { k: 16, opt: 'ftrl' }],
+    ['fm', XLearnFMClassifier, { k: 40 }], // beyond the specialized sizes
+    ['ffm', XLearnFFMClassifier, { k: 8, opt: 'ftrl', featureFields: fields, parallelNnz: 0 }],
+    ['ffm', XLearnFFMRegressor, { k: 5, opt: 'sgd', featureFields: fields, parallelNnz: 0 }]
+  ]
+  for (const [algo, Cls, params] of configs) {
+    const m = await Cls.create({ epoch: 3, ...params })
+    m.fit(X, y)
+    const p1 = m.predict(X)
+    const p2 = memfsPredict(wasm, m, X, algo, params.featureFields)
+    for (let i = 0; i < p1.length; i++) {
+      assert(p1[i] === p2[i], `${algo} k=${params.k}: pred ${i}: ${p1[i]} !== ${p2[i]}`)
+    }
+    m.dispose()
+  }
+})
+
+await test('model bytes round-trip through load unchanged', async () => {
+  const m = await XLearnFMRegressor.create({ epoch: 5, k: 4 })
+  const { X, y } = makeRegressionData(40)
+  m.fit(X, y)
+
+  const blobOf = (bytes) => {
+    const { toc, blobs } = decodeBundle(bytes)
+    const e = toc.find(t => t.id === 'model')
+    return blobs.subarray(e.offset, e.offset + e.length)
+  }
+  const b1 = blobOf(m.save())
+  const m2 = await XLearnFMRegressor.load(m.save())
+  const b2 = blobOf(m2.save())
+
+  assert(b1.length === b2.length, `length ${b1.length} !== ${b2.length}`)
+  for (let i = 0; i < b1.length; i++) {
+    assert(b1[i] === b2[i], `byte ${i} differs`)
+  }
+
+  m.dispose()
+  m2.dispose()
+})
+
+await test('load_model rejects truncated bytes', async () => {
+  const { getWasm } = require('../src/wasm.js')
+  const wasm = getWasm()
+
+  const outPtr = wasm._malloc(4)
+  const algoPtr = wasm._malloc(4)
+  wasm.HEAPU8.set(new TextEncoder().encode('fm\0'), algoPtr)
+  assert(wasm._wl_xl_create(algoPtr, outPtr) === 0, 'create')
+  const h = wasm.getValue(outPtr, 'i32')
+
+  const junk = wasm._malloc(6)
+  wasm.HEAPU8.fill(0xff, junk, junk + 6)
+  const ret = wasm._wl_xl_load_model(h, junk, 6)
+  const err = wasm.ccall('wl_xl_get_last_error', 'string', [], [])
+
+  wasm._free(junk)
+  wasm._free(algoPtr)
+  wasm._free(outPtr)
+  wasm._wl_xl_free_handle(h)
+
+  assert(ret !== 0, 'should fail on truncated model')
+  assert(err.includes('wl_xl_load_model'), `unexpected error: ${err}`)
+})
+
+// ============================================================
+// partialFit
+// ============================================================
+console.log('\n=== partialFit ===')
+
+await test('partialFit continues training on new batches', async () => {
+  const { X, y } = makeLinearData(120)
+  const m = await XLearnFMClassifier.create({ epoch: 1, k: 4 })
+  m.fit(X.slice(0, 40), y.slice(0, 40))
+  const p0 = m.predict(X)
+  const b0 = m.save()
+
+  for (let i = 40; i < 120; i += 40) {
+    m.partialFit(X.slice(i, i + 40), y.slice(i, i + 40), { epoch: 3 })
+  }
+  const p1 = m.predict(X)
+
+  let changed = false
+  for (let i = 0; i < p1.length; i++) {
+    assert(!isNaN(p1[i]), `prediction ${i} is NaN`)
+    if (p1[i] !== p0[i]) changed = true
+  }
+  assert(changed, 'partialFit should update the model')
+  assert(m.score(X, y) > 0.6, 'accuracy too low after partialFit')
+
+  // save() must reflect the updated weights
+  const m2 = await XLearnFMClassifier.load(m.save())
+  const p2 = m2.predict(X)
+  for (let i = 0; i < p1.length; i++) {
+    assert(p1[i] === p2[i], `pred ${i}: ${p1[i]} !== ${p2[i]}`)
+  }
+  assert(b0.length === m.save().length, 'model size should not change')
+
+  m.dispose()
+  m2.dispose()
+})
+
+await test('partialFit on a loaded model', async () => {
+  const { X, y } = makeRegressionData(80)
+  const m = await XLearnLRRegressor.create({ epoch: 5 })
+  m.fit(X.slice(0, 40), y.slice(0, 40))
+  const m2 = await XLearnLRRegressor.load(m.save())
+  m.dispose()
+
+  m2.partialFit(X.slice(40), y.slice(40), { epoch: 5 })
+  assert(m2.score(X, y) > 0.2, 'R-squared too low after partialFit')
+  m2.dispose()
+})
+
+await test('partialFit before fit behaves like fit', async () => {
+  const { X, y } = makeLinearData(40)
+  const m = await XLearnLRClassifier.create({ epoch: 5 })
+  m.partialFit(X, y)
+  assert(m.isFitted, 'should be fitted')
+  assert(m.predict(X).length === 40, 'should predict')
+  m.dispose()
+})
+
+await test('partialFit rejects a different optimizer', async () => {
+  const { X, y } = makeLinearData(40)
+  const m = await XLearnFMClassifier.create({ epoch: 2, k: 4, opt: 'adagrad' })
+  m.fit(X, y)
+  m.setParams({ opt: 'ftrl' })
+  let threw = false
+  try { m.partialFit(X, y) } catch { threw = true }
+  assert(threw, 'optimizer state mismatch should throw')
+  m.dispose()
+})
+
+// ============================================================
+// fitStream
+// ============================================================
+console.log('\n=== fitStream ===')
+
+function* chunksOf(X, y, size, csr = false) {
+  for (let i = 0; i < X.length; i += size) {
+    const Xc = X.slice(i, i + size)
+    yield { X: csr ? toCSR(Xc) : Xc, y: y.slice(i, i + size) }
+  }
+}
+
+await test('fitStream matches fit on the same rows', async () => {
+  const { X, y } = makeLinearData(100)
+  const m1 = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  const m2 = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  m1.fit(X, y)
+  await m2.fitStream(chunksOf(X, y, 30))
+  const p1 = m1.predict(X)
+  const p2 = m2.predict(X)
+  for (let i = 0; i < p1.length; i++) {
+    assert(p1[i] === p2[i], `pred ${i}: ${p1[i]} !== ${p2[i]}`)
+  }
+  assert(m2.classes.length === 2, 'classes from all chunks')
+  m1.dispose()
+  m2.dispose()
+})
+
+await test('fitStream with async CSR chunks', async () => {
+  const { X, y } = makeRegressionData(60)
+  async function* gen() {
+    for (const c of chunksOf(X, y, 25, true)) yield c
+  }
+  const m = await XLearnLRRegressor.create({ epoch: 5 })
+  await m.fitStream(gen())
+  assert(m.isFitted, 'should be fitted')
+  assert(m.predict(X).length === 60, 'should predict all rows')
+  m.dispose()
+})
+
+await test('fitStream rejects mismatched chunk width', async () => {
+  const m = await XLearnLRClassifier.create()
+  let threw = false
+  try {
+    await m.fitStream([
+      { X: [[1, 0], [0, 1]], y: [1, 0] },
+      { X: [[1, 0, 1]], y: [1] }
+    ])
+  } catch { threw = true }
+  assert(threw, 'width mismatch should throw')
+  assert(!m.isFitted, 'should not be fitted')
+
+  threw = false
+  try { await m.fitStream([]) } catch { threw = true }
+  assert(threw, 'empty stream should throw')
+  m.dispose()
+})
+
+// ============================================================
+// fitFile
+// ============================================================
+console.log('\n=== fitFile ===')
+
+function writeLibsvm(X, y) {
+  const fs = require('fs')
+  const os = require('os')
+  const path = require('path')
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'wl-xl-'))
+  const file = path.join(dir, 'train.txt')
+  const lines = X.map((row, i) => {
+    const feats = row.map((v, j) => v !== 0 ? `${j}:${v}` : null).filter(Boolean)
+    return `${y[i]} ${feats.join(' ')}`
+  })
+  fs.writeFileSync(file, lines.join('\n') + '\n')
+  return file
+}
+
+await test('fitFile trains out of core from a libsvm file', async () => {
+  const { X, y } = makeLinearData(200)
+  const file = writeLibsvm(X, y)
+  const m = await XLearnLRClassifier.create({ epoch: 10 })
+  m.fitFile(file, { onDisk: true, blockSize: 1 })
+  assert(m.isFitted, 'should be fitted')
+  assert(m.nFeatures >= 2, `nFeatures ${m.nFeatures}`)
+  assert(m.score(X, y) > 0.7, 'accuracy too low after fitFile')
+
+  // Same file through the in-memory reader
+  const m2 = await XLearnLRClassifier.create({ epoch: 10 })
+  m2.fitFile(file, { onDisk: false })
+  assert(m2.score(X, y) > 0.7, 'accuracy too low (in-memory reader)')
+
+  const m3 = await XLearnLRClassifier.load(m.save())
+  const p1 = m.predict(X)
+  const p3 = m3.predict(X)
+  for (let i = 0; i < p1.length; i++) {
+    assert(p1[i] === p3[i], `pred ${i}: ${p1[i]} !== ${p3[i]}`)
+  }
+  m.dispose()
+  m2.dispose()
+  m3.dispose()
+})
+
+await test('fitFile throws on a missing file', async () => {
+  const m = await XLearnLRClassifier.create()
+  let threw = false
+  try { m.fitFile('/nonexistent/dir/train.txt') } catch { threw = true }
+  assert(threw, 'missing file should throw')
+  assert(!m.isFitted, 'should not be fitted')
+  m.dispose()
+})
+
+// ============================================================
+// predictMany
+// ============================================================
+console.log('\n=== predictMany ===')
+
+await test('predictMany matches per-model predict', async () => {
+  const { X, y } = makeLinearData(80)
+  const models = [
+    await XLearnLRClassifier.create({ epoch: 5 }),
+    await XLearnFMClassifier.create({ epoch: 5, k: 4 }),
+    await XLearnFMClassifier.create({ epoch: 5, k: 4, opt: 'ftrl' })
+  ]
+  for (const m of models) m.fit(X, y)
+
+  for (const input of [X, toCSR(X)]) {
+    const all = predictMany(models, input)
+    assert(all.length === 3, 'one result per model')
+    for (let k = 0; k < models.length; k++) {
+      const p = models[k].predict(X)
+      assert(all[k].length === 80, 'one score per row')
+      for (let i = 0; i < p.length; i++) {
+        assert(all[k][i] === p[i], `model ${k} pred ${i}: ${all[k][i]} !== ${p[i]}`)
+      }
+    }
+  }
+  for (const m of models) m.dispose()
+})
+
+await test('predictMany rejects unfitted models', async () => {
+  const { X, y } = makeLinearData(40)
+  const m1 = await XLearnLRClassifier.create()
+  const m2 = await XLearnLRClassifier.create()
+  m1.fit(X, y)
+  let threw = false
+  try { predictMany([m1, m2], X) } catch { threw = true }
+  assert(threw, 'unfitted model should throw')
+  threw = false
+  try { predictMany([], X) } catch { threw = true }
+  assert(threw, 'empty model list should throw')
+  m1.dispose()
+  m2.dispose()
+})
+
+// ============================================================
+// Prediction buffers
+// ============================================================
+console.log('\n=== Prediction Buffers ===')
+
+await test('predictInto fills caller arrays like predict', async () => {
+  const { X, y } = makeLinearData(60)
+  const m = await XLearnFMClassifier.create({ epoch: 5, k: 4 })
+  m.fit(X, y)
+  const p = m.predict(X)
+
+  const out32 = new Float32Array(100)
+  assert(m.predictInto(X, out32) === out32, 'should return out')
+  const out64 = new Float64Array(60)
+  m.predictInto(toCSR(X), out64)
+  for (let i = 0; i < p.length; i++) {
+    assert(out64[i] === p[i], `pred ${i}: ${out64[i]} !== ${p[i]}`)
+    assert(out32[i] === Math.fround(p[i]), `f32 pred ${i}`)
+  }
+
+  let threw = false
+  try { m.predictInto(X, new Float32Array(10)) } catch { threw = true }
+  assert(threw, 'short output should throw')
+  m.dispose()
+})
+
+await test('predictView returns a heap view reused across calls', async () => {
+  const { X, y } = makeLinearData(60)
+  const m = await XLearnLRClassifier.create({ epoch: 5 })
+  m.fit(X, y)
+  const p = m.predict(X)
+
+  const v1 = m.predictView(X)
+  assert(v1 instanceof Float32Array && v1.length === 60, 'view shape')
+  for (let i = 0; i < p.length; i++) assert(v1[i] === p[i], `pred ${i}`)
+
+  const v2 = m.predictView(X.slice(0, 10))
+  assert(v2.length === 10, 'smaller batch view')
+  assert(v2.byteOffset === v1.byteOffset, 'output region should be reused')
+  m.dispose()
+})
+
+// ============================================================
+// Scratch arena
+// ============================================================
+console.log('\n=== Scratch Arena ===')
+
+await test('scratch arena reuses its block after reset', async () => {
+  const { getWasm } = require('../src/wasm.js')
+  const wasm = getWasm()
+  wasm._wl_xl_scratch_reset()
+  // First round overflows to malloc and sizes the arena
+  for (let i = 0; i < 8; i++) assert(wasm._wl_xl_scratch_alloc(100) !== 0, 'alloc')
+  wasm._wl_xl_scratch_reset()
+
+  const a = wasm._wl_xl_scratch_alloc(100)
+  const b = wasm._wl_xl_scratch_alloc(3)
+  assert(b === a + 104, 'bump allocations should be contiguous and 8-aligned')
+  wasm._wl_xl_scratch_reset()
+  assert(wasm._wl_xl_scratch_alloc(100) === a, 'reset should rewind to the arena start')
+  wasm._wl_xl_scratch_reset()
+})
+
+await test('repeated predict does not grow the heap', async () => {
+  const { getWasm } = require('../src/wasm.js')
+  const { X, y } = makeLinearData(60)
+  const m = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  m.fit(X, y)
+  for (let i = 0; i < 50; i++) m.predict(X.slice(0, 5))
+  const heapSize = getWasm().HEAPU8.length
+  for (let i = 0; i < 2000; i++) m.predict(X.slice(0, 5))
+  assert(getWasm().HEAPU8.length === heapSize, 'heap grew during predicts')
+  m.dispose()
+})
+
+// ============================================================
+// Quantized models
+// ============================================================
+console.log('\n=== Quantized Models ===')
+
+await test('quantized save shrinks FFM and predicts close to fp32', async () => {
+  const { X, y } = makeWideData(80, 30)
+  const fields = Int32Array.from({ length: 30 }, (_, j) => j % 3)
+  const m = await XLearnFFMClassifier.create({ epoch: 5, k: 8, featureFields: fields })
+  m.fit(X, y)
+  const p = m.predict(X)
+  const full = m.save()
+
+  for (const [kind, tol] of [['fp16', 1e-2], ['int8', 5e-2]]) {
+    const bytes = m.save({ quantize: kind })
+    assert(bytes.length * 2 < full.length, `${kind} bundle should be at least 2x smaller`)
+    const mq = await XLearnFFMClassifier.load(bytes)
+    const pq = mq.predict(X)
+    for (let i = 0; i < p.length; i++) {
+      assertClose(pq[i], p[i], tol, `${kind} pred ${i}: ${pq[i]} vs ${p[i]}`)
+    }
+    // Re-saving keeps the quantized artifact as is
+    const again = mq.save()
+    assert(again.length === bytes.length, `${kind} re-save size`)
+    mq.dispose()
+  }
+  m.dispose()
+})
+
+await test('quantized LR and FM load and score', async () => {
+  const { X, y } = makeRegressionData(60)
+  for (const Cls of [XLearnLRRegressor, XLearnFMRegressor]) {
+    const m = await Cls.create({ epoch: 5, k: 4 })
+    m.fit(X, y)
+    const mq = await Cls.load(m.save({ quantize: 'int8' }))
+    const r2 = mq.score(X, y)
+    assertClose(r2, m.score(X, y), 0.05, `R-squared drifted: ${r2}`)
+    m.dispose()
+    mq.dispose()
+  }
+})
+
+await test('quantized models are inference-only', async () => {
+  const { X, y } = makeLinearData(40)
+  const m = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  m.fit(X, y)
+  const mq = await XLearnFMClassifier.load(m.save({ quantize: 'fp16' }))
+  let threw = false
+  try { mq.partialFit(X, y) } catch { threw = true }
+  assert(threw, 'partialFit on a quantized model should throw')
+  threw = false
+  try { mq.save({ quantize: 'int8' }) } catch { threw = true }
+  assert(threw, 'requantizing should throw')
+  threw = false
+  try { m.save({ quantize: 'int4' }) } catch { threw = true }
+  assert(threw, 'unknown format should throw')
+  m.dispose()
+  mq.dispose()
+})
+
+// ============================================================
+// Paged Models
+// ============================================================
+console.log('\n=== Paged Models ===')
+
+function writeTemp(name, bytes) {
+  const fs = require('fs')
+  const os = require('os')
+  const path = require('path')
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'wl-xl-'))
+  const file = path.join(dir, name)
+  fs.writeFileSync(file, bytes)
+  return file
+}
+
+// Rows of X restricted to columns [lo, hi), as CSR
+function columnSlice(X, lo, hi) {
+  return toCSR(X.map(row => row.map((v, j) => j >= lo && j < hi ? v : 0)))
+}
+
+await test('paged FFM reads pages on demand under an LRU cap', async () => {
+  const { X, y } = makeWideData(80, 30)
+  const fields = Int32Array.from({ length: 30 }, (_, j) => j % 3)
+  const m = await XLearnFFMClassifier.create({ epoch: 5, k: 8, featureFields: fields })
+  m.fit(X, y)
+  const file = writeTemp('model.wlpg', m.savePaged({ blockFeatures: 8 }))
+
+  const mp = await XLearnFFMClassifier.loadPaged(file, { maxResidentPages: 1 })
+  let stats = mp.pageStats
+  assert(stats.pages === 4 && stats.resident === 0, `after load: ${JSON.stringify(stats)}`)
+  assert(mp.nFeatures === 30 && mp.nClasses === 2, 'metadata from header')
+
+  const first = columnSlice(X, 0, 8)
+  const last = columnSlice(X, 24, 30)
+  for (const [batch, ins] of [[first, 1], [last, 2], [first, 3]]) {
+    const p = m.predict(batch)
+    const pp = mp.predict(batch)
+    for (let i = 0; i < p.length; i++) assertClose(pp[i], p[i], 1e-5, `pred ${i}`)
+    stats = mp.pageStats
+    assert(stats.resident === 1 && stats.pageIns === ins, `stats ${JSON.stringify(stats)}`)
+  }
+
+  // A batch wider than the cap keeps all of its pages for the batch
+  const p = m.predict(X)
+  const pp = mp.predict(X)
+  for (let i = 0; i < p.length; i++) assertClose(pp[i], p[i], 1e-5, `full pred ${i}`)
+  assert(mp.pageStats.resident === 4, 'wide batch pages in everything')
+  m.dispose()
+  mp.dispose()
+})
+
+await test('paged model from a Blob pages in with prefetch', async () => {
+  const { X, y } = makeWideData(60, 12)
+  const m = await XLearnFMClassifier.create({ epoch: 5, k: 4 })
+  m.fit(X, y)
+  const mp = await XLearnFMClassifier.loadPaged(new Blob([m.savePaged({ blockFeatures: 4 })]))
+  let threw = false
+  try { mp.predict(X) } catch { threw = true }
+  assert(threw, 'predict should need prefetch for an async source')
+
+  assert(await mp.prefetch(X) === mp, 'prefetch returns the model')
+  const p = m.predict(X)
+  const pp = mp.predict(X)
+  for (let i = 0; i < p.length; i++) assertClose(pp[i], p[i], 1e-5, `pred ${i}`)
+  assert(mp.pageStats.pageIns === 3, `pageIns=${mp.pageStats.pageIns}`)
+  m.dispose()
+  mp.dispose()
+})
+
+await test('paged models load from an fd and are inference-only', async () => {
+  const fs = require('fs')
+  const { X, y } = makeRegressionData(60)
+  const m = await XLearnLRRegressor.create({ epoch: 5 })
+  m.fit(X, y)
+  const file = writeTemp('lr.wlpg', m.savePaged())
+  const fd = fs.openSync(file, 'r')
+  const mp = await XLearnLRRegressor.loadPaged(fd)
+  const p = m.predict(X)
+  const pp = mp.predict(X)
+  for (let i = 0; i < p.length; i++) assertClose(pp[i], p[i], 1e-5, `pred ${i}`)
+
+  for (const fn of [() => mp.save(), () => mp.savePaged(), () => mp.partialFit(X, y)]) {
+    let threw = false
+    try { fn() } catch { threw = true }
+    assert(threw, 'paged model should reject training and re-saving')
+  }
+  let threw = false
+  try { await XLearnLRClassifier.loadPaged(fd) } catch { threw = true }
+  assert(threw, 'loading as the wrong type should throw')
+  mp.dispose()
+  fs.closeSync(fd)
+  m.dispose()
+})
+
+// ============================================================
+// Early Stopping
+// ============================================================
+console.log('\n=== Early Stopping ===')
+
+function logLoss(margins, y) {
+  let sum = 0
+  for (let i = 0; i < y.length; i++) {
+    const z = (y[i] > 0 ? 1 : -1) * margins[i]
+    sum += z > 0 ? Math.log1p(Math.exp(-z)) : -z + Math.log1p(Math.exp(z))
+  }
+  return sum / y.length
+}
+
+await test('onEpoch reports every epoch and can stop training', async () => {
+  const { X, y } = makeLinearData(100)
+  const m = await XLearnFMClassifier.create({ epoch: 10, k: 4 })
+  const seen = []
+  m.fit(X, y, { onEpoch: (info) => { seen.push(info); return info.epoch < 3 } })
+  assert(seen.length === 3, `expected 3 epochs, got ${seen.length}`)
+  for (const [i, info] of seen.entries()) {
+    assert(info.epoch === i + 1, `epoch ${info.epoch}`)
+    assert(Number.isFinite(info.trainLoss) && info.trainLoss > 0, `trainLoss=${info.trainLoss}`)
+    assert(info.validLoss === null && info.validMetric === null, 'no validation metrics')
+  }
+  assert(seen[2].trainLoss < seen[0].trainLoss, 'train loss should fall')
+  assert(m.predict(X).length === 100, 'should predict')
+  assert(m.capabilities.earlyStopping === true, 'earlyStopping capability')
+  m.dispose()
+})
+
+await test('early stopping keeps the best epoch', async () => {
+  const { X, y } = makeLinearData(100)
+  // Inverted labels: validation loss rises as the model fits X
+  const yv = y.map(v => 1 - v)
+  const m = await XLearnLRClassifier.create({ epoch: 20, stopWindow: 3 })
+  const seen = []
+  m.fit(X, y, { validation: [X, yv], onEpoch: (info) => { seen.push(info) } })
+  assert(seen.length < 20, `should stop early, ran ${seen.length} epochs`)
+  assert(seen.length === m.bestEpoch + 3, `ran ${seen.length}, best ${m.bestEpoch}`)
+  const best = seen[m.bestEpoch - 1]
+  for (const info of seen) assert(info.validLoss >= best.validLoss, 'best epoch has the lowest loss')
+  assertClose(logLoss(m.predict(X), yv), best.validLoss, 1e-4, 'weights rolled back to the best epoch')
+  assertClose(best.validMetric, 1 - m.score(X, y), 1e-6, 'validMetric is accuracy')
+  m.dispose()
+})
+
+await test('earlyStop: false trains every epoch with validation', async () => {
+  const { X, y } = makeRegressionData(80)
+  const m = await XLearnFMRegressor.create({ epoch: 6, k: 4, earlyStop: false })
+  const seen = []
+  m.fit(X, y, { validation: [X, y], onEpoch: (info) => { seen.push(info) } })
+  assert(seen.length === 6, `ran ${seen.length} epochs`)
+  assert(m.bestEpoch === null, 'no early stopping')
+  assert(seen[5].validLoss < seen[0].validLoss, 'validation MSE should fall')
+  assertClose(seen[5].validMetric, Math.sqrt(seen[5].validLoss), 1e-4, 'validMetric is RMSE')
+  let threw = false
+  try { m.fit(X, y, { validation: [X, y.slice(1)] }) } catch { threw = true }
+  assert(threw, 'mismatched validation labels should throw')
+  m.dispose()
+})
+
+// ============================================================
+// Shared Datasets
+// ============================================================
+console.log('\n=== Shared Datasets ===')
+
+await test('fitDataset matches fit and reuses one DMatrix', async () => {
+  const { X, y } = makeLinearData(100)
+  const ds = await XLearnDataset.create(X, y)
+  assert(ds.task === 'binary' && ds.rows === 100 && ds.cols === X[0].length, 'dataset shape')
+  const m1 = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  m1.fit(X, y)
+  const p1 = m1.predict(X)
+  // Several models from the same dataset (a small lr sweep)
+  for (const lr of [0.2, 0.05, 0.5]) {
+    const m2 = await XLearnFMClassifier.create({ epoch: 3, k: 4, lr })
+    m2.fitDataset(ds)
+    const p2 = m2.predict(X)
+    assert(p2.length === 100, 'should predict')
+    if (lr === 0.2) { // upstream default
+      for (let i = 0; i < p1.length; i++) {
+        assert(p1[i] === p2[i], `pred ${i}: ${p1[i]} !== ${p2[i]}`)
+      }
+      assert(m2.classes.length === 2, 'classes from the dataset')
+    }
+    m2.dispose()
+  }
+  m1.dispose()
+  ds.dispose()
+  assert(ds.disposed, 'dataset disposed')
+})
+
+await test('fitDataset with dataset validation and featureFields', async () => {
+  const { X, y } = makeLinearData(100)
+  const featureFields = new Int32Array([0, 1])
+  const ds = await XLearnDataset.create(X, y, { featureFields, validation: [X, y] })
+  assert(ds.hasValidation, 'has validation')
+  const m = await XLearnFFMClassifier.create({ epoch: 4, k: 4 })
+  const seen = []
+  m.fitDataset(ds, { onEpoch: (info) => { seen.push(info) } })
+  assert(seen.length > 0 && seen.every(info => info.validLoss !== null), 'validation metrics')
+  // The model keeps the dataset's field map after the dataset is gone
+  ds.dispose()
+  assert(m.score(X, y) > 0.7, `accuracy ${m.score(X, y)}`)
+  m.dispose()
+})
+
+await test('fitDataset rejects a dataset of the wrong task', async () => {
+  const { X, y } = makeRegressionData(50)
+  const ds = await XLearnDataset.create(X, y)
+  assert(ds.task === 'reg', `task ${ds.task}`)
+  const m = await XLearnLRClassifier.create()
+  let threw = false
+  try { m.fitDataset(ds) } catch { threw = true }
+  assert(threw, 'task mismatch should throw')
+  ds.dispose()
+  threw = false
+  const r = await XLearnLRRegressor.create()
+  try { r.fitDataset(ds) } catch { threw = true }
+  assert(threw, 'disposed dataset should throw')
+  m.dispose()
+  r.dispose()
+})
+
+// ============================================================
+// Stats
+// ============================================================
+console.log('\n=== Stats ===')
+
+await test('stats() is null unless params.stats is set', async () => {
+  const { X, y } = makeLinearData(50)
+  const m = await XLearnLRClassifier.create({ epoch: 2 })
+  m.fit(X, y)
+  assert(m.stats() === null, 'stats off by default')
+  m.dispose()
+})
+
+await test('stats() counts fit, predict and save phases', async () => {
+  const { X, y } = makeLinearData(80)
+  const m = await XLearnFMClassifier.create({ epoch: 3, k: 4, stats: true })
+  m.fit(X, y)
+  m.predict(X)
+  m.predict(X.slice(0, 10))
+  m.save()
+  const st = m.stats()
+  const { phases } = st
+  assert(phases.convert.calls === 3, `convert calls ${phases.convert.calls}`)
+  assert(phases.fit.calls === 1 && phases.fit.ms > 0, 'fit timed')
+  assert(phases.score.calls === 2, `score calls ${phases.score.calls}`)
+  assert(phases.save.calls === 1, `save calls ${phases.save.calls}`)
+  assert(phases.copyOut.calls === 3, `copyOut calls ${phases.copyOut.calls}`)
+  assert(st.bytesCopied >= (80 * 2 + 80 + 90) * 4, `bytesCopied ${st.bytesCopied}`)
+  assert(st.allocs >= 1, 'model allocation counted')
+  assert(st.peakHeapBytes >= st.heapBytes && st.heapBytes > 0, 'heap counters')
+
+  m.resetStats()
+  const zero = m.stats()
+  assert(zero.phases.fit.calls === 0 && zero.phases.convert.calls === 0, 'reset')
+  m.dispose()
+})
+
+await test('stats() on loaded models and shared predictMany batches', async () => {
+  const { X, y } = makeLinearData(60)
+  const m1 = await XLearnLRClassifier.create({ epoch: 2, stats: true })
+  m1.fit(X, y)
+  const m2 = await XLearnLRClassifier.load(m1.save())
+  assert(m2.stats().phases.load.calls === 1, 'load timed')
+  predictMany([m1, m2], X)
+  assert(m1.stats().phases.score.calls === 1, 'm1 charged')
+  assert(m2.stats().phases.score.calls === 1, 'm2 charged')
+  m1.dispose()
+  m2.dispose()
+})
+
+// ============================================================
+// Feature Hashing
+// ============================================================
+console.log('\n=== Feature Hashing ===')
+
+// Two categorical fields; the label is carried by the user token
+function makeHashedData(n, vocab) {
+  const rows = []
+  const y = []
+  for (let i = 0; i < n; i++) {
+    const user = i % vocab
+    rows.push([[0, `user=${user}`], [1, `ad=${(i * 7) % 13}`, 1]])
+    y.push(user % 2)
+  }
+  return { X: hashRows(rows), y }
+}
+
+await test('fit/predict on hashed input', async () => {
+  const { X, y } = makeHashedData(400, 20)
+  assert(hashToken('user=1') === hashToken('user=1'), 'hash is deterministic')
+  assert(X.indptr.length === 401 && X.hashes.length === 800, 'hashRows layout')
+  const m = await XLearnFFMClassifier.create({ hashBits: 10, epoch: 10, k: 4, lr: 0.2 })
+  m.fit(X, y)
+  assert(m.score(X, y) > 0.9, `accuracy ${m.score(X, y)}`)
+  const m2 = await XLearnFFMClassifier.load(m.save())
+  const p1 = m.predictProba(X)
+  const p2 = m2.predictProba(X)
+  for (let i = 0; i < p1.length; i++) assert(Math.abs(p1[i] - p2[i]) < 1e-6, 'reload matches')
+  m.dispose()
+  m2.dispose()
+})
+
+await test('hashed model size is fixed by hashBits, not the vocabulary', async () => {
+  const small = makeHashedData(300, 30)
+  const large = makeHashedData(3000, 3000)
+  const m1 = await XLearnLRClassifier.create({ hashBits: 8, epoch: 2 })
+  const m2 = await XLearnLRClassifier.create({ hashBits: 8, epoch: 2 })
+  const m3 = await XLearnLRClassifier.create({ hashBits: 14, epoch: 2 })
+  m1.fit(small.X, small.y)
+  m2.fit(large.X, large.y)
+  m3.fit(large.X, large.y)
+  assert(m1.nFeatures === 256 && m2.nFeatures === 256, `nFeatures ${m1.nFeatures} ${m2.nFeatures}`)
+  // At most 2^8 weights (+ optimizer state) whatever the vocabulary
+  assert(m2.save().length < m3.save().length, 'table bounds the model')
+  assert(m2.save().length - m1.save().length < 256 * 12, 'vocabulary does not grow the model')
+  const ds = await XLearnDataset.create(large.X, large.y, { hashBits: 8 })
+  assert(ds.cols === 256 && ds.hashBits === 8, `dataset cols ${ds.cols}`)
+  m1.fitDataset(ds)
+  ds.dispose()
+  m1.dispose()
+  m2.dispose()
+  m3.dispose()
+})
+
+await test('hashed input and hashBits must go together', async () => {
+  const { X, y } = makeHashedData(50, 5)
+  const dense = makeLinearData(50)
+  const throws = (fn) => { try { fn(); return false } catch { return true } }
+  const plain = await XLearnLRClassifier.create({ epoch: 1 })
+  assert(throws(() => plain.fit(X, y)), 'hashed input without hashBits')
+  const hashed = await XLearnLRClassifier.create({ epoch: 1, hashBits: 8 })
+  assert(throws(() => hashed.fit(dense.X, dense.y)), 'dense input with hashBits')
+  const bad = { ...X, fields: X.fields.slice() }
+  bad.fields[3] = -1
+  assert(throws(() => hashed.fit(bad, y)), 'negative field id')
+  const ds = await XLearnDataset.create(X, y, { hashBits: 10 })
+  assert(throws(() => hashed.fitDataset(ds)), 'dataset hashBits mismatch')
+  ds.dispose()
+  plain.dispose()
+  hashed.dispose()
+})
+
+// ============================================================
+// FFM layout
+// ============================================================
+console.log('\n=== FFM Layout ===')
+
+const layoutFields = new Int32Array([0, 0, 1, 1, 2, 2])
+
+await test('blocked layout converts losslessly and scores the same', async () => {
+  const { X, y } = makeWideData(80, 6)
+  const m1 = await XLearnFFMClassifier.create({ epoch: 5, k: 6, featureFields: layoutFields })
+  m1.fit(X, y)
+  const m2 = await XLearnFFMClassifier.load(m1.save())
+  m2.setParams({ layout: 'blocked' })
+  const p1 = m1.predict(X)
+  const p2 = m2.predict(X)
+  for (let i = 0; i < p1.length; i++) assertClose(p1[i], p2[i], 1e-6, `row ${i}`)
+  // Weights and optimizer state survive blocked -> upstream blob
+  assert(Buffer.from(rawModelBlob(m2)).equals(Buffer.from(rawModelBlob(m1))), 'blob bytes')
+  m2.setParams({ layout: 'interleaved' })
+  assert(Buffer.from(rawModelBlob(m2)).equals(Buffer.from(rawModelBlob(m1))), 'back to interleaved')
+  m1.dispose()
+  m2.dispose()
+})
+
+await test('blocked layout trains epoch-wise and incrementally', async () => {
+  const { X, y } = makeWideData(120, 6)
+  const models = []
+  for (const layout of ['interleaved', 'blocked']) {
+    for (const opt of ['adagrad', 'ftrl']) {
+      const m = await XLearnFFMClassifier.create({
+        epoch: 4, k: 4, opt, layout, earlyStop: false, featureFields: layoutFields
+      })
+      m.fit(X, y, { validation: [X, y] })
+      m.partialFit(X.slice(0, 40), y.slice(0, 40), { epoch: 2 })
+      models.push(m)
+    }
+  }
+  for (let o = 0; o < 2; o++) {
+    const a = models[o].predict(X)
+    const b = models[o + 2].predict(X)
+    for (let i = 0; i < a.length; i++) assertClose(a[i], b[i], 1e-4, `opt ${o} row ${i}`)
+  }
+  const reloaded = await XLearnFFMClassifier.load(models[3].save())
+  assert(reloaded.getParams().layout === 'blocked', 'layout saved with params')
+  const pr = reloaded.predict(X)
+  const pb = models[3].predict(X)
+  for (let i = 0; i < pr.length; i++) assertClose(pr[i], pb[i], 1e-6, `reload row ${i}`)
+  reloaded.dispose()
+  for (const m of models) m.dispose()
+})
+
+await test('legacy wl_xl_fit returns a model blob for a blocked handle', async () => {
+  const { getWasm } = require('../src/wasm.js')
+  const wasm = getWasm()
+  const { X, y } = makeWideData(40, 6)
+  const xPtr = wasm._malloc(40 * 6 * 4)
+  wasm.HEAPF32.set(new Float32Array(X.flat()), xPtr / 4)
+  const yPtr = wasm._malloc(40 * 4)
+  wasm.HEAPF32.set(new Float32Array(y), yPtr / 4)
+  const fPtr = wasm._malloc(layoutFields.length * 4)
+  wasm.HEAP32.set(layoutFields, fPtr / 4)
+  const outPtr = wasm._malloc(4)
+  assert(wasm._wl_xl_create_dmatrix_dense(xPtr, 40, 6, yPtr, fPtr, outPtr) === 0, 'dmatrix')
+  const dm = wasm.getValue(outPtr, 'i32')
+  const algoPtr = wasm._malloc(4)
+  wasm.HEAPU8.set(new TextEncoder().encode('ffm\0'), algoPtr)
+  assert(wasm._wl_xl_create(algoPtr, outPtr) === 0, 'create')
+  const h = wasm.getValue(outPtr, 'i32')
+  assert(wasm._wl_xl_set_layout(h, 1) === 0, 'layout')
+  const bufPtrPtr = wasm._malloc(4)
+  const lenPtr = wasm._malloc(4)
+  assert(wasm._wl_xl_fit(h, dm, 0, bufPtrPtr, lenPtr) === 0, 'fit')
+  const bufPtr = wasm.getValue(bufPtrPtr, 'i32')
+  const len = wasm.getValue(lenPtr, 'i32')
+  assert(len > 0 && len === wasm._wl_xl_model_size(h), `blob length ${len}`)
+  // The blob is upstream's format and loads into an interleaved handle
+  assert(wasm._wl_xl_create(algoPtr, outPtr) === 0, 'create')
+  const h2 = wasm.getValue(outPtr, 'i32')
+  assert(wasm._wl_xl_load_model(h2, bufPtr, len) === 0, 'load blob')
+  wasm._wl_xl_free_buffer(bufPtr)
+  for (const ptr of [xPtr, yPtr, fPtr, outPtr, algoPtr, bufPtrPtr, lenPtr]) wasm._free(ptr)
+  wasm._wl_xl_free_dmatrix(dm)
+  wasm._wl_xl_free_handle(h)
+  wasm._wl_xl_free_handle(h2)
+})
+
+await test('layout is ignored by LR/FM and validated', async () => {
+  const { X, y } = makeLinearData(60)
+  const lr = await XLearnLRClassifier.create({ epoch: 2, layout: 'blocked' })
+  lr.fit(X, y)
+  assert(lr.score(X, y) > 0.6, `accuracy ${lr.score(X, y)}`)
+  let threw = false
+  try { await XLearnFFMClassifier.create({ layout: 'soa' }).then(m => m.fit(X, y)) } catch { threw = true }
+  assert(threw, 'unknown layout should throw')
+  lr.dispose()
+})
+
+// ============================================================
+// Batches
+// ============================================================
+console.log('\n=== Batches ===')
+
+await test('predict on a Batch matches predict on X', async () => {
+  const { X, y } = makeWideData(60, 6)
+  const featureFields = new Int32Array([0, 0, 1, 1, 2, 2])
+  const m = await XLearnFFMClassifier.create({ epoch: 3, k: 4, featureFields })
+  const m2 = await XLearnFFMClassifier.create({ epoch: 2, k: 4, featureFields })
+  m.fit(X, y)
+  m2.fit(X, y)
+  const ref = m.predict(X)
+  const batch = await XLearnBatch.create(X, { featureFields })
+  assert(batch.rows === 60 && batch.cols === 6, `batch shape ${batch.rows}x${batch.cols}`)
+  const p = m.predict(batch)
+  for (let i = 0; i < ref.length; i++) assert(p[i] === ref[i], `dense row ${i}`)
+  batch.set(toCSR(X))
+  const view = m.predictView(batch)
+  for (let i = 0; i < ref.length; i++) assert(view[i] === ref[i], `csr row ${i}`)
+  const [a, b] = predictMany([m, m2], batch)
+  const ref2 = m2.predict(X)
+  for (let i = 0; i < ref.length; i++) assert(a[i] === ref[i] && b[i] === ref2[i], `many row ${i}`)
+  batch.dispose()
+  m.dispose()
+  m2.dispose()
+})
+
+await test('refilling a Batch keeps its capacity', async () => {
+  const { X, y } = makeLinearData(64)
+  const m = await XLearnLRClassifier.create({ epoch: 2 })
+  m.fit(X, y)
+  const batch = await XLearnBatch.create(X)
+  const cap = batch.capacity
+  assert(cap.rows === 64 && cap.nodes > 0, `capacity ${JSON.stringify(cap)}`)
+  const out = new Float32Array(64)
+  for (let r = 0; r < 5; r++) {
+    const n = 16 + r * 8
+    batch.set(X.slice(0, n))
+    m.predictInto(batch, out)
+    const ref = m.predict(X.slice(0, n))
+    for (let i = 0; i < n; i++) assert(out[i] === Math.fround(ref[i]), `refill ${r} row ${i}`)
+    const c = batch.capacity
+    assert(c.rows === cap.rows && c.nodes === cap.nodes, `refill ${r} grew: ${JSON.stringify(c)}`)
+  }
+  batch.set(X.concat(X))
+  assert(batch.capacity.rows === 128, 'grows for a larger batch')
+  batch.dispose()
+  m.dispose()
+})
+
+await test('Batch misuse is rejected', async () => {
+  const { X, y } = makeWideData(30, 6)
+  const featureFields = new Int32Array([0, 0, 1, 1, 2, 2])
+  const throws = (fn) => { try { fn(); return false } catch { return true } }
+  const ffm = await XLearnFFMClassifier.create({ epoch: 1, k: 4, featureFields })
+  ffm.fit(X, y)
+  const plain = await XLearnBatch.create(X)
+  assert(throws(() => ffm.predict(plain)), 'FFM needs a field map on the batch')
+  assert(throws(() => ffm.fit(plain, y)), 'batches are not training data')
+  const empty = await XLearnBatch.create()
+  assert(throws(() => ffm.predict(empty)), 'empty batch')
+  plain.dispose()
+  empty.dispose()
+  assert(plain.disposed && throws(() => plain.set(X)), 'disposed batch')
+  ffm.dispose()
+})
+
+// ============================================================
+// Async engine
+// ============================================================
+console.log('\n=== Async Engine ===')
+
+await test('fitAsync trains on a worker like fit', async () => {
+  const { X, y } = makeWideData(80, 6)
+  const featureFields = new Int32Array([0, 0, 1, 1, 2, 2])
+  const engine = XLearnEngine.create()
+  const ref = await XLearnFFMClassifier.create({ epoch: 3, k: 4, featureFields })
+  ref.fit(X, y)
+  const m = await XLearnFFMClassifier.create({ epoch: 3, k: 4, featureFields })
+  const self = await m.fitAsync(X, y, { engine })
+  assert(self === m && m.isFitted, 'fitAsync resolves to the fitted model')
+  const a = ref.predict(X)
+  const b = m.predict(X)
+  for (let i = 0; i < a.length; i++) assert(a[i] === b[i], `row ${i}: ${a[i]} vs ${b[i]}`)
+  const c = await m.predictAsync(X, { engine })
+  for (let i = 0; i < a.length; i++) assert(c[i] === a[i], `async row ${i}`)
+  assert(engine.stats.fits === 1, 'one fit')
+  ref.dispose()
+  m.dispose()
+  await engine.terminate()
+})
+
+await test('concurrent predictAsync calls are batched', async () => {
+  const { X, y } = makeLinearData(90)
+  const engine = XLearnEngine.create()
+  const m = await XLearnLRClassifier.create({ epoch: 2 })
+  m.fit(X, y)
+  const ref = m.predict(X)
+  const parts = [X.slice(0, 30), X.slice(30, 60), X.slice(60)]
+  const outs = await Promise.all(parts.map(part => m.predictAsync(part, { engine })))
+  outs.forEach((out, p) => {
+    assert(out.length === 30, `part ${p} length ${out.length}`)
+    for (let i = 0; i < 30; i++) assert(out[i] === ref[p * 30 + i], `part ${p} row ${i}`)
+  })
+  const st = engine.stats
+  assert(st.predicts === 3 && st.batches === 1, `stats ${JSON.stringify(st)}`)
+
+  // Refitting ships the new model; transfer hands over the input
+  m.partialFit(X, y)
+  const ref2 = m.predict(X)
+  const dense = { data: new Float32Array(X.flat()), rows: X.length, cols: X[0].length }
+  const out = await m.predictAsync(dense, { engine, transfer: true })
+  for (let i = 0; i < ref2.length; i++) assert(out[i] === ref2[i], `refit row ${i}`)
+  m.dispose()
+  await engine.terminate()
+})
+
+await test('a crashed worker is replaced on the next call', async () => {
+  const fs = require('fs')
+  const os = require('os')
+  const path = require('path')
+  // The real worker, dying on any one-row predict
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'wl-xl-'))
+  const workerUrl = path.join(dir, 'crashy-worker.js')
+  fs.writeFileSync(workerUrl, [
+    `require(${JSON.stringify(path.join(__dirname, '../src/worker.js'))})`,
+    "require('worker_threads').parentPort.on('message', (m) => {",
+    "  if (m.op === 'run' && m.jobs.some(j => j.op === 'predict' && j.X.rows === 1)) throw new Error('boom')",
+    '})'
+  ].join('\n'))
+  const { X, y } = makeLinearData(40)
+  const engine = XLearnEngine.create({ workerUrl })
+  const m = await XLearnLRClassifier.create({ epoch: 2 })
+  await m.fitAsync(X, y, { engine })
+  const ref = m.predict(X)
+  // Settles either way: the reply may beat the crash
+  await m.predictAsync(X.slice(0, 1), { engine }).catch(() => {})
+  // 'error' may arrive after the reply; wait for the worker's exit
+  await new Promise(resolve => setTimeout(resolve, 200))
+  const stuck = new Promise((_, reject) => {
+    setTimeout(() => reject(new Error('predictAsync never settled')), 5000).unref()
+  })
+  const out = await Promise.race([m.predictAsync(X, { engine }), stuck])
+  for (let i = 0; i < ref.length; i++) assert(out[i] === ref[i], `row ${i} after crash`)
+  m.dispose()
+  await engine.terminate()
+  fs.rmSync(dir, { recursive: true, force: true })
+})
+
+await test('fitDatasetAsync ships a dataset once per worker', async () => {
+  const { X, y } = makeLinearData(120)
+  const ds = await XLearnDataset.create(X, y)
+  const engine = XLearnEngine.create({ workers: 2 })
+  const lrs = [0.05, 0.1, 0.2, 0.4]
+  const trials = await Promise.all(lrs.map(async (lr) => {
+    const m = await XLearnFMClassifier.create({ epoch: 3, k: 4, lr, nthread: 1 })
+    return m.fitDatasetAsync(ds, { engine })
+  }))
+  for (const [t, lr] of lrs.entries()) {
+    const ref = await XLearnFMClassifier.create({ epoch: 3, k: 4, lr, nthread: 1 })
+    ref.fitDataset(ds)
+    const a = ref.predict(X)
+    const b = trials[t].predict(X)
+    for (let i = 0; i < a.length; i++) assert(a[i] === b[i], `lr ${lr} row ${i}: ${a[i]} vs ${b[i]}`)
+    ref.dispose()
+  }
+  assert(engine.stats.fits === 4 && engine.stats.datasets === 2, `stats ${JSON.stringify(engine.stats)}`)
+  engine.releaseDataset(ds)
+  await trials[0].fitDatasetAsync(ds, { engine })
+  assert(engine.stats.datasets === 3, 'released dataset is shipped again')
+  let threw = false
+  try { await trials[0].fitDatasetAsync(ds, { engine, sampleWeight: [1] }) } catch { threw = true }
+  assert(threw, 'sampleWeight is rejected')
+  for (const m of trials) m.dispose()
+  ds.dispose()
+  await engine.terminate()
+})
+
+await test('engine misuse is rejected', async () => {
+  const { X, y } = makeLinearData(20)
+  const engine = XLearnEngine.create()
+  const m = await XLearnLRClassifier.create({ epoch: 1 })
+  let threw = false
+  try { await m.predictAsync(X, { engine }) } catch { threw = true }
+  assert(threw, 'predictAsync before fit should throw')
+  threw = false
+  try { await m.fitAsync(X, y, { engine, onEpoch: () => {} }) } catch { threw = true }
+  assert(threw, 'onEpoch should be rejected')
+  await m.fitAsync(X, y, { engine })
+  await engine.terminate()
+  threw = false
+  try { await m.predictAsync(X, { engine }) } catch { threw = true }
+  assert(threw, 'terminated engine should reject')
+  m.dispose()
+})
+
+// ============================================================
+// Dataset Cache
+// ============================================================
+console.log('\n=== Dataset Cache ===')
+
+await test('a saved dataset reloads and trains identically', async () => {
+  const { X, y } = makeLinearData(120)
+  const ds = await XLearnDataset.create(X, y)
+  const bytes = ds.save()
+  assert(bytes instanceof Uint8Array && bytes.length > 0, 'save returns bytes')
+  const ds2 = await XLearnDataset.load(bytes)
+  assert(ds2.task === 'binary' && ds2.rows === 120 && ds2.cols === X[0].length, 'shape kept')
+  assert(ds2.classes.length === 2 && ds2.classes[0] === 0, 'classes kept')
+  const a = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  const b = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  a.fitDataset(ds)
+  b.fitDataset(ds2)
+  const pa = a.predict(X)
+  const pb = b.predict(X)
+  for (let i = 0; i < pa.length; i++) assert(pa[i] === pb[i], `row ${i}: ${pa[i]} vs ${pb[i]}`)
+  const again = ds2.save()
+  assert(again.length === bytes.length && again.every((v, i) => v === bytes[i]), 'save is stable')
+  ds.dispose()
+  ds2.dispose()
+  a.dispose()
+  b.dispose()
+})
+
+await test('a saved dataset keeps validation and the field map', async () => {
+  const { X, y } = makeWideData(80, 6)
+  const featureFields = new Int32Array([0, 0, 1, 1, 2, 2])
+  const ds = await XLearnDataset.create(X, y, { featureFields, validation: [X.slice(0, 40), y.slice(0, 40)] })
+  const ds2 = await XLearnDataset.load(ds.save())
+  ds.dispose()
+  assert(ds2.hasValidation, 'validation kept')
+  assert(ds2.featureFields.join() === featureFields.join(), 'field map kept')
+  const ref = await XLearnFFMClassifier.create({ epoch: 4, k: 4, featureFields })
+  ref.fit(X, y, { validation: [X.slice(0, 40), y.slice(0, 40)] })
+  const m = await XLearnFFMClassifier.create({ epoch: 4, k: 4 })
+  m.fitDataset(ds2)
+  assert(m.bestEpoch === ref.bestEpoch, `bestEpoch ${m.bestEpoch} vs ${ref.bestEpoch}`)
+  const pr = ref.predict(X)
+  const pm = m.predict(X)
+  for (let i = 0; i < pr.length; i++) assert(pr[i] === pm[i], `row ${i}`)
+  ds2.dispose()
+  ref.dispose()
+  m.dispose()
+})
+
+await test('a corrupt dataset file is rejected', async () => {
+  const { X, y } = makeLinearData(20)
+  const ds = await XLearnDataset.create(X, y)
+  const bytes = ds.save()
+  ds.dispose()
+  const rejects = async (b) => { try { await XLearnDataset.load(b); return false } catch { return true } }
+  assert(await rejects(new Uint8Array(32)), 'bad magic')
+  assert(await rejects(bytes.subarray(0, bytes.length - 4)), 'truncated')
+  let threw = false
+  try { ds.save() } catch { threw = true }
+  assert(threw, 'disposed dataset cannot be saved')
+})
+
+// ============================================================
+// Wide Rows
+// ============================================================
+console.log('\n=== Wide Rows ===')
+
+await test('wide FFM rows score in parallel bands close to serial', async () => {
+  const { X, y } = makeWideData(12, 800)
+  const featureFields = Int32Array.from({ length: 800 }, (_, j) => j % 4)
+  const m = await XLearnFFMClassifier.create({ epoch: 1, k: 4, featureFields, parallelNnz: 0 })
+  m.fit(X, y)
+  const serial = m.decisionFunction(X)
+  m.setParams({ parallelNnz: 64 })
+  const banded = m.decisionFunction(X)
+  for (let i = 0; i < serial.length; i++) {
+    assertClose(banded[i], serial[i], 1e-4 * Math.max(1, Math.abs(serial[i])), `row ${i}`)
+  }
+  const again = m.decisionFunction(X)
+  for (let i = 0; i < banded.length; i++) assert(again[i] === banded[i], `deterministic row ${i}`)
+  const [many] = predictMany([m], X)
+  for (let i = 0; i < banded.length; i++) assert(many[i] === banded[i], `predictMany row ${i}`)
+  m.dispose()
+})
+
+await test('banded scoring leaves the pthread workers to later fits', async () => {
+  // Threaded build: a pool kept past the call would hold the workers
+  // that the fit below needs, and the fit would never return
+  const { X, y } = makeWideData(8, 800)
+  const featureFields = Int32Array.from({ length: 800 }, (_, j) => j % 4)
+  const a = await XLearnFFMClassifier.create({ epoch: 1, k: 4, featureFields, parallelNnz: 64 })
+  const b = await XLearnFFMClassifier.create({ epoch: 1, k: 4, featureFields, parallelNnz: 64 })
+  a.fit(X, y)
+  b.fit(X, y)
+  const before = a.decisionFunction(X)
+  predictMany([a, b], X)
+  const { X: Xl, y: yl } = makeLinearData(200)
+  const lr = await XLearnLRClassifier.create({ epoch: 5 })
+  lr.fit(Xl, yl)
+  assert(lr.score(Xl, yl) > 0.6, 'fit after banded predicts')
+  b.fit(X, y)
+  const after = a.decisionFunction(X)
+  for (let i = 0; i < before.length; i++) assert(after[i] === before[i], `row ${i}`)
+  for (const m of [a, b, lr]) m.dispose()
+})
+
+await test('banding is off by default', async () => {
+  const { X, y } = makeWideData(6, 2000)
+  const featureFields = Int32Array.from({ length: 2000 }, (_, j) => j % 4)
+  const m = await XLearnFFMClassifier.create({ epoch: 1, k: 4, featureFields })
+  m.fit(X, y)
+  const byDefault = m.decisionFunction(X)
+  m.setParams({ parallelNnz: 0 })
+  const serial = m.decisionFunction(X)
+  for (let i = 0; i < serial.length; i++) assert(byDefault[i] === serial[i], `row ${i}`)
+  m.dispose()
+})
+
+await test('rows below parallelNnz keep the serial kernel', async () => {
+  const { X, y } = makeWideData(40, 6)
+  const featureFields = new Int32Array([0, 0, 1, 1, 2, 2])
+  const m = await XLearnFFMClassifier.create({ epoch: 3, k: 4, featureFields, parallelNnz: 0 })
+  m.fit(X, y)
+  const serial = m.predict(X)
+  // Short rows fall in a single band, which is the serial loop exactly
+  m.setParams({ parallelNnz: 2 })
+  const banded = m.predict(X)
+  for (let i = 0; i < serial.length; i++) assert(banded[i] === serial[i], `row ${i}`)
+  const blocked = await XLearnFFMClassifier.load(m.save())
+  blocked.setParams({ layout: 'blocked', parallelNnz: 2 })
+  const pb = blocked.predict(X)
+  for (let i = 0; i < serial.length; i++) assert(pb[i] === serial[i], `blocked row ${i}`)
+  blocked.dispose()
+  m.dispose()
+})
+
+await test('invalid parallelNnz is rejected', async () => {
+  const { X, y } = makeLinearData(20)
+  const m = await XLearnFFMClassifier.create({ epoch: 1, featureFields: new Int32Array([0, 1]) })
+  m.fit(X, y)
+  let threw = false
+  try { m.setParams({ parallelNnz: -1 }) } catch { threw = true }
+  assert(threw, 'negative parallelNnz should throw')
+  m.dispose()
+})
+
+// ============================================================
+// Float32 input
+// ============================================================
+console.log('\n=== Float32 Input ===')
+
+await test('Float32Array data and typed labels match nested arrays', async () => {
+  const { X, y } = makeLinearData(60)
+  const a = await XLearnLRClassifier.create({ epoch: 8 })
+  a.fit(X, y)
+  const expected = a.decisionFunction(X)
+  a.dispose()
+
+  const dense = { data: new Float32Array(X.flat()), rows: X.length, cols: X[0].length }
+  for (const yTyped of [new Float32Array(y), new Int32Array(y)]) {
+    const b = await XLearnLRClassifier.create({ epoch: 8 })
+    b.fit(dense, yTyped)
+    const got = b.decisionFunction(dense)
+    for (let i = 0; i < got.length; i++) {
+      assert(got[i] === expected[i], `${yTyped.constructor.name}: row ${i} ${got[i]} vs ${expected[i]}`)
+    }
+    b.dispose()
+  }
+})
+
+await test('malformed CSR is rejected', async () => {
+  const m = await XLearnLRClassifier.create({ epoch: 1 })
+  const bad = [
+    { indptr: [0, 100, 5], indices: [0, 1, 0, 1, 0] }, // interior offset past nnz
+    { indptr: [0, 4, 2], indices: [0, 1, 0, 1, 0] }, // decreasing
+    { indptr: [0, 3, 5], indices: [0, 1, 7, 1, 0] }, // column >= cols
+    { indptr: [0, 3, 5], indices: [0, -1, 1, 1, 0] } // negative column
+  ]
+  for (const [k, { indptr, indices }] of bad.entries()) {
+    const X = {
+      data: new Float32Array(5).fill(1), indices: new Int32Array(indices),
+      indptr: new Int32Array(indptr), rows: 2, cols: 2
+    }
+    let threw = false
+    try { m.fit(X, [0, 1]) } catch { threw = true }
+    assert(threw, `case ${k} should throw`)
+  }
+  m.dispose()
+})
+
+await test('CSR with Float32Array values', async () => {
+  const { X, y } = makeLinearData(40)
+  const csr = {
+    data: new Float32Array(X.flat()),
+    indices: new Int32Array(X.flatMap(() => [0, 1])),
+    indptr: Int32Array.from({ length: X.length + 1 }, (_, i) => 2 * i),
+    rows: X.length,
+    cols: 2
+  }
+  const m = await XLearnFMRegressor.create({ epoch: 5 })
+  m.fit(csr, new Float32Array(y))
+  const fromCsr = m.predict(csr)
+  const fromDense = m.predict(X)
+  for (let i = 0; i < fromCsr.length; i++) {
+    assert(fromCsr[i] === fromDense[i], `row ${i}: ${fromCsr[i]} vs ${fromDense[i]}`)
+  }
+  m.dispose()
+})
+
+await test('typed matrix with wrong length throws', async () => {
+  const m = await XLearnLRClassifier.create({ epoch: 2 })
+  let threw = false
+  try {
+    m.fit({ data: new Float32Array(7), rows: 4, cols: 2 }, [0, 1, 0, 1])
+  } catch (e) {
+    threw = /does not match/.test(e.message)
+  }
+  assert(threw, 'expected a length mismatch error')
+  m.dispose()
+})
+
+// ============================================================
+// Heap budget
+// ============================================================
+console.log('\n=== Heap Budget ===')
+
+await test('memoryUsage reports models, datasets and batches', async () => {
+  const { X, y } = makeLinearData(50)
+  const m = await XLearnFMClassifier.create({ epoch: 3, k: 4 })
+  m.fit(X, y)
+  const before = m.memoryUsage()
+  assert(before.resident && before.heapBytes > 0, `heapBytes ${before.heapBytes}`)
+  assert(before.blobBytes === 0, 'no bytes cached before save()')
+  m.save()
+  assert(m.memoryUsage().blobBytes > 0, 'save() caches the model bytes')
+
+  const all = memoryUsage()
+  assert(all.models >= 1 && all.residentBytes >= before.heapBytes, 'module totals include the model')
+  assert(all.heapSize >= all.heapTop, 'heap top within the WASM memory')
+
+  const ds = await XLearnDataset.create(X, y)
+  const batch = await XLearnBatch.create(X)
+  assert(ds.memoryUsage().heapBytes > 0, 'dataset bytes')
+  assert(batch.memoryUsage().heapBytes > 0, 'batch bytes')
+  ds.dispose()
+  batch.dispose()
+  m.dispose()
+  assert(memoryUsage().models === all.models - 1, 'dispose drops the model')
+})
+
+await test('budget evicts least recently used models and restores them lazily', async () => {
+  const { X, y } = makeLinearData(50)
+  const models = []
+  const expected = []
+  for (let i = 0; i < 3; i++) {
+    const m = await XLearnFMClassifier.create({ epoch: 2 + i, k: 4 })
+    m.fit(X, y)
+    expected.push(m.predict(X))
+    models.push(m)
+  }
+  const start = memoryUsage()
+  try {
+    setHeapBudget(models[2].memoryUsage().heapBytes * 1.5)
+    assert(!models[0].memoryUsage().resident && !models[1].memoryUsage().resident, 'oldest two evicted')
+    assert(models[2].memoryUsage().resident, 'most recent kept')
+
+    const again = models[0].predict(X)
+    for (let i = 0; i < again.length; i++) {
+      assert(again[i] === expected[0][i], `row ${i}: ${again[i]} vs ${expected[0][i]}`)
+    }
+    assert(models[0].memoryUsage().resident && !models[2].memoryUsage().resident, 'restored one, evicted the next')
+    const now = memoryUsage()
+    assert(now.restores === start.restores + 1, `restores ${now.restores}`)
+    assert(now.evictions >= start.evictions + 3, `evictions ${now.evictions}`)
+  } finally {
+    setHeapBudget(0)
+    for (const m of models) m.dispose()
+  }
+})
+
+await test('predictMany under a budget keeps every model prepared', async () => {
+  const { X, y } = makeLinearData(40)
+  const models = []
+  for (let i = 0; i < 3; i++) {
+    const m = await XLearnLRClassifier.create({ epoch: 2 + i })
+    m.fit(X, y)
+    models.push(m)
+  }
+  const expected = models.map(m => m.predict(X))
+  try {
+    setHeapBudget(1)
+    const got = predictMany(models, X)
+    for (let k = 0; k < models.length; k++) {
+      for (let i = 0; i < X.length; i++) {
+        assert(got[k][i] === expected[k][i], `model ${k} row ${i}`)
+      }
+    }
+    let threw = false
+    try { setHeapBudget(-1) } catch { threw = true }
+    assert(threw, 'negative budget rejected')
+  } finally {
+    setHeapBudget(0)
+    for (const m of models) m.dispose()
+  }
+})
+
+// ============================================================
+// In-WASM metrics
+// ============================================================
+console.log('\n=== In-WASM Metrics ===')
+
+await test('evaluate: classifier metrics match a JS reference', async () => {
+  const { X, y } = makeLinearData(120)
+  const m = await XLearnFMClassifier.create({ epoch: 5, k: 4 })
+  m.fit(X, y)
+  const s = m.decisionFunction(X)
+  let correct = 0, loss = 0, wins = 0, pos = 0, neg = 0
+  for (let i = 0; i < s.length; i++) {
+    if ((s[i] > 0) === (y[i] > 0)) correct++
+    const z = (y[i] > 0 ? 1 : -1) * s[i]
+    loss += z > 0 ? Math.log1p(Math.exp(-z)) : -z + Math.log1p(Math.exp(z))
+    if (y[i] > 0) pos++
+    else neg++
+    for (let j = 0; j < s.length; j++) {
+      if (y[i] > 0 && !(y[j] > 0)) wins += s[i] > s[j] ? 1 : s[i] === s[j] ? 0.5 : 0
+    }
+  }
+  assert(m.evaluate(X, y) === correct / s.length, 'default metric is accuracy')
+  assert(m.score(X, y) === correct / s.length, 'score() is accuracy')
+  assertClose(m.evaluate(X, y, 'logloss'), loss / s.length, 1e-9, 'logloss')
+  assertClose(m.evaluate(X, y, 'auc'), wins / (pos * neg), 1e-12, 'auc')
+  m.dispose()
+})
+
+await test('predictProba: sigmoid of the margins, computed in WASM', async () => {
+  const { X, y } = makeLinearData(60)
+  const m = await XLearnLRClassifier.create({ epoch: 5 })
+  m.fit(X, y)
+  const s = m.decisionFunction(X)
+  const proba = m.predictProba(X)
+  assert(proba instanceof Float64Array && proba.length === s.length * 2, 'interleaved pairs')
+  for (let i = 0; i < s.length; i++) {
+    assertClose(proba[2 * i + 1], 1 / (1 + Math.exp(-s[i])), 1e-12, `row ${i}`)
+    assertClose(proba[2 * i] + proba[2 * i + 1], 1, 1e-12, `row ${i} sums to 1`)
+  }
+  const batch = await XLearnBatch.create(X)
+  const pb = m.predictProba(batch)
+  assert(pb.every((v, i) => v === proba[i]), 'XLearnBatch input')
+  batch.dispose()
+  m.dispose()
+})
+
+await test('evaluate: regression metrics and argument checks', async () => {
+  const { X, y } = makeRegressionData(80)
+  const m = await XLearnLRRegressor.create({ epoch: 10 })
+  m.fit(X, y)
+  const p = m.predict(X)
+  const yf = new Float32Array(y)
+  let sse = 0, mean = 0, sst = 0
+  for (let i = 0; i < p.length; i++) { sse += (p[i] - yf[i]) ** 2; mean += yf[i] }
+  mean /= p.length
+  for (let i = 0; i < p.length; i++) sst += (yf[i] - mean) ** 2
+  assertClose(m.evaluate(X, y, 'rmse'), Math.sqrt(sse / p.length), 1e-9, 'rmse')
+  assertClose(m.score(X, y), 1 - sse / sst, 1e-9, 'r2')
+
+  let threw = 0
+  try { m.evaluate(X, y, 'auc') } catch { threw++ }
+  try { m.evaluate(X, y, 'mape') } catch { threw++ }
+  try { m.evaluate(X, y.slice(1), 'rmse') } catch { threw++ }
+  assert(threw === 3, 'classifier metric, unknown metric and label count throw')
+  m.dispose()
+})
+
+// ============================================================
+// Sample weights and negative sampling
+// ============================================================
+console.log('\n=== Sample Weights ===')
+
+await test('sampleWeight scales gradients; zero weight skips rows', async () => {
+  const { X, y } = makeLinearData(80)
+  const base = { opt: 'sgd', lambda: 0, epoch: 5 }
+  const fitW = async (params, Xs, ys, w) => {
+    const m = await XLearnLRClassifier.create({ ...base, ...params })
+    m.fit(Xs, ys, { sampleWeight: w })
+    const p = m.decisionFunction(X)
+    m.dispose()
+    return p
+  }
+  // The last row weighs 0 in each fit: weights of all 1 train with
+  // upstream's trainer, not the weighted loop compared here
+  const twos = new Float32Array(80).fill(2)
+  const ones = new Float32Array(80).fill(1)
+  twos[79] = ones[79] = 0
+  const twice = await fitW({ lr: 0.1 }, X, y, twos)
+  const double = await fitW({ lr: 0.2 }, X, y, ones)
+  for (let i = 0; i < twice.length; i++) assertClose(twice[i], double[i], 1e-6, `row ${i}`)
+
+  const half = new Float32Array(80)
+  half.fill(1, 0, 39)
+  const masked = await fitW({ lr: 0.2 }, X, y, half)
+  const dropped = await fitW({ lr: 0.2 }, X.slice(0, 40), y.slice(0, 40), half.slice(0, 40))
+  for (let i = 0; i < masked.length; i++) assertClose(masked[i], dropped[i], 1e-6, `masked row ${i}`)
+
+  const m = await XLearnLRClassifier.create(base)
+  let threw = 0
+  try { m.fit(X, y, { sampleWeight: new Float32Array(79) }) } catch { threw++ }
+  try { m.fit(X, y, { sampleWeight: new Float32Array(80).fill(-1) }) } catch { threw++ }
+  assert(threw === 2, 'wrong length and negative weights throw')
+  assert(m.capabilities.sampleWeight === true, 'sampleWeight capability')
+  m.dispose()
+})
+
+await test('weights of all 1 train the same model as no weights', async () => {
+  const { X, y } = makeLinearData(80)
+  const params = { epoch: 5, nthread: 1 }
+  const plain = await XLearnLRClassifier.create(params)
+  plain.fit(X, y)
+  const unit = await XLearnLRClassifier.create(params)
+  unit.fit(X, y, { sampleWeight: new Float32Array(80).fill(1) })
+  const a = plain.decisionFunction(X)
+  const b = unit.decisionFunction(X)
+  for (let i = 0; i < a.length; i++) assert(a[i] === b[i], `row ${i}: ${a[i]} vs ${b[i]}`)
+  plain.dispose(); unit.dispose()
+})
+
+await test('negSampleRate: calibrated, seeded and classifier-only', async () => {
+  // x1 + x2 > 1.2: about 8% positives
+  const { X } = makeLinearData(400)
+  const y = X.map(([a, b]) => a + b > 1.2 ? 1 : 0)
+  const rate = y.reduce((a, v) => a + v, 0) / y.length
+  const params = { epoch: 20, normalize: false, negSampleRate: 0.25 }
+  const fitS = async (extra = {}) => {
+    const m = await XLearnLRClassifier.create({ ...params, ...extra })
+    m.fit(X, y)
+    return m
+  }
+  const m1 = await fitS()
+  const m2 = await fitS()
+  const m3 = await fitS({ negSampleSeed: 7 })
+  const p1 = m1.predictProba(X)
+  let mean = 0
+  for (let i = 0; i < y.length; i++) mean += p1[2 * i + 1]
+  mean /= y.length
+  assertClose(mean, rate, 0.05, `mean P(1) ${mean} vs positive rate ${rate}`)
+  const s1 = m1.decisionFunction(X)
+  const s2 = m2.decisionFunction(X)
+  const s3 = m3.decisionFunction(X)
+  assert(s1.every((v, i) => v === s2[i]), 'same seed, same model')
+  assert(s1.some((v, i) => v !== s3[i]), 'another seed samples other negatives')
+  assert(m1.evaluate(X, y, 'auc') > 0.8, 'sampled model still ranks')
+  for (const m of [m1, m2, m3]) m.dispose()
+
+  const { X: Xr, y: yr } = makeRegressionData(40)
+  const r = await XLearnLRRegressor.create({ negSampleRate: 0.5 })
+  let threw = false
+  try { r.fit(Xr, yr) } catch { threw = true }
+  assert(threw, 'negSampleRate on a regressor throws')
+  r.dispose()
+})
+
+await test('XLearnDataset keeps sampleWeight through save/load', async () => {
+  const { X, y } = makeLinearData(60)
+  const w = Float32Array.from(y, (v, i) => v ? 3 : 1 + (i % 2))
+  const direct = await XLearnFMClassifier.create({ epoch: 4, k: 4 })
+  direct.fit(X, y, { sampleWeight: w })
+
+  const ds = await XLearnDataset.create(X, y, { sampleWeight: w })
+  const loaded = await XLearnDataset.load(ds.save())
+  const ds2 = await XLearnDataset.create(X, y)
+  ds.dispose()
+  const viaDataset = await XLearnFMClassifier.create({ epoch: 4, k: 4 })
+  viaDataset.fitDataset(loaded)
+  loaded.dispose()
+
+  const a = direct.predict(X)
+  const b = viaDataset.predict(X)
+  assert(a.every((v, i) => v === b[i]), 'dataset weights match fit() weights')
+  let threw = false
+  try { viaDataset.fitDataset(ds2, { sampleWeight: w }) } catch { threw = true }
+  assert(threw, 'fitDataset rejects sampleWeight')
+  ds2.dispose()
+  direct.dispose()
+  viaDataset.dispose()
+})
+
 // ============================================================
 // Score
 // ============================================================